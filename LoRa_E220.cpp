@@ -45,6 +45,39 @@
 
 #include "LoRa_E220.h"
 
+// per data sheet control after aux goes high is 2ms, we wait a bit more
+#define AUX_GUARD_TIME 20
+// data sheet: the module takes M0/M1 into account and is ready 2ms after AUX goes high
+#ifndef MODE_SWITCH_GUARD_TIME
+	#define MODE_SWITCH_GUARD_TIME 2
+#endif
+// time for AUX to go LOW after the M0/M1 change, before looking for the rising edge
+#ifndef MODE_SWITCH_AUX_FALL_MICROS
+	#define MODE_SWITCH_AUX_FALL_MICROS 1000
+#endif
+#define MODE_SWITCH_TIMEOUT 1000
+// without AUX pin: idle time before and settle time after the M0/M1 change
+#define MODE_SWITCH_NO_AUX_IDLE 40
+#define MODE_SWITCH_NO_AUX_DELAY 160
+// without AUX pin: time for the module to store the registers after its answer
+#ifndef REGISTER_WRITE_NO_AUX_DELAY
+	#define REGISTER_WRITE_NO_AUX_DELAY 100
+#endif
+// worst case wait for a transmission to complete (with and without AUX pin)
+#define SEND_AUX_TIMEOUT 5000
+#define SEND_NO_AUX_DELAY 5000
+// wait for the first byte of a String message, as the Stream timeout set in begin()
+#define RECEIVE_FRAME_TIMEOUT 100
+
+// interrupt handlers must live in IRAM on Espressif chips
+#if defined(ESP32) || defined(ESP8266)
+	#define E220_ISR_ATTR IRAM_ATTR
+#else
+	#define E220_ISR_ATTR
+#endif
+
+LoRa_E220 *LoRa_E220::auxInterruptOwner = NULL;
+
 //=============================================================================
 // SOFTWARE SERIAL CONSTRUCTORS
 //=============================================================================
@@ -263,7 +296,14 @@ LoRa_E220::LoRa_E220(SoftwareSerial* serial, byte auxPin, byte m0Pin, byte m1Pin
 }
 #endif
 
-bool LoRa_E220::begin(){
+LoRa_E220::~LoRa_E220(){
+	if (auxInterruptOwner == this) {
+		detachInterrupt(digitalPinToInterrupt(this->auxPin));
+		auxInterruptOwner = NULL;
+	}
+}
+
+bool LoRa_E220::begin(bool auxInterrupt){
 	DEBUG_PRINT("RX MIC ---> ");
 	DEBUG_PRINTLN(this->txE220pin);
 	DEBUG_PRINT("TX MIC ---> ");
@@ -278,6 +318,26 @@ bool LoRa_E220::begin(){
 	if (this->auxPin != -1) {
 		pinMode(this->auxPin, INPUT);
 		DEBUG_PRINTLN("Init AUX pin!");
+
+#ifdef NOT_AN_INTERRUPT
+		if (auxInterrupt && digitalPinToInterrupt(this->auxPin) == NOT_AN_INTERRUPT) {
+			DEBUG_PRINTLN(F("AUX pin has no interrupt, polling it!"));
+			auxInterrupt = false;
+		}
+#endif
+		if (auxInterrupt && auxInterruptOwner != NULL && auxInterruptOwner != this) {
+			DEBUG_PRINTLN(F("AUX interrupt already used by another instance, polling it!"));
+			auxInterrupt = false;
+		}
+		if (auxInterrupt) {
+			this->auxEdgeHead = 0;
+			this->auxEdgeTail = 0;
+			this->auxLevel = digitalRead(this->auxPin);
+			auxInterruptOwner = this;
+			attachInterrupt(digitalPinToInterrupt(this->auxPin), LoRa_E220::auxInterruptHandler, CHANGE);
+			this->auxInterrupt = true;
+			DEBUG_PRINTLN("Init AUX interrupt!");
+		}
 	}
 	if (this->m0Pin != -1) {
 		pinMode(this->m0Pin, OUTPUT);
@@ -344,6 +404,10 @@ a timeout is provided to avoid an infinite loop
 */
 
 Status LoRa_E220::waitCompleteResponse(unsigned long timeout, unsigned int waitNoAux) {
+	return this->waitAuxHigh(timeout, waitNoAux, AUX_GUARD_TIME);
+}
+
+Status LoRa_E220::waitAuxHigh(unsigned long timeout, unsigned int waitNoAux, unsigned long guardTime) {
 
 	Status result = E220_SUCCESS;
 
@@ -354,15 +418,19 @@ Status LoRa_E220::waitCompleteResponse(unsigned long timeout, unsigned int waitN
 		t = 0;
 	}
 
+	E220_PROFILE_START(busyTimer)
 	// if AUX pin was supplied and look for HIGH state
 	// note you can omit using AUX if no pins are available, but you will have to use delay() to let module finish
 	if (this->auxPin != -1) {
-		while (digitalRead(this->auxPin) == LOW) {
+		while (!this->isAuxHigh()) {
 			if ((millis() - t) > timeout){
 				result = ERR_E220_TIMEOUT;
 				DEBUG_PRINTLN("Timeout error!");
+				E220_TRACE(TRACE_AUX_WAIT, result, millis() - t)
 				return result;
 			}
+			// the AUX interrupt wakes us up, nothing to poll meanwhile
+			if (this->auxInterrupt) E220_AUX_IDLE();
 		}
 		DEBUG_PRINTLN("AUX HIGH!");
 	}
@@ -372,16 +440,64 @@ Status LoRa_E220::waitCompleteResponse(unsigned long timeout, unsigned int waitN
 		this->managedDelay(waitNoAux);
 		DEBUG_PRINTLN(F("Wait no AUX pin!"));
 	}
-
+	E220_PROFILE_END(PROFILE_AUX_BUSY, busyTimer)
+	E220_TRACE(TRACE_AUX_WAIT, result, millis() - t)
 
 	// per data sheet control after aux goes high is 2ms so delay for at least that long)
-	this->managedDelay(20);
+	E220_PROFILE_START(guardTimer)
+	this->managedDelay(guardTime);
+	E220_PROFILE_END(PROFILE_GUARD_DELAY, guardTimer)
 	DEBUG_PRINTLN(F("Complete!"));
 	return result;
 }
 
 /*
 
+AUX tracking: with begin(true) an edge interrupt keeps the AUX level and a
+small single-producer/single-consumer buffer of timestamped edges, so the
+waits above check a variable instead of polling the pin
+
+*/
+
+void E220_ISR_ATTR LoRa_E220::auxInterruptHandler() {
+	if (auxInterruptOwner) auxInterruptOwner->onAuxChange();
+}
+
+void E220_ISR_ATTR LoRa_E220::onAuxChange() {
+	byte level = digitalRead(this->auxPin);
+	if (level == this->auxLevel) return;
+	this->auxLevel = level;
+
+	uint8_t next = (this->auxEdgeHead + 1) & (AUX_EDGE_BUFFER_SIZE - 1);
+	E220_TRACE_ISR(TRACE_AUX_EDGE, level, 0)
+	if (next != this->auxEdgeTail) {
+		this->auxEdges[this->auxEdgeHead].time = micros();
+		this->auxEdges[this->auxEdgeHead].level = level;
+		this->auxEdgeHead = next;
+	}
+}
+
+bool LoRa_E220::readAuxEdge(AuxEdge &edge) {
+	if (this->auxEdgeTail == this->auxEdgeHead) return false;
+
+	edge.time = this->auxEdges[this->auxEdgeTail].time;
+	edge.level = this->auxEdges[this->auxEdgeTail].level;
+	this->auxEdgeTail = (this->auxEdgeTail + 1) & (AUX_EDGE_BUFFER_SIZE - 1);
+	return true;
+}
+
+bool LoRa_E220::isAuxHigh() {
+	if (this->auxPin == -1) return true;
+	if (this->auxInterrupt) return this->auxLevel == HIGH;
+	return digitalRead(this->auxPin) == HIGH;
+}
+
+bool LoRa_E220::isAuxInterruptEnabled() {
+	return this->auxInterrupt;
+}
+
+/*
+
 delay() in a library is not a good idea as it can stop interrupts
 just poll internal time until timeout is reached
 
@@ -390,14 +506,11 @@ just poll internal time until timeout is reached
 
 void LoRa_E220::managedDelay(unsigned long timeout) {
 
-	unsigned long t = millis();
-
-	// make darn sure millis() is not about to reach max data type limit and start over
-	if (((unsigned long) (t + timeout)) == 0){
-		t = 0;
-	}
+	// counted in micros(): with millis() the wait started just before a tick
+	// and ended up to a millisecond short of the guard times
+	unsigned long t = micros();
 
-	while ((millis() - t) < timeout) 	{ 	}
+	while ((micros() - t) < timeout * 1000UL) 	{ 	}
 
 }
 
@@ -472,33 +585,77 @@ types each handle ints floats differently
 */
 
 Status LoRa_E220::sendStruct(void *structureManaged, uint16_t size_) {
-		if (size_ > MAX_SIZE_TX_PACKET + 2){
+		return this->sendStruct(NULL, 0, structureManaged, size_);
+}
+
+Status LoRa_E220::sendStruct(const void *header, uint8_t headerSize, const void *structureManaged, uint16_t size_) {
+		if (headerSize + size_ > MAX_SIZE_TX_PACKET + 2){
 			return ERR_E220_PACKET_TOO_BIG;
 		}
 
+		return this->transmitStruct(header, headerSize, structureManaged, size_).code;
+}
+
+/*
+
+Write and wait for the end of the transmission; the size is already checked,
+at runtime by sendStruct() or at compile time by the typed send<T>()
+
+*/
+
+ResponseStatus LoRa_E220::transmitStruct(const void *header, uint8_t headerSize, const void *structureManaged, uint16_t size_) {
+		ResponseStatus status;
+		E220_PROFILE_START(sendTimer)
+		status.code = this->writeStruct(header, headerSize, structureManaged, size_);
+		if (status.code != E220_SUCCESS) return status;
+
+		status.code = this->waitCompleteResponse(SEND_AUX_TIMEOUT, SEND_NO_AUX_DELAY);
+		if (status.code != E220_SUCCESS) return status;
+		E220_PROFILE_END(PROFILE_SEND, sendTimer)
+        DEBUG_PRINT(F("Clear buffer..."))
+        this->cleanUARTBuffer();
+
+		DEBUG_PRINTLN(F("ok!"))
+
+		return status;
+}
+
+/*
+
+Write a chunk of data to the module without waiting for the transmission,
+shared by the blocking sendStruct() and the non-blocking beginSend().
+
+The optional header (e.g. ADDH ADDL CHAN of a fixed transmission) is written
+just before the payload, so callers never have to copy both in one buffer.
+The caller checks the size
+
+*/
+
+Status LoRa_E220::writeStruct(const void *header, uint8_t headerSize, const void *structureManaged, uint16_t size_) {
+		uint16_t total = headerSize + size_;
 		Status result = E220_SUCCESS;
 
-		uint8_t len = this->serialDef.stream->write((uint8_t *) structureManaged, size_);
-		if (len!=size_){
+		uint16_t len = 0;
+		E220_PROFILE_START(writeTimer)
+		if (headerSize > 0) {
+			len = this->serialDef.stream->write((const uint8_t *) header, headerSize);
+		}
+		if (len == headerSize) {
+			len += this->serialDef.stream->write((const uint8_t *) structureManaged, size_);
+		}
+		E220_PROFILE_END(PROFILE_UART_WRITE, writeTimer)
+		if (len!=total){
 			DEBUG_PRINT(F("Send... len:"))
 			DEBUG_PRINT(len);
 			DEBUG_PRINT(F(" size:"))
-			DEBUG_PRINT(size_);
+			DEBUG_PRINT(total);
 			if (len==0){
 				result = ERR_E220_NO_RESPONSE_FROM_DEVICE;
 			}else{
 				result = ERR_E220_DATA_SIZE_NOT_MATCH;
 			}
 		}
-		if (result != E220_SUCCESS) return result;
-
-		result = this->waitCompleteResponse(5000, 5000);
-		if (result != E220_SUCCESS) return result;
-        DEBUG_PRINT(F("Clear buffer..."))
-        this->cleanUARTBuffer();
-
-		DEBUG_PRINTLN(F("ok!"))
-
+		E220_TRACE(TRACE_UART_WRITE, result, len)
 		return result;
 }
 
@@ -520,7 +677,9 @@ types each handle ints floats differently
 Status LoRa_E220::receiveStruct(void *structureManaged, uint16_t size_) {
 	Status result = E220_SUCCESS;
 
+	E220_PROFILE_START(receiveTimer)
 	uint8_t len = this->serialDef.stream->readBytes((uint8_t *) structureManaged, size_);
+	E220_PROFILE_END(PROFILE_UART_READ, receiveTimer)
 
 	DEBUG_PRINT("Available buffer: ");
 	DEBUG_PRINT(len);
@@ -534,10 +693,12 @@ Status LoRa_E220::receiveStruct(void *structureManaged, uint16_t size_) {
 			result = ERR_E220_DATA_SIZE_NOT_MATCH;
 		}
 	}
+	E220_TRACE(TRACE_UART_READ, result, len)
 	if (result != E220_SUCCESS) return result;
 
 	result = this->waitCompleteResponse(1000);
 	if (result != E220_SUCCESS) return result;
+	E220_PROFILE_END(PROFILE_RECEIVE, receiveTimer)
 
 	return result;
 }
@@ -549,11 +710,43 @@ method to set the mode (program, normal, etc.)
 */
 
 Status LoRa_E220::setMode(MODE_TYPE mode) {
+	unsigned long elapsed;
+	Status res = this->switchMode(mode, elapsed);
+
+	if (res == E220_SUCCESS){
+		this->mode = mode;
+	}
+
+	return res;
+}
+
+/*
+
+Drive M0/M1 and wait until the module is ready in the new mode. With AUX
+that is its rising edge plus the 2 ms of the data sheet; without AUX a fixed
+delay, or the transition time measured by calibrateModeSwitch()
+
+*/
 
-	// data sheet claims module needs some extra time after mode setting (2ms)
-	// most of my projects uses 10 ms, but 40ms is safer
+Status LoRa_E220::switchMode(MODE_TYPE mode, unsigned long &elapsed) {
+	elapsed = 0;
 
-	this->managedDelay(40);
+	if (mode > MODE_3_PROGRAM) return ERR_E220_INVALID_PARAM;
+	E220_PROFILE_START(switchTimer)
+
+	// the module must be idle: a transmission in progress would be cut
+	if (this->auxPin != -1) {
+		unsigned long t = millis();
+		while (!this->isAuxHigh()) {
+			if ((millis() - t) > MODE_SWITCH_TIMEOUT) {
+				DEBUG_PRINTLN(F("Timeout error!"));
+				return ERR_E220_TIMEOUT;
+			}
+			if (this->auxInterrupt) E220_AUX_IDLE();
+		}
+	} else {
+		this->managedDelay(MODE_SWITCH_NO_AUX_IDLE);
+	}
 
 	if (this->m0Pin == -1 && this->m1Pin == -1) {
 		DEBUG_PRINTLN(F("The M0 and M1 pins is not set, this mean that you are connect directly the pins as you need!"))
@@ -588,18 +781,234 @@ Status LoRa_E220::setMode(MODE_TYPE mode) {
 			return ERR_E220_INVALID_PARAM;
 		}
 	}
-	// data sheet says 2ms later control is returned, let's give just a bit more time
-	// these modules can take time to activate pins
-	this->managedDelay(40);
 
-	// wait until aux pin goes back low
-	Status res = this->waitCompleteResponse(1000);
+	if (this->auxPin == -1) {
+		unsigned long wait = MODE_SWITCH_NO_AUX_DELAY;
+		if (this->modeSwitchMicros > 0) {
+			wait = (this->modeSwitchMicros + 999) / 1000 + MODE_SWITCH_GUARD_TIME;
+		}
+		this->managedDelay(wait);
+		E220_TRACE(TRACE_MODE_SWITCH, mode, 0)
+		E220_PROFILE_END(PROFILE_MODE_SWITCH, switchTimer)
+		return E220_SUCCESS;
+	}
+
+	unsigned long t = micros();
 
-	if (res == E220_SUCCESS){
-		this->mode = mode;
+	// AUX goes LOW right after the pin change, give it a moment before looking for the rising edge
+	while (this->isAuxHigh() && (micros() - t) < MODE_SWITCH_AUX_FALL_MICROS) {
+		if (this->auxInterrupt) E220_AUX_IDLE();
 	}
+	while (!this->isAuxHigh()) {
+		if ((micros() - t) > MODE_SWITCH_TIMEOUT * 1000UL) {
+			DEBUG_PRINTLN(F("Timeout error!"));
+			return ERR_E220_TIMEOUT;
+		}
+		if (this->auxInterrupt) E220_AUX_IDLE();
+	}
+	elapsed = micros() - t;
+	DEBUG_PRINT(F("Mode switched in us: "));
+	DEBUG_PRINTLN(elapsed);
+	E220_TRACE(TRACE_MODE_SWITCH, mode, elapsed > 0xFFFF ? 0xFFFF : elapsed)
+
+	// per data sheet control is returned 2ms after AUX goes high
+	E220_PROFILE_START(guardTimer)
+	this->managedDelay(MODE_SWITCH_GUARD_TIME);
+	E220_PROFILE_END(PROFILE_GUARD_DELAY, guardTimer)
+	E220_PROFILE_END(PROFILE_MODE_SWITCH, switchTimer)
+	return E220_SUCCESS;
+}
 
-	return res;
+bool LoRa_E220::begin(UART_BPS_RATE maxBpsRate, bool auxInterrupt){
+	if (!this->begin(auxInterrupt)) return false;
+	return this->negotiateBaudRate(maxBpsRate).code == E220_SUCCESS;
+}
+
+ResponseStatus LoRa_E220::negotiateBaudRate(UART_BPS_RATE maxBpsRate, PROGRAM_COMMAND saveType){
+	ResponseStatus rc;
+
+	rc.code = this->enterProgramMode();
+	if (rc.code!=E220_SUCCESS) return rc;
+
+	Configuration configuration;
+	rc = this->getConfiguration(configuration);
+
+	bool changed = false;
+	if (rc.code==E220_SUCCESS && configuration.SPED.uartBaudRate != getUARTBaudType(maxBpsRate)) {
+		DEBUG_PRINT(F("Negotiate UART at "));
+		DEBUG_PRINTLN((uint32_t)maxBpsRate);
+
+		/* the key read back is 0: write SPED only */
+		configuration.SPED.uartBaudRate = getUARTBaudType(maxBpsRate);
+		rc = this->updateConfiguration(configuration, saveType, false);
+		changed = true;
+
+		/* verify what the module holds now, not what was written */
+		if (rc.code==E220_SUCCESS) rc = this->getConfiguration(configuration);
+		if (rc.code==E220_SUCCESS && configuration.SPED.uartBaudRate != getUARTBaudType(maxBpsRate)) {
+			rc.code = ERR_E220_INVALID_PARAM;
+		}
+	}
+
+	/* reopens the host UART at the rate read last */
+	Status modeStatus = this->exitProgramMode();
+	if (rc.code==E220_SUCCESS) rc.code = modeStatus;
+
+	if (rc.code==E220_SUCCESS && changed) {
+		Status check = this->checkDataLink();
+		if (check != E220_SUCCESS) {
+			DEBUG_PRINTLN(F("No answer at the new UART rate, back to 9600"));
+
+			rc.code = this->enterProgramMode();
+			if (rc.code!=E220_SUCCESS) return rc;
+			configuration.SPED.uartBaudRate = getUARTBaudType(UART_BPS_RATE_9600);
+			rc = this->updateConfiguration(configuration, saveType, false);
+			modeStatus = this->exitProgramMode();
+			if (rc.code==E220_SUCCESS) rc.code = (modeStatus==E220_SUCCESS) ? check : modeStatus;
+		}
+	}
+
+	return rc;
+}
+
+/*
+
+Program mode runs at 9600, so the configuration read back there says nothing
+of the data path at the new rate: exchange the RSSI registers in normal mode.
+Without ambient RSSI or outside normal mode there is no exchange that does
+not transmit, and the link is taken as working
+
+*/
+
+Status LoRa_E220::checkDataLink() {
+	byte ambient, lastPacket;
+	Status check = this->readRSSI(ambient, lastPacket).code;
+
+	// a packet arriving meanwhile spoils the answer: once more
+	if (check == ERR_E220_BUSY || check == ERR_E220_HEAD_NOT_RECOGNIZED) {
+		this->managedDelay(AUX_GUARD_TIME);
+		check = this->readRSSI(ambient, lastPacket).code;
+	}
+
+	if (check == ERR_E220_NOT_SUPPORT || check == ERR_E220_INVALID_PARAM) {
+		DEBUG_PRINTLN(F("UART rate not checked, RSSI disabled or not in normal mode"));
+		return E220_SUCCESS;
+	}
+	return (check == E220_SUCCESS) ? E220_SUCCESS : ERR_E220_WRONG_UART_CONFIG;
+}
+
+UART_BPS_RATE LoRa_E220::getBpsRate(){
+	return this->bpsRate;
+}
+
+/*
+
+Program mode is counted: nested enter/exit pairs (a session around several
+configuration calls) switch mode only on the outermost ones
+
+*/
+
+Status LoRa_E220::enterProgramMode() {
+	if (this->programDepth > 0) {
+		if (this->programDepth == 255) return ERR_E220_INVALID_PARAM;
+		this->programDepth++;
+		return E220_SUCCESS;
+	}
+
+	this->programPrevMode = this->mode;
+	if (this->mode != MODE_3_PROGRAM) {
+		Status result = this->setMode(MODE_3_PROGRAM);
+		if (result != E220_SUCCESS) return result;
+	}
+
+	// program mode always talks at 9600
+	if (this->bpsRate != UART_BPS_RATE_9600) this->setStreamBaud(UART_BPS_RATE_9600);
+
+	this->programDepth = 1;
+	return E220_SUCCESS;
+}
+
+Status LoRa_E220::exitProgramMode() {
+	if (this->programDepth == 0) return ERR_E220_INVALID_PARAM;
+	if (--this->programDepth > 0) return E220_SUCCESS;
+
+	Status result = E220_SUCCESS;
+	if (this->programPrevMode != this->mode) result = this->setMode(this->programPrevMode);
+
+	// the data rate, possibly changed by a configuration written in the session
+	if (this->bpsRate != UART_BPS_RATE_9600) this->setStreamBaud(this->bpsRate);
+	return result;
+}
+
+/*
+
+Reopen the host UART at another rate, after the bytes still queued are out
+
+*/
+
+void LoRa_E220::setStreamBaud(UART_BPS_RATE bpsRate) {
+	DEBUG_PRINT(F("Host UART at "));
+	DEBUG_PRINTLN((uint32_t)bpsRate);
+
+	this->serialDef.stream->flush();
+	if (this->hs) {
+#if defined(ESP32) || defined(ESP8266)
+		this->hs->updateBaudRate(bpsRate);
+#else
+		/* keep the frame format, begin() alone falls back to 8N1 */
+		this->hs->begin(bpsRate, this->serialConfig);
+#endif
+#ifdef ACTIVATE_SOFTWARE_SERIAL
+	} else if (this->ss) {
+		this->ss->begin(bpsRate);
+		this->ss->listen();
+#endif
+	}
+}
+
+/*
+
+Settings the library follows from a configuration read or written
+
+*/
+
+void LoRa_E220::updateFromConfiguration(const Configuration &configuration) {
+	this->airDataRate = (AIR_DATA_RATE)configuration.SPED.airDataRate;
+	this->bpsRate = getUARTBaudRate((UART_BPS_TYPE)configuration.SPED.uartBaudRate);
+}
+
+bool LoRa_E220::isProgramMode() {
+	return this->programDepth > 0;
+}
+
+unsigned long LoRa_E220::calibrateModeSwitch(uint8_t rounds) {
+	if (this->auxPin == -1 || (this->m0Pin == -1 && this->m1Pin == -1) || this->programDepth > 0) return 0;
+
+	MODE_TYPE prevMode = this->mode;
+	MODE_TYPE otherMode = (prevMode == MODE_3_PROGRAM) ? MODE_0_NORMAL : MODE_3_PROGRAM;
+	unsigned long worst = 0;
+
+	/* there and back, so it ends in the previous mode */
+	for (uint8_t i = 0; i < rounds * 2; i++) {
+		unsigned long elapsed;
+		Status res = this->switchMode((i & 1) ? prevMode : otherMode, elapsed);
+		if (res != E220_SUCCESS) {
+			this->setMode(prevMode);
+			return 0;
+		}
+		if (elapsed > worst) worst = elapsed;
+	}
+
+	this->modeSwitchMicros = worst;
+	return worst;
+}
+
+void LoRa_E220::setModeSwitchMicros(unsigned long modeSwitchMicros) {
+	this->modeSwitchMicros = modeSwitchMicros;
+}
+
+unsigned long LoRa_E220::getModeSwitchMicros() {
+	return this->modeSwitchMicros;
 }
 
 MODE_TYPE LoRa_E220::getMode(){
@@ -608,11 +1017,14 @@ MODE_TYPE LoRa_E220::getMode(){
 
 bool LoRa_E220::writeProgramCommand(PROGRAM_COMMAND cmd, REGISTER_ADDRESS addr, PACKET_LENGHT pl){
 	  uint8_t CMD[3] = {cmd, addr, pl};
+	  E220_TRACE(TRACE_PROGRAM_COMMAND, cmd, addr << 8 | pl)
+	  E220_PROFILE_START(commandTimer)
 	  uint8_t size = this->serialDef.stream->write(CMD, 3);
 
 	  DEBUG_PRINTLN(size);
 
 	  this->managedDelay(50);  //need ti check
+	  E220_PROFILE_END(PROFILE_PROGRAM_COMMAND, commandTimer)
 
 	  return size!=2;
 }
@@ -620,57 +1032,56 @@ bool LoRa_E220::writeProgramCommand(PROGRAM_COMMAND cmd, REGISTER_ADDRESS addr,
 ResponseStructContainer LoRa_E220::getConfiguration(){
 	ResponseStructContainer rc;
 
-	rc.status.code = checkUARTConfiguration(MODE_3_PROGRAM);
-	if (rc.status.code!=E220_SUCCESS) return rc;
+	rc.data = malloc(sizeof(Configuration));
+	rc.status = this->getConfiguration(*(Configuration *)rc.data);
+
+	return rc;
+}
 
-	MODE_TYPE prevMode = this->mode;
+ResponseStatus LoRa_E220::getConfiguration(Configuration &configuration){
+	ResponseStatus rc;
 
-	rc.status.code = this->setMode(MODE_3_PROGRAM);
-	if (rc.status.code!=E220_SUCCESS) return rc;
+	rc.code = this->enterProgramMode();
+	if (rc.code!=E220_SUCCESS) return rc;
 
 	this->writeProgramCommand(READ_CONFIGURATION, REG_ADDRESS_CFG, PL_CONFIGURATION);
 
-	rc.data = malloc(sizeof(Configuration));
-	rc.status.code = this->receiveStruct((uint8_t *)rc.data, sizeof(Configuration));
+	rc.code = this->receiveStruct((uint8_t *)&configuration, sizeof(Configuration));
+	E220_TRACE(TRACE_CONFIGURATION, rc.code, configuration.CHAN << 8 | (&configuration.ADDH)[REG_ADDRESS_SPED])
 
 #ifdef LoRa_E220_DEBUG
-	 this->printParameters((Configuration *)rc.data);
+	 this->printParameters(&configuration);
 #endif
 
-	if (rc.status.code!=E220_SUCCESS) {
-		this->setMode(prevMode);
+	if (rc.code!=E220_SUCCESS) {
+		this->exitProgramMode();
 		return rc;
 	}
 
-	rc.status.code = this->setMode(prevMode);
-	if (rc.status.code!=E220_SUCCESS) return rc;
-
-	if (WRONG_FORMAT == ((Configuration *)rc.data)->COMMAND){
-		rc.status.code = ERR_E220_WRONG_FORMAT;
+	if (WRONG_FORMAT == configuration.COMMAND){
+		rc.code = ERR_E220_WRONG_FORMAT;
+	}
+	if (RETURNED_COMMAND != configuration.COMMAND || REG_ADDRESS_CFG!= configuration.STARTING_ADDRESS || PL_CONFIGURATION!= configuration.LENGHT){
+		rc.code = ERR_E220_HEAD_NOT_RECOGNIZED;
 	}
-	if (RETURNED_COMMAND != ((Configuration *)rc.data)->COMMAND || REG_ADDRESS_CFG!= ((Configuration *)rc.data)->STARTING_ADDRESS || PL_CONFIGURATION!= ((Configuration *)rc.data)->LENGHT){
-		rc.status.code = ERR_E220_HEAD_NOT_RECOGNIZED;
+	if (rc.code==E220_SUCCESS) {
+		this->updateFromConfiguration(configuration);
+		this->cachedConfiguration = configuration;
 	}
+	this->configurationCached = (rc.code==E220_SUCCESS);
+	this->cryptCached = false;
 
-	return rc;
-}
+	/* after the update: the data rate restored on exit may have changed */
+	Status modeStatus = this->exitProgramMode();
+	if (rc.code==E220_SUCCESS) rc.code = modeStatus;
 
-RESPONSE_STATUS LoRa_E220::checkUARTConfiguration(MODE_TYPE mode){
-	if (mode==MODE_3_PROGRAM && this->bpsRate!=UART_BPS_RATE_9600){
-		return ERR_E220_WRONG_UART_CONFIG;
-	}
-	return E220_SUCCESS;
+	return rc;
 }
 
 ResponseStatus LoRa_E220::setConfiguration(Configuration configuration, PROGRAM_COMMAND saveType){
 	ResponseStatus rc;
 
-	rc.code = checkUARTConfiguration(MODE_3_PROGRAM);
-	if (rc.code!=E220_SUCCESS) return rc;
-
-	MODE_TYPE prevMode = this->mode;
-
-	rc.code = this->setMode(MODE_3_PROGRAM);
+	rc.code = this->enterProgramMode();
 	if (rc.code!=E220_SUCCESS) return rc;
 
 //	this->writeProgramCommand(saveType, REG_ADDRESS_CFG);
@@ -680,21 +1091,28 @@ ResponseStatus LoRa_E220::setConfiguration(Configuration configuration, PROGRAM_
 	configuration.STARTING_ADDRESS = REG_ADDRESS_CFG;
 	configuration.LENGHT = PL_CONFIGURATION;
 
-	rc.code = this->sendStruct((uint8_t *)&configuration, sizeof(Configuration));
+	/* the registers are unknown until the answer is checked */
+	this->configurationCached = false;
+	Crypt crypt = configuration.CRYPT;
+
+	/* only written: sendStruct() clears the UART after the AUX guard, and with it the answer */
+	rc.code = this->writeStruct(NULL, 0, (uint8_t *)&configuration, sizeof(Configuration));
 	if (rc.code!=E220_SUCCESS) {
-		this->setMode(prevMode);
+		this->exitProgramMode();
 		return rc;
 	}
 
 	rc.code = this->receiveStruct((uint8_t *)&configuration, sizeof(Configuration));
+	E220_TRACE(TRACE_CONFIGURATION, rc.code, configuration.CHAN << 8 | (&configuration.ADDH)[REG_ADDRESS_SPED])
 
 	#ifdef LoRa_E220_DEBUG
 		 this->printParameters((Configuration *)&configuration);
 	#endif
 
-
-	rc.code = this->setMode(prevMode);
-	if (rc.code!=E220_SUCCESS) return rc;
+	if (rc.code!=E220_SUCCESS) {
+		this->exitProgramMode();
+		return rc;
+	}
 
 	if (WRONG_FORMAT == ((Configuration *)&configuration)->COMMAND){
 		rc.code = ERR_E220_WRONG_FORMAT;
@@ -702,57 +1120,235 @@ ResponseStatus LoRa_E220::setConfiguration(Configuration configuration, PROGRAM_
 	if (RETURNED_COMMAND != ((Configuration *)&configuration)->COMMAND || REG_ADDRESS_CFG!= ((Configuration *)&configuration)->STARTING_ADDRESS || PL_CONFIGURATION!= ((Configuration *)&configuration)->LENGHT){
 		rc.code = ERR_E220_HEAD_NOT_RECOGNIZED;
 	}
+	if (rc.code==E220_SUCCESS) {
+		this->updateFromConfiguration(configuration);
+		this->cachedConfiguration = configuration;
+		this->cachedConfiguration.CRYPT = crypt;
+	}
+	this->configurationCached = (rc.code==E220_SUCCESS);
+	this->cryptCached = this->configurationCached;
+
+	/* after the update: the data rate restored on exit may have changed */
+	Status modeStatus = this->exitProgramMode();
+	if (rc.code==E220_SUCCESS) rc.code = modeStatus;
 
 	return rc;
 }
 
+/*
+
+Write one contiguous run of registers, the module is already in program mode.
+The answer (C1 address length values) updates the cache
+
+*/
+
+Status LoRa_E220::writeRegisters(PROGRAM_COMMAND saveType, uint8_t address, const uint8_t *values, uint8_t length){
+	uint8_t header[3] = { (uint8_t)saveType, address, length };
+	uint8_t answer[3 + PL_CONFIGURATION];
+
+	Status result = this->writeStruct(header, sizeof(header), values, length);
+	if (result != E220_SUCCESS) return result;
+	E220_TRACE(TRACE_REGISTER_WRITE, saveType, address << 8 | length)
+
+	E220_PROFILE_START(readTimer)
+	uint8_t len = this->serialDef.stream->readBytes(answer, 3 + length);
+	E220_PROFILE_END(PROFILE_UART_READ, readTimer)
+	if (len == 0) return ERR_E220_NO_RESPONSE_FROM_DEVICE;
+	if (len != 3 + length) return ERR_E220_DATA_SIZE_NOT_MATCH;
+
+	if (WRONG_FORMAT == answer[0]) return ERR_E220_WRONG_FORMAT;
+	if (RETURNED_COMMAND != answer[0] || address != answer[1] || length != answer[2]) return ERR_E220_HEAD_NOT_RECOGNIZED;
+
+	uint8_t *registers = &this->cachedConfiguration.ADDH;
+	for (uint8_t i = 0; i < length; i++) {
+		// CRYPT reads back as 0: keep the key written
+		registers[address + i] = (address + i >= REG_ADDRESS_CRYPT) ? values[i] : answer[3 + i];
+	}
+
+	/* the module stores the registers after the answer, with AUX LOW: a command
+	   sent meanwhile (next run, chained call, readback) would be lost */
+	return this->waitAuxHigh(1000, REGISTER_WRITE_NO_AUX_DELAY, MODE_SWITCH_GUARD_TIME);
+}
+
+ResponseStatus LoRa_E220::updateConfiguration(Configuration configuration, PROGRAM_COMMAND saveType, bool writeUnknownCrypt){
+	ResponseStatus rc;
+	if (!this->configurationCached) {
+		rc = this->refreshConfiguration();
+		if (rc.code!=E220_SUCCESS) return rc;
+	}
+
+	rc.code = this->writeChangedRegisters(configuration, saveType, writeUnknownCrypt, NULL);
+	return rc;
+}
+
+ResponseStatus LoRa_E220::ensureConfiguration(Configuration configuration, PROGRAM_COMMAND saveType, bool *written, bool writeUnknownCrypt){
+	ResponseStatus rc;
+	if (written) *written = false;
+
+	rc.code = this->enterProgramMode();
+	if (rc.code!=E220_SUCCESS) return rc;
+
+	/* the read forgets the key, which it cannot return: keep a key written before */
+	bool cryptKnown = this->cryptCached && this->configurationCached;
+	struct Crypt crypt = this->cachedConfiguration.CRYPT;
+
+	Configuration current;
+	rc = this->getConfiguration(current);
+	if (rc.code==E220_SUCCESS) {
+		if (cryptKnown) {
+			this->cachedConfiguration.CRYPT = crypt;
+			this->cryptCached = true;
+		}
+		rc.code = this->writeChangedRegisters(configuration, saveType, writeUnknownCrypt, written);
+	}
+
+	Status modeStatus = this->exitProgramMode();
+	if (rc.code==E220_SUCCESS) rc.code = modeStatus;
+
+	return rc;
+}
+
+/*
+
+Write the registers that differ from the cache, one command per contiguous
+run. An unknown key is written, or left alone, depending on writeUnknownCrypt
+
+*/
+
+Status LoRa_E220::writeChangedRegisters(const Configuration &configuration, PROGRAM_COMMAND saveType, bool writeUnknownCrypt, bool *written){
+	Status result = E220_SUCCESS;
+
+	const uint8_t *wanted = &configuration.ADDH;
+	const uint8_t *current = &this->cachedConfiguration.ADDH;
+	bool changed[PL_CONFIGURATION];
+	bool any = false;
+	for (uint8_t i = 0; i < PL_CONFIGURATION; i++) {
+		if (i >= REG_ADDRESS_CRYPT && !this->cryptCached) {
+			changed[i] = writeUnknownCrypt;
+		} else {
+			changed[i] = wanted[i] != current[i];
+		}
+		any = any || changed[i];
+	}
+	if (!any) return result;
+
+	result = this->enterProgramMode();
+	if (result!=E220_SUCCESS) return result;
+
+	for (uint8_t start = 0; start < PL_CONFIGURATION && result==E220_SUCCESS; start++) {
+		if (!changed[start]) continue;
+		uint8_t end = start;
+		while (end < PL_CONFIGURATION && changed[end]) end++;
+
+		DEBUG_PRINT(F("Write registers "));
+		DEBUG_PRINT(start);
+		DEBUG_PRINT(F("-"));
+		DEBUG_PRINTLN(end - 1);
+
+		/* sent, even if the answer is lost: the module may have written it */
+		if (written) *written = true;
+		result = this->writeRegisters(saveType, start, wanted + start, end - start);
+		if (result==E220_SUCCESS && end > REG_ADDRESS_CRYPT) this->cryptCached = true;
+		start = end;
+	}
+
+	/* a failed run leaves the module partly written */
+	if (result!=E220_SUCCESS) this->configurationCached = false;
+	this->updateFromConfiguration(this->cachedConfiguration);
+
+	Status modeStatus = this->exitProgramMode();
+	if (result==E220_SUCCESS) result = modeStatus;
+
+	return result;
+}
+
+ResponseStatus LoRa_E220::setChannel(byte CHAN, bool temporary){
+	ResponseStatus rc;
+	rc.code = E220_SUCCESS;
+
+	if (temporary && this->configurationCached && this->cachedConfiguration.CHAN == CHAN) return rc;
+
+	rc.code = this->enterProgramMode();
+	if (rc.code!=E220_SUCCESS) return rc;
+
+	/* the other cached registers are untouched, an invalid cache stays invalid */
+	rc.code = this->writeRegisters(temporary ? WRITE_CFG_PWR_DWN_LOSE : WRITE_CFG_PWR_DWN_SAVE, REG_ADDRESS_CHANNEL, &CHAN, PL_CHANNEL);
+	if (rc.code!=E220_SUCCESS) this->configurationCached = false;
+
+	Status modeStatus = this->exitProgramMode();
+	if (rc.code==E220_SUCCESS) rc.code = modeStatus;
+
+	return rc;
+}
+
+ResponseStatus LoRa_E220::getCachedConfiguration(Configuration &configuration){
+	ResponseStatus rc;
+
+	if (!this->configurationCached) {
+		rc = this->refreshConfiguration();
+		if (rc.code!=E220_SUCCESS) return rc;
+	}
+
+	configuration = this->cachedConfiguration;
+	rc.code = E220_SUCCESS;
+	return rc;
+}
+
+ResponseStatus LoRa_E220::refreshConfiguration(){
+	Configuration configuration;
+	return this->getConfiguration(configuration);
+}
+
+void LoRa_E220::invalidateConfiguration(){
+	this->configurationCached = false;
+}
+
+bool LoRa_E220::isConfigurationCached(){
+	return this->configurationCached;
+}
+
 ResponseStructContainer LoRa_E220::getModuleInformation(){
 	ResponseStructContainer rc;
 
-	rc.status.code = checkUARTConfiguration(MODE_3_PROGRAM);
-	if (rc.status.code!=E220_SUCCESS) return rc;
+	rc.data = malloc(sizeof(ModuleInformation));
+	rc.status = this->getModuleInformation(*(ModuleInformation *)rc.data);
 
-	MODE_TYPE prevMode = this->mode;
+	return rc;
+}
 
-	rc.status.code = this->setMode(MODE_3_PROGRAM);
-	if (rc.status.code!=E220_SUCCESS) return rc;
+ResponseStatus LoRa_E220::getModuleInformation(ModuleInformation &moduleInformation){
+	ResponseStatus rc;
 
-	this->writeProgramCommand(READ_CONFIGURATION, REG_ADDRESS_PID, PL_PID);
+	rc.code = this->enterProgramMode();
+	if (rc.code!=E220_SUCCESS) return rc;
 
-	rc.data = malloc(sizeof(ModuleInformation));
+	this->writeProgramCommand(READ_CONFIGURATION, REG_ADDRESS_PID, PL_PID);
 
-//	struct ModuleInformation *moduleInformation = (ModuleInformation *)malloc(sizeof(ModuleInformation));
-	rc.status.code = this->receiveStruct((uint8_t *)rc.data, sizeof(ModuleInformation));
-	if (rc.status.code!=E220_SUCCESS) {
-		this->setMode(prevMode);
+	rc.code = this->receiveStruct((uint8_t *)&moduleInformation, sizeof(ModuleInformation));
+	if (rc.code!=E220_SUCCESS) {
+		this->exitProgramMode();
 		return rc;
 	}
 
-	rc.status.code = this->setMode(prevMode);
-	if (rc.status.code!=E220_SUCCESS) return rc;
-
-//	this->printParameters(*configuration);
+	rc.code = this->exitProgramMode();
+	if (rc.code!=E220_SUCCESS) return rc;
 
-	if (WRONG_FORMAT == ((ModuleInformation *)rc.data)->COMMAND){
-		rc.status.code = ERR_E220_WRONG_FORMAT;
+	if (WRONG_FORMAT == moduleInformation.COMMAND){
+		rc.code = ERR_E220_WRONG_FORMAT;
 	}
-	if (RETURNED_COMMAND != ((ModuleInformation *)rc.data)->COMMAND || REG_ADDRESS_PID!= ((ModuleInformation *)rc.data)->STARTING_ADDRESS || PL_PID!= ((ModuleInformation *)rc.data)->LENGHT){
-		rc.status.code = ERR_E220_HEAD_NOT_RECOGNIZED;
+	if (RETURNED_COMMAND != moduleInformation.COMMAND || REG_ADDRESS_PID!= moduleInformation.STARTING_ADDRESS || PL_PID!= moduleInformation.LENGHT){
+		rc.code = ERR_E220_HEAD_NOT_RECOGNIZED;
 	}
 
 	DEBUG_PRINTLN("----------------------------------------");
-	DEBUG_PRINT(F("HEAD: "));  DEBUG_PRINT(((ModuleInformation *)rc.data)->COMMAND, BIN);DEBUG_PRINT(" ");DEBUG_PRINT(((ModuleInformation *)rc.data)->STARTING_ADDRESS, DEC);DEBUG_PRINT(" ");DEBUG_PRINTLN(((ModuleInformation *)rc.data)->LENGHT, HEX);
+	DEBUG_PRINT(F("HEAD: "));  DEBUG_PRINT(moduleInformation.COMMAND, BIN);DEBUG_PRINT(" ");DEBUG_PRINT(moduleInformation.STARTING_ADDRESS, DEC);DEBUG_PRINT(" ");DEBUG_PRINTLN(moduleInformation.LENGHT, HEX);
 
-	DEBUG_PRINT(F("Model no.: "));  DEBUG_PRINTLN(((ModuleInformation *)rc.data)->model, HEX);
-	DEBUG_PRINT(F("Version  : "));  DEBUG_PRINTLN(((ModuleInformation *)rc.data)->version, HEX);
-	DEBUG_PRINT(F("Features : "));  DEBUG_PRINTLN(((ModuleInformation *)rc.data)->features, HEX);
-	DEBUG_PRINT(F("Status : "));  DEBUG_PRINTLN(rc.status.getResponseDescription());
+	DEBUG_PRINT(F("Model no.: "));  DEBUG_PRINTLN(moduleInformation.model, HEX);
+	DEBUG_PRINT(F("Version  : "));  DEBUG_PRINTLN(moduleInformation.version, HEX);
+	DEBUG_PRINT(F("Features : "));  DEBUG_PRINTLN(moduleInformation.features, HEX);
+	DEBUG_PRINT(F("Status : "));  DEBUG_PRINTLN(rc.getResponseDescription());
 	DEBUG_PRINTLN("----------------------------------------");
 
-//	if (rc.status.code!=E220_SUCCESS) return rc;
-
-//	rc.data = moduleInformation; // malloc(sizeof (moduleInformation));
-
 	return rc;
 }
 
@@ -797,26 +1393,178 @@ ResponseContainer LoRa_E220::receiveMessageRSSI(){
 ResponseContainer LoRa_E220::receiveMessageComplete(bool rssiEnabled){
 	ResponseContainer rc;
 	rc.status.code = E220_SUCCESS;
-	String tmpData = this->serialDef.stream->readString();
 
-	DEBUG_PRINTLN(tmpData);
+	byte frame[MAX_SIZE_TX_PACKET + 1];
+	uint16_t length = 0;
+	ResponseStatus status = this->receiveFrame(frame, sizeof(frame), length, RECEIVE_FRAME_TIMEOUT);
+	if (status.code!=E220_SUCCESS && status.code!=ERR_E220_TIMEOUT) {
+		rc.status = status;
+	}
 
-	if (rssiEnabled){
-		rc.rssi = tmpData.charAt(tmpData.length()-1);
-		rc.data = tmpData.substring(0, tmpData.length()-1);
-	}else{
-		rc.data = tmpData;
+	if (rssiEnabled && length > 0){
+		length--;
+		rc.rssi = frame[length];
 	}
-	this->cleanUARTBuffer();
-	if (rc.status.code!=E220_SUCCESS) {
+	rc.data.reserve(length);
+	for (uint16_t i = 0; i < length; i++) {
+		rc.data += (char)frame[i];
+	}
+
+	DEBUG_PRINTLN(rc.data);
+
+	return rc;
+}
+
+/*
+
+Byte framer: a received packet is output by the module as one burst on the
+UART, so the frame ends when the line stays silent for a few character times
+(or when AUX goes back HIGH), instead of waiting for the Stream timeout
+
+*/
+
+Status LoRa_E220::pollFrame(void *buffer, uint16_t size, uint16_t &length){
+	uint8_t *frame = (uint8_t *)buffer;
+
+	while (this->serialDef.stream->available()) {
+		int c = this->serialDef.stream->read();
+		if (c < 0) break;
+		if (this->frameLength < size) {
+			frame[this->frameLength] = (uint8_t)c;
+		}
+		if (this->frameLength <= size) {
+			this->frameLength++;
+		}
+		this->frameLastByte = micros();
+	}
+
+	length = (this->frameLength > size) ? size : this->frameLength;
+	if (this->frameLength == 0) return ERR_E220_BUSY;
+
+	bool closed = (micros() - this->frameLastByte) >= this->getFrameGapMicros();
+	if (!closed && this->auxPin != -1) {
+		closed = this->isAuxHigh() && !this->serialDef.stream->available();
+	}
+	if (!closed) return ERR_E220_BUSY;
+
+	Status result = (this->frameLength > size) ? ERR_E220_PACKET_TOO_BIG : E220_SUCCESS;
+	E220_TRACE(TRACE_FRAME, result, this->frameLength)
+	this->frameLength = 0;
+	return result;
+}
+
+/*
+
+RSSI registers: C0 C1 C2 C3 + address + length in normal mode, answered with
+C1 + address + length + values. The answer shares the UART with the received
+packets, so the read starts only when nothing is arriving
+
+*/
+
+ResponseStatus LoRa_E220::requestRSSI(){
+	ResponseStatus rc;
+	if (this->mode != MODE_0_NORMAL || this->programDepth > 0) {
+		rc.code = ERR_E220_INVALID_PARAM;
+		return rc;
+	}
+	/* without the RSSI option the module would transmit the command as data */
+	if (this->configurationCached && this->cachedConfiguration.OPTION.RSSIAmbientNoise != RSSI_AMBIENT_NOISE_ENABLED) {
+		rc.code = ERR_E220_NOT_SUPPORT;
+		return rc;
+	}
+	if (this->isSendPending() || this->serialDef.stream->available() || (this->auxPin != -1 && !this->isAuxHigh())) {
+		rc.code = ERR_E220_BUSY;
 		return rc;
 	}
 
-//	rc.data = message; // malloc(sizeof (moduleInformation));
+	uint8_t command[6] = { 0xC0, 0xC1, 0xC2, 0xC3, E220_RSSI_REGISTER_AMBIENT, 2 };
+	rc.code = this->writeStruct(NULL, 0, command, sizeof(command));
+	return rc;
+}
+
+Status LoRa_E220::pollRSSI(byte &ambient, byte &lastPacket){
+	if (this->serialDef.stream->available() < 5) return ERR_E220_BUSY;
+
+	uint8_t answer[5];
+	if (this->serialDef.stream->readBytes(answer, sizeof(answer)) != sizeof(answer)) return ERR_E220_DATA_SIZE_NOT_MATCH;
+	if (RETURNED_COMMAND != answer[0] || E220_RSSI_REGISTER_AMBIENT != answer[1] || 2 != answer[2]) return ERR_E220_HEAD_NOT_RECOGNIZED;
+
+	ambient = answer[3];
+	lastPacket = answer[4];
+	E220_TRACE(TRACE_RSSI, ambient, lastPacket)
+	return E220_SUCCESS;
+}
+
+ResponseStatus LoRa_E220::readRSSI(byte &ambient, byte &lastPacket, unsigned long timeout){
+	ResponseStatus rc = this->requestRSSI();
+	if (rc.code!=E220_SUCCESS) return rc;
 
+	unsigned long t = millis();
+	while ((rc.code = this->pollRSSI(ambient, lastPacket)) == ERR_E220_BUSY) {
+		if ((millis() - t) > timeout) {
+			rc.code = ERR_E220_TIMEOUT;
+			break;
+		}
+		E220_AUX_IDLE();
+	}
 	return rc;
 }
 
+ResponseStatus LoRa_E220::readAmbientRSSI(byte &rssi, unsigned long timeout){
+	byte lastPacket;
+	return this->readRSSI(rssi, lastPacket, timeout);
+}
+
+ResponseStatus LoRa_E220::readLastPacketRSSI(byte &rssi, unsigned long timeout){
+	byte ambient;
+	return this->readRSSI(ambient, rssi, timeout);
+}
+
+ResponseStatus LoRa_E220::receiveFrame(void *buffer, uint16_t size, uint16_t &length, unsigned long timeout){
+	ResponseStatus status;
+	unsigned long t = millis();
+
+	while ((status.code = this->pollFrame(buffer, size, length)) == ERR_E220_BUSY) {
+		if (this->frameLength == 0 && (millis() - t) > timeout) {
+			status.code = ERR_E220_TIMEOUT;
+			break;
+		}
+		E220_AUX_IDLE();
+	}
+
+	return status;
+}
+
+void LoRa_E220::setAirDataRate(AIR_DATA_RATE airDataRate){
+	this->airDataRate = airDataRate;
+}
+
+unsigned long LoRa_E220::getFrameGapMicros(){
+	unsigned long airBps;
+	switch (this->airDataRate) {
+	case AIR_DATA_RATE_011_48:
+		airBps = 4800;
+		break;
+	case AIR_DATA_RATE_100_96:
+		airBps = 9600;
+		break;
+	case AIR_DATA_RATE_101_192:
+		airBps = 19200;
+		break;
+	case AIR_DATA_RATE_110_384:
+		airBps = 38400;
+		break;
+	case AIR_DATA_RATE_111_625:
+		airBps = 62500;
+		break;
+	default:
+		airBps = 2400;
+	}
+
+	// 10 bits per UART character (8N1), 8 bits per byte on air
+	return 4 * (10000000UL / (unsigned long)this->bpsRate) + 8000000UL / airBps;
+}
+
 ResponseContainer LoRa_E220::receiveMessageUntil(char delimiter){
 	ResponseContainer rc;
 	rc.status.code = E220_SUCCESS;
@@ -856,25 +1604,47 @@ ResponseStructContainer LoRa_E220::receiveMessage(const uint8_t size){
 ResponseStructContainer LoRa_E220::receiveMessageRSSI(const uint8_t size){
 	return LoRa_E220::receiveMessageComplete(size, true);
 }
+ResponseStatus LoRa_E220::receiveMessage(void *message, const uint8_t size){
+	return this->receiveInto(message, size, NULL);
+}
+ResponseStatus LoRa_E220::receiveMessageRSSI(void *message, const uint8_t size, byte &rssi){
+	return this->receiveInto(message, size, &rssi);
+}
 
 ResponseStructContainer LoRa_E220::receiveMessageComplete(const uint8_t size, bool rssiEnabled){
 	ResponseStructContainer rc;
 
 	rc.data = malloc(size);
-	rc.status.code = this->receiveStruct((uint8_t *)rc.data, size);
+	byte rssi = 0;
+	rc.status = this->receiveInto(rc.data, size, rssiEnabled ? &rssi : NULL);
 	if (rc.status.code!=E220_SUCCESS) {
 		return rc;
 	}
+	if (rssiEnabled) rc.rssi = rssi;
+
+	return rc;
+}
+
+/*
 
-	if (rssiEnabled){
+Receive directly into the caller's memory, shared by receiveMessageComplete()
+and the typed receive<T>()
 
-		char rssi[1];
+*/
+
+ResponseStatus LoRa_E220::receiveInto(void *message, uint16_t size, byte *rssi){
+	ResponseStatus status;
+	status.code = this->receiveStruct(message, size);
+	if (status.code!=E220_SUCCESS) {
+		return status;
+	}
+
+	if (rssi){
 		this->serialDef.stream->readBytes(rssi, 1);
-		rc.rssi = rssi[0];
 	}
-	 this->cleanUARTBuffer();
+	this->cleanUARTBuffer();
 
-	return rc;
+	return status;
 }
 
 ResponseStatus LoRa_E220::sendMessage(const void *message, const uint8_t size){
@@ -884,159 +1654,144 @@ ResponseStatus LoRa_E220::sendMessage(const void *message, const uint8_t size){
 
 	return status;
 }
-ResponseStatus LoRa_E220::sendMessage(const String message){
+ResponseStatus LoRa_E220::sendMessage(const String &message){
 	DEBUG_PRINT(F("Send message: "));
 	DEBUG_PRINT(message);
 	byte size = message.length(); // sizeof(message.c_str())+1;
 	DEBUG_PRINT(F(" size: "));
 	DEBUG_PRINTLN(size);
-	char messageFixed[size];
-	memcpy(messageFixed,message.c_str(),size);
-	DEBUG_PRINTLN(F(" memcpy "));
 
 	ResponseStatus status;
-	status.code = this->sendStruct((uint8_t *)&messageFixed, size);
+	status.code = this->sendStruct((void *)message.c_str(), size);
 	if (status.code!=E220_SUCCESS) return status;
 
-//	free(messageFixed);
 	return status;
 }
 
-ResponseStatus LoRa_E220::sendFixedMessage(byte ADDH, byte ADDL, byte CHAN, const String message){
-//	DEBUG_PRINT("String/size: ");
-//	DEBUG_PRINT(message);
-//	DEBUG_PRINT("/");
+ResponseStatus LoRa_E220::sendFixedMessage(byte ADDH, byte ADDL, byte CHAN, const String &message){
 	byte size = message.length(); // sizeof(message.c_str())+1;
-//	DEBUG_PRINTLN(size);
-//
-//	#pragma pack(push, 1)
-//	struct FixedStransmissionString {
-//		byte ADDH = 0;
-//		byte ADDL = 0;
-//		byte CHAN = 0;
-//		char message[];
-//	} fixedStransmission;
-//	#pragma pack(pop)
-//
-//	fixedStransmission.ADDH = ADDH;
-//	fixedStransmission.ADDL = ADDL;
-//	fixedStransmission.CHAN = CHAN;
-//	char* msg = (char*)message.c_str();
-//	memcpy(fixedStransmission.message, (char*)msg, size);
-////	fixedStransmission.message = message;
-//
-//	DEBUG_PRINT("Message: ");
-//	DEBUG_PRINTLN(fixedStransmission.message);
-//
-//	ResponseStatus status;
-//	status.code = this->sendStruct((uint8_t *)&fixedStransmission, sizeof(fixedStransmission));
-//	if (status.code!=E220_SUCCESS) return status;
-//
-//	return status;
-	char messageFixed[size];
-	memcpy(messageFixed,message.c_str(),size);
-	return this->sendFixedMessage(ADDH, ADDL, CHAN, (uint8_t *)messageFixed, size);
+	return this->sendFixedMessage(ADDH, ADDL, CHAN, message.c_str(), size);
 }
-ResponseStatus LoRa_E220::sendBroadcastFixedMessage(byte CHAN, const String message){
+ResponseStatus LoRa_E220::sendBroadcastFixedMessage(byte CHAN, const String &message){
 	return this->sendFixedMessage(BROADCAST_ADDRESS, BROADCAST_ADDRESS, CHAN, message);
 }
 
-typedef struct fixedStransmission
-{
-	byte ADDH = 0;
-	byte ADDL = 0;
-	byte CHAN = 0;
-	unsigned char message[];
-}FixedStransmission;
-
-FixedStransmission *init_stack(int m){
-	FixedStransmission *st = (FixedStransmission *)malloc(sizeof(FixedStransmission)+m*sizeof(int));
-    return st;
-}
-
 ResponseStatus LoRa_E220::sendFixedMessage( byte ADDH,byte ADDL, byte CHAN, const void *message, const uint8_t size){
-//	#pragma pack(push, 1)
-//	struct FixedStransmission {
-//		byte ADDH = 0;
-//		byte ADDL = 0;
-//		byte CHAN = 0;
-//		unsigned char message[];
-//	} fixedStransmission;
-//	#pragma pack(pop)
-
-
 	DEBUG_PRINT(ADDH);
 
-
-	FixedStransmission *fixedStransmission = init_stack(size);
-
-//	STACK *resize_stack(STACK *st, int m){
-//	    if (m<=st->max){
-//	         return st; /* Take sure do not kill old values */
-//	    }
-//	    STACK *st = (STACK *)realloc(sizeof(STACK)+m*sizeof(int));
-//	    st->max = m;
-//	    return st;
-//	}
-
-	fixedStransmission->ADDH = ADDH;
-	fixedStransmission->ADDL = ADDL;
-	fixedStransmission->CHAN = CHAN;
-//	fixedStransmission.message = &message;
-
-	memcpy(fixedStransmission->message,(unsigned char*)message,size);
+	// address header and payload go out as two writes, no copy and no heap
+	byte header[3] = { ADDH, ADDL, CHAN };
 
 	ResponseStatus status;
-	status.code = this->sendStruct((uint8_t *)fixedStransmission, size+3);
-
-	free(fixedStransmission);
-
+	status.code = this->sendStruct(header, sizeof(header), message, size);
 	if (status.code!=E220_SUCCESS) return status;
 
 	return status;
 }
 
-
-ConfigurationMessage *init_stack_conf(int m){
-	ConfigurationMessage *st = (ConfigurationMessage *)malloc(sizeof(ConfigurationMessage)+m*sizeof(int));
-    return st;
-}
-
 ResponseStatus LoRa_E220::sendConfigurationMessage( byte ADDH,byte ADDL, byte CHAN, Configuration *configuration, PROGRAM_COMMAND programCommand){
 	ResponseStatus rc;
 
-//	rc.code = this->setMode(MODE_2_PROGRAM);
-//	if (rc.code!=E220_SUCCESS) return rc;
-
 	configuration->COMMAND = programCommand;
 	configuration->STARTING_ADDRESS = REG_ADDRESS_CFG;
 	configuration->LENGHT = PL_CONFIGURATION;
 
-	ConfigurationMessage *fixedStransmission = init_stack_conf(sizeof(Configuration));
+	byte header[5] = { ADDH, ADDL, CHAN, SPECIAL_WIFI_CONF_COMMAND, SPECIAL_WIFI_CONF_COMMAND };
 
-//	fixedStransmission.message = &message;
+	DEBUG_PRINTLN(sizeof(Configuration)+2);
 
+	rc.code = this->sendStruct(header, sizeof(header), configuration, sizeof(Configuration));
 
-	memcpy(fixedStransmission->message,(unsigned char*)configuration,sizeof(Configuration));
+	return rc;
+}
 
-	fixedStransmission->specialCommand1 = SPECIAL_WIFI_CONF_COMMAND;
-	fixedStransmission->specialCommand2 = SPECIAL_WIFI_CONF_COMMAND;
+ResponseStatus LoRa_E220::sendBroadcastFixedMessage(byte CHAN, const void *message, const uint8_t size){
+	return this->sendFixedMessage(0xFF, 0xFF, CHAN, message, size);
+}
 
-	DEBUG_PRINTLN(sizeof(Configuration)+2);
+/*
 
-	rc = sendFixedMessage(ADDH, ADDL, CHAN, fixedStransmission, sizeof(Configuration)+2);
-//
-//	ResponseStatus status;
-//	status.code = this->sendStruct((uint8_t *)fixedStransmission, sizeof(Configuration)+5);
-//	if (status.code!=E220_SUCCESS) return status;
+Non-blocking send: beginSend() only writes the data, poll() then walks the
+same AUX/timeout steps of waitCompleteResponse() without spinning
 
-//	free(fixedStransmission);
+*/
 
-	return rc;
+ResponseStatus LoRa_E220::beginSend(const void *message, const uint8_t size){
+	return this->beginSendStruct(NULL, 0, message, size);
 }
 
-ResponseStatus LoRa_E220::sendBroadcastFixedMessage(byte CHAN, const void *message, const uint8_t size){
-	return this->sendFixedMessage(0xFF, 0xFF, CHAN, message, size);
+ResponseStatus LoRa_E220::beginSendFixedMessage(byte ADDH, byte ADDL, byte CHAN, const void *message, const uint8_t size){
+	byte header[3] = { ADDH, ADDL, CHAN };
+	return this->beginSendStruct(header, sizeof(header), message, size);
+}
+
+ResponseStatus LoRa_E220::beginSendStruct(const void *header, uint8_t headerSize, const void *message, uint16_t size){
+	ResponseStatus status;
+	if (this->isSendPending()) {
+		status.code = ERR_E220_BUSY;
+		return status;
+	}
+
+	if (headerSize + size > MAX_SIZE_TX_PACKET + 2) {
+		status.code = ERR_E220_PACKET_TOO_BIG;
+	} else {
+		status.code = this->writeStruct(header, headerSize, message, size);
+	}
+	this->sendStatus = status.code;
+	this->sendStateTime = millis();
+	this->sendState = (status.code == E220_SUCCESS) ? SEND_WAIT_AUX : SEND_FAILED;
+	E220_TRACE(TRACE_SEND_BEGIN, status.code, headerSize + size)
+
+	return status;
+}
+
+SEND_STATE LoRa_E220::poll(){
+	switch (this->sendState) {
+	case SEND_WAIT_AUX:
+		if (this->auxPin != -1) {
+			if (!this->isAuxHigh()) {
+				if ((millis() - this->sendStateTime) > SEND_AUX_TIMEOUT) {
+					DEBUG_PRINTLN("Timeout error!");
+					this->sendStatus = ERR_E220_TIMEOUT;
+					this->sendState = SEND_FAILED;
+					E220_TRACE(TRACE_SEND_END, this->sendStatus, millis() - this->sendStateTime)
+				}
+				break;
+			}
+			DEBUG_PRINTLN("AUX HIGH!");
+		} else if ((millis() - this->sendStateTime) < SEND_NO_AUX_DELAY) {
+			break;
+		}
+		this->sendStateTime = millis();
+		this->sendState = SEND_GUARD_TIME;
+		// fall through
+	case SEND_GUARD_TIME:
+		if ((millis() - this->sendStateTime) < AUX_GUARD_TIME) break;
+
+		this->cleanUARTBuffer();
+		this->sendStatus = E220_SUCCESS;
+		this->sendState = SEND_COMPLETE;
+		E220_TRACE(TRACE_SEND_END, this->sendStatus, millis() - this->sendStateTime)
+		DEBUG_PRINTLN(F("Complete!"));
+		break;
+	default:
+		break;
+	}
+	return this->sendState;
+}
+
+SEND_STATE LoRa_E220::getSendState(){
+	return this->sendState;
+}
+
+bool LoRa_E220::isSendPending(){
+	return this->sendState == SEND_WAIT_AUX || this->sendState == SEND_GUARD_TIME;
+}
+
+ResponseStatus LoRa_E220::getSendStatus(){
+	ResponseStatus status;
+	status.code = this->isSendPending() ? ERR_E220_BUSY : this->sendStatus;
+	return status;
 }
 
 #define KeeLoq_NLF		0x3A5C742E
@@ -66,6 +66,7 @@
 #endif
 
 #include <includes/statesNaming.h>
+#include "LoRa_E220_Trace.h"
 
 #if ARDUINO >= 100
 #include "Arduino.h"
@@ -80,6 +81,18 @@
  */
 #define MAX_SIZE_TX_PACKET 200
 
+/**
+ * @brief Compile-time check used by the typed send<T>()/receive<T>() templates
+ *
+ * A message type must be trivially copyable to be sent byte by byte.
+ * GCC before 5 (older ESP8266 toolchains) only provides __has_trivial_copy.
+ */
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ < 5
+	#define E220_IS_TRIVIALLY_COPYABLE(T) __has_trivial_copy(T)
+#else
+	#define E220_IS_TRIVIALLY_COPYABLE(T) __is_trivially_copyable(T)
+#endif
+
 /**
  * @brief Debug output configuration
  * 
@@ -120,6 +133,14 @@
 	#define DEBUG_PRINTLN(...) {}
 #endif
 
+/**
+ * @brief Binary event trace
+ *
+ * Define LoRa_E220_TRACE (build flag) to record the mode switches, AUX
+ * edges and waits, UART transfers and configuration commands in the RAM
+ * ring of LoRa_E220_Trace instead of printing them: see LoRa_E220_Trace.h.
+ */
+
 /**
  * @brief Operating mode types for the E220 LoRa module
  * 
@@ -130,7 +151,7 @@
  * - MODE_3: Configuration/programming mode (M0=1, M1=1)
  * 
  * @note Mode changes require physical control of M0/M1 pins or software commands
- * @warning Configuration mode (MODE_3) requires 9600 bps UART speed
+ * @note Configuration mode (MODE_3) runs at 9600 bps; the configuration calls switch the host UART to it and back
  */
 enum MODE_TYPE {
 	MODE_0_NORMAL 			= 0,  ///< Normal transmission mode - default operating mode
@@ -145,6 +166,26 @@ enum MODE_TYPE {
 	MODE_INIT 				= 0xFF ///< Internal initialization state
 };
 
+/**
+ * @brief States of the non-blocking send state machine
+ *
+ * A send started with beginSend() walks through these states while the
+ * application keeps calling poll() from its loop:
+ * - SEND_WAIT_AUX: Data written to UART, waiting for AUX HIGH (or the no-AUX delay)
+ * - SEND_GUARD_TIME: AUX is HIGH, waiting the guard time required by the datasheet
+ * - SEND_COMPLETE / SEND_FAILED: Final states, result available via getSendStatus()
+ *
+ * @note Uses the same AUX and timeout rules as the blocking sendMessage()
+ * @see LoRa_E220::beginSend(), LoRa_E220::poll()
+ */
+enum SEND_STATE {
+	SEND_IDLE 				= 0,  ///< No send started yet
+	SEND_WAIT_AUX 			= 1,  ///< Waiting for the module to finish transmission
+	SEND_GUARD_TIME 		= 2,  ///< Waiting the post-AUX guard time
+	SEND_COMPLETE 			= 3,  ///< Send completed successfully
+	SEND_FAILED 			= 4   ///< Send failed (timeout or UART error)
+};
+
 /**
  * @brief Programming commands for device configuration
  * 
@@ -171,9 +212,9 @@ enum PROGRAM_COMMAND {
  * These addresses define the memory locations of configuration parameters:
  * - REG_ADDRESS_CFG: Base configuration address (0x00)
  * - REG_ADDRESS_SPED: Speed settings (UART baud rate, air data rate, parity)
- * - REG_ADDRESS_TRANS_MODE: Transmission mode settings (fixed/transparent, RSSI, LBT)
- * - REG_ADDRESS_CHANNEL: Operating frequency channel (0-255)
  * - REG_ADDRESS_OPTION: Additional options (transmission power, sub-packet size)
+ * - REG_ADDRESS_CHANNEL: Operating frequency channel (0-255)
+ * - REG_ADDRESS_TRANS_MODE: Transmission mode settings (fixed/transparent, RSSI, LBT)
  * - REG_ADDRESS_CRYPT: Encryption key settings
  * - REG_ADDRESS_PID: Product identification
  * 
@@ -183,9 +224,9 @@ enum PROGRAM_COMMAND {
 enum REGISTER_ADDRESS {
 	REG_ADDRESS_CFG			= 0x00,  ///< Base configuration register address
 	REG_ADDRESS_SPED 		= 0x02,  ///< Speed configuration register (UART + Air data rate)
-	REG_ADDRESS_TRANS_MODE 	= 0x03,  ///< Transmission mode register (Fixed/Transparent, RSSI, LBT)
+	REG_ADDRESS_OPTION	 	= 0x03,  ///< Option register (power, sub-packet settings)
 	REG_ADDRESS_CHANNEL 	= 0x04,  ///< Channel register (operating frequency)
-	REG_ADDRESS_OPTION	 	= 0x05,  ///< Option register (power, sub-packet settings)
+	REG_ADDRESS_TRANS_MODE 	= 0x05,  ///< Transmission mode register (Fixed/Transparent, RSSI, LBT)
 	REG_ADDRESS_CRYPT	 	= 0x06,  ///< Encryption register (security key)
 	REG_ADDRESS_PID		 	= 0x08   ///< Product identification register
 };
@@ -560,10 +601,13 @@ struct ResponseStatus {
  * }
  * response.close(); // Always free memory!
  * @endcode
+ *
+ * @see getConfiguration(Configuration&), getModuleInformation(ModuleInformation&)
+ *      and receiveMessage(void*, uint8_t) to read into the caller's memory instead
  */
 struct ResponseStructContainer {
-	void *data;           ///< Pointer to response data (cast to appropriate struct type)
-	byte rssi;            ///< Received Signal Strength Indicator (dBm)
+	void *data = NULL;    ///< Pointer to response data (cast to appropriate struct type)
+	byte rssi = 0;        ///< Received Signal Strength Indicator (dBm)
 	ResponseStatus status; ///< Operation status and error information
 	
 	/**
@@ -573,6 +617,7 @@ struct ResponseStructContainer {
 	 */
 	void close() {
 		free(this->data);
+		this->data = NULL;
 	}
 };
 
@@ -634,6 +679,134 @@ struct ConfigurationMessage
  */
 #pragma pack(pop)
 
+/**
+ * @brief Milliseconds readRSSI() waits for the answer of the module
+ */
+#ifndef E220_RSSI_TIMEOUT
+	#define E220_RSSI_TIMEOUT 50
+#endif
+
+/**
+ * @brief RSSI registers read in normal mode with C0 C1 C2 C3
+ */
+#define E220_RSSI_REGISTER_AMBIENT 0x00
+#define E220_RSSI_REGISTER_LAST_PACKET 0x01
+
+/**
+ * @brief Size of the AUX edge buffer (must be a power of two)
+ */
+#ifndef AUX_EDGE_BUFFER_SIZE
+	#define AUX_EDGE_BUFFER_SIZE 8
+#endif
+
+/**
+ * @brief Hook called while waiting for AUX in interrupt mode
+ *
+ * Redefine it to put the CPU to sleep until the next interrupt (the AUX edge
+ * wakes it up). The waits run in LoRa_E220.cpp, so it must be a build flag
+ * that the library sources see too, not a define in the sketch, e.g. in
+ * platformio.ini:
+ * @code
+ * build_flags = -include avr/sleep.h '-DE220_AUX_IDLE()=sleep_cpu()'
+ * @endcode
+ */
+#ifndef E220_AUX_IDLE
+	#define E220_AUX_IDLE() yield()
+#endif
+
+/**
+ * @brief AUX edge recorded by the AUX interrupt
+ * @see LoRa_E220::readAuxEdge()
+ */
+struct AuxEdge {
+	unsigned long time; ///< micros() when the edge was detected
+	byte level;         ///< New AUX level: HIGH (busy -> idle) or LOW (idle -> busy)
+};
+
+/**
+ * @brief Latency instrumentation
+ *
+ * Define LoRa_E220_PROFILE (build flag, so the library sources see it too)
+ * to time the phases of each operation with micros() and aggregate them in
+ * the ProfileStats of the instance (getProfile()). Without it the macros,
+ * the member and the accessors compile to nothing.
+ *
+ * @code
+ * build_flags = -DLoRa_E220_PROFILE
+ * @endcode
+ */
+//#define LoRa_E220_PROFILE
+
+/**
+ * @brief Histogram buckets of a phase: bucket i counts durations of 2^i to 2^(i+1)-1 us
+ * @note The last bucket also counts the longer durations
+ */
+#ifndef E220_PROFILE_BUCKETS
+	#define E220_PROFILE_BUCKETS 24
+#endif
+
+/**
+ * @brief Phases timed by the instrumentation; the operations contain the phases
+ *
+ * A phase is recorded when it completes: timeouts and errors are not counted.
+ */
+enum PROFILE_PHASE {
+	PROFILE_UART_WRITE 		= 0,  ///< Bytes handed to the UART (writeStruct)
+	PROFILE_UART_READ 		= 1,  ///< Answer read from the UART (receiveStruct, writeRegisters)
+	PROFILE_AUX_BUSY 		= 2,  ///< AUX LOW after a write, or the delay used without AUX
+	PROFILE_GUARD_DELAY 	= 3,  ///< Guard delays after AUX HIGH
+	PROFILE_MODE_SWITCH 	= 4,  ///< Complete mode transition (switchMode)
+	PROFILE_PROGRAM_COMMAND = 5,  ///< Program mode command (writeProgramCommand)
+	PROFILE_SEND 			= 6,  ///< Blocking send, write to AUX HIGH (transmitStruct)
+	PROFILE_RECEIVE 		= 7,  ///< Blocking structure receive (receiveStruct)
+	PROFILE_PHASES 			= 8
+};
+
+/**
+ * @brief Aggregated durations of one phase, in microseconds
+ */
+struct PhaseStats {
+	unsigned long count;
+	unsigned long min;
+	unsigned long max;
+	uint64_t sum;
+	uint16_t histogram[E220_PROFILE_BUCKETS];  ///< Saturates at 65535
+
+	void record(unsigned long duration) {
+		if (this->count == 0 || duration < this->min) this->min = duration;
+		if (duration > this->max) this->max = duration;
+		this->count++;
+		this->sum += duration;
+
+		uint8_t bucket = 0;
+		while (duration > 1 && bucket < E220_PROFILE_BUCKETS - 1) {
+			duration >>= 1;
+			bucket++;
+		}
+		if (this->histogram[bucket] < 0xFFFF) this->histogram[bucket]++;
+	}
+
+	/** Mean duration, 0 without samples */
+	unsigned long getMean() const { return this->count == 0 ? 0 : (unsigned long)(this->sum / this->count); }
+};
+
+/**
+ * @brief Durations of every phase of an instance
+ */
+struct ProfileStats {
+	PhaseStats phases[PROFILE_PHASES];
+
+	void clear() { memset(this->phases, 0, sizeof(this->phases)); }
+};
+
+#ifdef LoRa_E220_PROFILE
+	#define E220_PROFILE_START(timer) unsigned long timer = micros();
+	#define E220_PROFILE_END(phase, timer) { this->profile.phases[phase].record(micros() - timer); }
+#else
+	#define E220_PROFILE_START(timer)
+	#define E220_PROFILE_END(phase, timer)
+#endif
+
 /**
  * @brief Main LoRa E220 device interface class
  * 
@@ -668,7 +841,8 @@ struct ConfigurationMessage
  *       - Configuration (M0=1, M1=1): Parameter setup mode
  * 
  * @warning Always check response status codes before using operation results
- * @warning Configuration mode requires 9600 bps UART speed regardless of other settings
+ * @note Configuration mode runs at 9600 bps regardless of other settings; the
+ *       configuration calls switch the host UART to it and back
  * 
  * @example Basic usage:
  * @code
@@ -961,13 +1135,21 @@ class LoRa_E220 {
  */
 		/**
 		 * @brief Initialize the LoRa E220 device
+		 * @param auxInterrupt Track the AUX pin with an edge interrupt instead of polling it (default: false)
 		 * @return true if initialization successful, false otherwise
 		 * 
 		 * This method initializes the serial communication and prepares the device
 		 * for operation. Must be called before any other device operations.
 		 * 
+		 * With auxInterrupt enabled, AUX edges are timestamped by an interrupt into a
+		 * small lock-free buffer (see readAuxEdge()). Waiting for the module then checks
+		 * a flag instead of calling digitalRead(), and E220_AUX_IDLE() runs while waiting
+		 * so the CPU can sleep until the next edge.
+		 * 
 		 * @note Call this method in setup() function after Serial.begin()
 		 * @note Automatically configures serial interface and checks device status
+		 * @note Only one instance at a time can use auxInterrupt; if the AUX pin has no
+		 *       interrupt the library falls back to polling
 		 * 
 		 * @example Device initialization:
 		 * @code
@@ -981,7 +1163,61 @@ class LoRa_E220 {
 		 * }
 		 * @endcode
 		 */
-		bool begin();
+		bool begin(bool auxInterrupt = false);
+
+		/**
+		 * @brief Initialize the device and negotiate the fastest UART rate
+		 * @param maxBpsRate Highest rate the host UART handles reliably
+		 * @param auxInterrupt See begin(bool)
+		 * @return true if initialization and negotiation succeeded
+		 *
+		 * Same as begin(bool) followed by negotiateBaudRate(maxBpsRate).
+		 *
+		 * @example Full speed data path at 62.5 kbps on air:
+		 * @code
+		 * LoRa_E220 e220ttl(&Serial2, 15, 21, 19);  // constructed at 9600
+		 *
+		 * void setup() {
+		 *     e220ttl.begin(UART_BPS_RATE_115200);
+		 * }
+		 * @endcode
+		 */
+		bool begin(UART_BPS_RATE maxBpsRate, bool auxInterrupt = false);
+
+		/**
+		 * @brief Move the data link to the fastest UART rate both ends support
+		 * @param maxBpsRate Highest rate the host UART handles reliably
+		 *        (SoftwareSerial on 8-bit boards: 38400 at most)
+		 * @param saveType WRITE_CFG_PWR_DWN_LOSE (default) returns the module to its
+		 *        saved rate on power cycle; the negotiation recovers from either
+		 * @return ResponseStatus indicating success or failure;
+		 *         ERR_E220_WRONG_UART_CONFIG if the module did not answer at the
+		 *         new rate and both ends were moved back to 9600
+		 *
+		 * Reads the configuration at 9600 bps, writes SPED.uartBaudRate = maxBpsRate
+		 * if the module is not already there, reads it back to verify, and reopens
+		 * the host UART at the new rate, all in one program mode session. At high air
+		 * data rates a 9600 bps UART is the bottleneck of the link.
+		 *
+		 * Program mode always runs at 9600, so after a change the data path is
+		 * checked with an RSSI register read in normal mode (readRSSI()); it
+		 * needs RSSI ambient noise enabled and the device in normal mode,
+		 * otherwise the new rate is kept unchecked.
+		 *
+		 * @note Program mode always runs at 9600: later configuration calls switch
+		 *       the host UART down and back automatically
+		 */
+		ResponseStatus negotiateBaudRate(UART_BPS_RATE maxBpsRate = UART_BPS_RATE_115200, PROGRAM_COMMAND saveType = WRITE_CFG_PWR_DWN_LOSE);
+
+		/**
+		 * @brief UART rate of the data link, as last configured or read from the module
+		 */
+		UART_BPS_RATE getBpsRate();
+
+		/**
+		 * @brief Detach the AUX interrupt if this instance owns it
+		 */
+		~LoRa_E220();
 		
 		/**
 		 * @brief Set device operating mode
@@ -992,8 +1228,11 @@ class LoRa_E220 {
 		 * Different modes provide various power consumption and functionality characteristics.
 		 * 
 		 * @note MODE_3_CONFIGURATION required for parameter changes
-		 * @note Mode changes may take several milliseconds to complete
-		 * @warning Configuration mode requires 9600 bps UART speed
+		 * @note With the AUX pin it returns 2 ms after AUX goes back HIGH (a few ms
+		 *       in total); without it after a fixed 200 ms, or the time measured by
+		 *       calibrateModeSwitch() / set by setModeSwitchMicros()
+		 * @warning Only drives the pins: use enterProgramMode() to also switch
+		 *       the host UART to the 9600 bps of configuration mode
 		 * 
 		 * @example Setting device mode:
 		 * @code
@@ -1022,6 +1261,35 @@ class LoRa_E220 {
          * @endcode
          */
         MODE_TYPE getMode();
+
+		/**
+		 * @brief Measure the mode transition time of the module on AUX
+		 * @param rounds Round trips to program mode and back
+		 * @return Worst time in microseconds from the M0/M1 change to AUX HIGH,
+		 *         0 without AUX or M0/M1 pins, or on timeout
+		 *
+		 * The result is kept (getModeSwitchMicros()); boards of the same design
+		 * without the AUX pin wired can use it through setModeSwitchMicros()
+		 * instead of the fixed delay.
+		 *
+		 * @example Measuring on a bench board:
+		 * @code
+		 * Serial.print("Mode switch us: ");
+		 * Serial.println(e220ttl.calibrateModeSwitch());
+		 * @endcode
+		 */
+		unsigned long calibrateModeSwitch(uint8_t rounds = 4);
+
+		/**
+		 * @brief Set the mode transition time used when there is no AUX pin
+		 * @param modeSwitchMicros Time measured by calibrateModeSwitch(), 0 for the fixed delay
+		 */
+		void setModeSwitchMicros(unsigned long modeSwitchMicros);
+
+		/**
+		 * @brief Mode transition time measured or set, 0 if none
+		 */
+		unsigned long getModeSwitchMicros();
 /** @} */ // End of Device Initialization and Mode Control group
 
 /**
@@ -1042,7 +1310,7 @@ class LoRa_E220 {
 		 * - Encryption configuration
 		 * 
 		 * @note Device must be in configuration mode (MODE_3_CONFIGURATION)
-		 * @note UART must be set to 9600 bps for configuration operations
+		 * @note The host UART is switched to 9600 bps for the operation and back
 		 * @warning Always call close() on the returned container to free memory
 		 * 
 		 * @example Reading configuration:
@@ -1060,6 +1328,23 @@ class LoRa_E220 {
 		 * @endcode
 		 */
 		ResponseStructContainer getConfiguration();
+
+		/**
+		 * @brief Read the current configuration into the caller's struct
+		 * @param configuration Filled with the configuration read from the device
+		 * @return ResponseStatus indicating success or failure
+		 *
+		 * Same as getConfiguration() without the heap allocation and close().
+		 *
+		 * @example Reading configuration:
+		 * @code
+		 * Configuration configuration;
+		 * if (e220ttl.getConfiguration(configuration).code == E220_SUCCESS) {
+		 *     Serial.print("Channel: "); Serial.println(configuration.CHAN);
+		 * }
+		 * @endcode
+		 */
+		ResponseStatus getConfiguration(Configuration &configuration);
 		
 		/**
 		 * @brief Write device configuration
@@ -1091,6 +1376,169 @@ class LoRa_E220 {
 		 * @endcode
 		 */
 		ResponseStatus setConfiguration(Configuration configuration, PROGRAM_COMMAND saveType = WRITE_CFG_PWR_DWN_LOSE);
+
+		/**
+		 * @brief Write only the registers that differ from the cached configuration
+		 * @param configuration Wanted configuration (all 8 registers)
+		 * @param saveType Save method (WRITE_CFG_PWR_DWN_LOSE or WRITE_CFG_PWR_DWN_SAVE)
+		 * @param writeUnknownCrypt Write CRYPT when the key on the module is unknown;
+		 *        false leaves it alone, for a configuration read back (key 0)
+		 * @return ResponseStatus of the first failed command, E220_SUCCESS when
+		 *         all changed registers are written (or nothing changed)
+		 *
+		 * Compares with getCachedConfiguration() (reading the device when nothing
+		 * is cached) and sends one command per contiguous run of changed
+		 * registers: changing the channel writes 4 bytes instead of 11, and with
+		 * WRITE_CFG_PWR_DWN_SAVE the module persists only that register.
+		 * Nothing is sent, and program mode is not entered, when nothing changed.
+		 *
+		 * @note CRYPT is write only: it is compared with the key last written by
+		 *       setConfiguration() or updateConfiguration(), and written when the
+		 *       key is unknown (after a read) unless writeUnknownCrypt is false
+		 *
+		 * @example Changing channel:
+		 * @code
+		 * Configuration configuration;
+		 * e220ttl.getCachedConfiguration(configuration);
+		 * configuration.CHAN = 40;
+		 * e220ttl.updateConfiguration(configuration);
+		 * @endcode
+		 */
+		ResponseStatus updateConfiguration(Configuration configuration, PROGRAM_COMMAND saveType = WRITE_CFG_PWR_DWN_LOSE, bool writeUnknownCrypt = true);
+
+		/**
+		 * @brief Make the module hold a configuration, writing only what differs
+		 * @param configuration Wanted configuration (all 8 registers)
+		 * @param saveType Save method, WRITE_CFG_PWR_DWN_SAVE to enforce it across power cycles
+		 * @param written Set to true if any register was sent, false otherwise (optional)
+		 * @param writeUnknownCrypt Write CRYPT when the key on the module is unknown
+		 *        (see the note); false leaves it alone
+		 * @return ResponseStatus of the first failed command, E220_SUCCESS when
+		 *         the module holds the configuration, the key excepted when it
+		 *         was unknown and not written
+		 *
+		 * Meant for boot: reads the registers once (not the cache, which may be
+		 * stale after a reset of the module), compares and writes only the
+		 * contiguous runs that differ, all in one program mode session. A node
+		 * that already holds its settings costs one read and no EEPROM write.
+		 *
+		 * @note CRYPT is write only and cannot be compared: it is written when
+		 *       it differs from a key written earlier by this object, or when no
+		 *       key was written yet and writeUnknownCrypt is true. After a reset
+		 *       of the microcontroller the key is unknown again, so with
+		 *       writeUnknownCrypt and WRITE_CFG_PWR_DWN_SAVE every boot costs
+		 *       one EEPROM write of the key.
+		 * @note The read returns the running registers: a temporary change
+		 *       (WRITE_CFG_PWR_DWN_LOSE) that matches is not saved again
+		 *
+		 * @example Enforcing settings on every boot:
+		 * @code
+		 * bool written;
+		 * ResponseStatus rs = e220ttl.ensureConfiguration(configuration, WRITE_CFG_PWR_DWN_SAVE, &written);
+		 * if (rs.code == E220_SUCCESS && written) {
+		 *     Serial.println("Configuration updated");
+		 * }
+		 * @endcode
+		 */
+		ResponseStatus ensureConfiguration(Configuration configuration, PROGRAM_COMMAND saveType = WRITE_CFG_PWR_DWN_SAVE, bool *written = NULL, bool writeUnknownCrypt = false);
+
+		/**
+		 * @brief Change channel with a single one-register write
+		 * @param CHAN Channel number (0-255)
+		 * @param temporary true for WRITE_CFG_PWR_DWN_LOSE (no EEPROM write), false to save it
+		 * @return ResponseStatus indicating success or failure
+		 *
+		 * Writes only REG_ADDRESS_CHANNEL, without reading the configuration
+		 * first, checks the 4-byte answer and goes back to the previous mode.
+		 * A temporary change is not sent when the cached configuration already
+		 * has the channel; a saved one always is (the cache does not tell
+		 * whether the module saved it).
+		 *
+		 * @example Hopping between collection channels:
+		 * @code
+		 * for (byte i = 0; i < sizeof(channels); i++) {
+		 *     if (e220ttl.setChannel(channels[i]).code == E220_SUCCESS) {
+		 *         collect();
+		 *     }
+		 * }
+		 * @endcode
+		 */
+		ResponseStatus setChannel(byte CHAN, bool temporary = true);
+
+		/**
+		 * @brief Enter program mode for several configuration calls
+		 * @return Status indicating success or failure
+		 *
+		 * Configuration mode always talks at 9600 bps: with another data rate the
+		 * host UART is reopened at 9600 here and at the data rate on exit
+		 * (HardwareSerial::updateBaudRate() on ESP32, begin() otherwise). The
+		 * data rate follows SPED.uartBaudRate of the configuration read or
+		 * written in between, so writing a new UART speed keeps the link.
+		 *
+		 * getConfiguration(), setConfiguration(), getModuleInformation() and the
+		 * other configuration calls made before the matching exitProgramMode()
+		 * run without switching mode: reading the information, reading and
+		 * writing the configuration costs two mode changes instead of six.
+		 * Calls nest; the mode changes only on the outermost pair.
+		 *
+		 * @see LoRa_E220_ConfigSession, which calls exitProgramMode() on scope exit
+		 */
+		Status enterProgramMode();
+
+		/**
+		 * @brief Leave program mode entered with enterProgramMode(), restoring the previous mode and UART rate
+		 * @return Status, ERR_E220_INVALID_PARAM without a matching enterProgramMode()
+		 */
+		Status exitProgramMode();
+
+		/**
+		 * @brief Inside enterProgramMode()/exitProgramMode()
+		 */
+		bool isProgramMode();
+
+		/**
+		 * @brief Get the configuration last read or written, without switching mode
+		 * @param configuration Filled with the cached configuration
+		 * @return ResponseStatus, E220_SUCCESS straight from the cache; when
+		 *         nothing is cached the device is read first (refreshConfiguration())
+		 *
+		 * getConfiguration() and setConfiguration() keep a copy of the answer of
+		 * the device, so checking the channel or the address costs a copy instead
+		 * of the program mode round trip (some hundred ms, radio deaf).
+		 *
+		 * @note Changes the library cannot see (power cycle after a
+		 *       WRITE_CFG_PWR_DWN_LOSE, remote configuration) need
+		 *       invalidateConfiguration() or refreshConfiguration()
+		 * @note CRYPT is write only: cached as last written by setConfiguration()
+		 *       or updateConfiguration(), as read back (0) after getConfiguration()
+		 *
+		 * @example Checking the channel in the loop:
+		 * @code
+		 * Configuration configuration;
+		 * if (e220ttl.getCachedConfiguration(configuration).code == E220_SUCCESS
+		 *         && configuration.CHAN != wantedChannel) {
+		 *     configuration.CHAN = wantedChannel;
+		 *     e220ttl.setConfiguration(configuration);
+		 * }
+		 * @endcode
+		 */
+		ResponseStatus getCachedConfiguration(Configuration &configuration);
+
+		/**
+		 * @brief Read the configuration from the device into the cache
+		 * @return ResponseStatus of getConfiguration()
+		 */
+		ResponseStatus refreshConfiguration();
+
+		/**
+		 * @brief Forget the cached configuration, the next getCachedConfiguration() reads the device
+		 */
+		void invalidateConfiguration();
+
+		/**
+		 * @brief A configuration is cached
+		 */
+		bool isConfigurationCached();
 /** @} */ // End of Configuration Management group
 
 /**
@@ -1124,6 +1572,15 @@ class LoRa_E220 {
 		 * @endcode
 		 */
 		ResponseStructContainer getModuleInformation();
+
+		/**
+		 * @brief Read the module information into the caller's struct
+		 * @param moduleInformation Filled with the information read from the device
+		 * @return ResponseStatus indicating success or failure
+		 *
+		 * Same as getModuleInformation() without the heap allocation and close().
+		 */
+		ResponseStatus getModuleInformation(ModuleInformation &moduleInformation);
 		
 		/**
 		 * @brief Reset device to default settings
@@ -1253,6 +1710,35 @@ class LoRa_E220 {
 		 * @endcode
 		 */
 		ResponseStructContainer receiveMessageRSSI(const uint8_t size);
+
+		/**
+		 * @brief Receive fixed-size binary message into the caller's buffer
+		 * @param message Buffer of at least size bytes
+		 * @param size Number of bytes to receive
+		 * @return ResponseStatus indicating success or failure
+		 *
+		 * Same as receiveMessage(size) without the heap allocation and close().
+		 *
+		 * @example Receiving a structure:
+		 * @code
+		 * MessageTemperature message;
+		 * if (e220ttl.receiveMessage(&message, sizeof(message)).code == E220_SUCCESS) {
+		 *     Serial.println(message.temperature);
+		 * }
+		 * @endcode
+		 */
+		ResponseStatus receiveMessage(void *message, const uint8_t size);
+
+		/**
+		 * @brief Receive fixed-size binary message and RSSI into the caller's memory
+		 * @param message Buffer of at least size bytes
+		 * @param size Number of bytes to receive
+		 * @param rssi Set to the RSSI byte appended by the module
+		 * @return ResponseStatus indicating success or failure
+		 *
+		 * @note RSSI must be enabled in device configuration
+		 */
+		ResponseStatus receiveMessageRSSI(void *message, const uint8_t size, byte &rssi);
 	        
         /**
          * @brief Receive complete message with optional RSSI
@@ -1319,7 +1805,7 @@ class LoRa_E220 {
 		 * }
 		 * @endcode
 		 */
-		ResponseStatus sendMessage(const String message);
+		ResponseStatus sendMessage(const String &message);
 		
 		/**
 		 * @brief Receive available string message
@@ -1361,6 +1847,115 @@ class LoRa_E220 {
 		 * @endcode
 		 */
 		ResponseContainer receiveMessageRSSI();
+
+		/**
+		 * @brief Collect a received packet without blocking
+		 * @param buffer Caller's buffer, the same one on every call until the frame completes
+		 * @param size Size of the buffer
+		 * @param length Set to the number of bytes stored in the buffer
+		 * @return E220_SUCCESS when a frame is complete, ERR_E220_BUSY while it is
+		 *         not (no data yet or still arriving), ERR_E220_PACKET_TOO_BIG when
+		 *         the completed frame did not fit (extra bytes are dropped)
+		 *
+		 * Moves the bytes available on the UART into the buffer. The frame is
+		 * closed when no byte arrived for getFrameGapMicros(), or as soon as the
+		 * UART is drained with AUX back HIGH (the module finished its output).
+		 *
+		 * @note With the RSSI byte enabled, it is the last byte of the frame
+		 *
+		 * @example Receiving from the loop:
+		 * @code
+		 * uint8_t frame[MAX_SIZE_TX_PACKET + 1];
+		 * uint16_t length;
+		 *
+		 * void loop() {
+		 *     if (e220ttl.pollFrame(frame, sizeof(frame), length) == E220_SUCCESS) {
+		 *         // Process length bytes...
+		 *     }
+		 *     // Other work...
+		 * }
+		 * @endcode
+		 */
+		Status pollFrame(void *buffer, uint16_t size, uint16_t &length);
+
+		/**
+		 * @brief Receive a packet into the caller's buffer
+		 * @param buffer Caller's buffer
+		 * @param size Size of the buffer
+		 * @param length Set to the number of bytes stored in the buffer
+		 * @param timeout Milliseconds to wait for the first byte
+		 * @return ResponseStatus, ERR_E220_TIMEOUT if no byte arrived
+		 *
+		 * Blocking version of pollFrame(): returns a few character times after
+		 * the last byte instead of waiting for the Stream timeout.
+		 */
+		ResponseStatus receiveFrame(void *buffer, uint16_t size, uint16_t &length, unsigned long timeout = 1000);
+
+		/**
+		 * @brief Read the ambient noise and the last packet RSSI registers
+		 * @param ambient Set to the RSSI byte of the current ambient noise
+		 * @param lastPacket Set to the RSSI byte of the last packet received
+		 * @param timeout Milliseconds to wait for the answer
+		 * @return ResponseStatus, ERR_E220_BUSY if the module is receiving or
+		 *         sending, ERR_E220_TIMEOUT without an answer,
+		 *         ERR_E220_NOT_SUPPORT if the configuration last read or
+		 *         written has RSSI ambient noise disabled
+		 *
+		 * Sends C0 C1 C2 C3 00 02 in normal mode, without a mode switch; the
+		 * module answers C1 00 02 and the two registers in a few milliseconds.
+		 * dBm = getRSSIdBm(value).
+		 *
+		 * @note Needs RSSI ambient noise enabled (OPTION.RSSIAmbientNoise),
+		 *       otherwise the module sends the command on air as data; the
+		 *       read is refused when the cached configuration shows it disabled
+		 * @note A packet arriving during the read mixes with the answer, which is
+		 *       then rejected (ERR_E220_HEAD_NOT_RECOGNIZED)
+		 *
+		 * @example Listen before talk:
+		 * @code
+		 * byte noise;
+		 * if (e220ttl.readAmbientRSSI(noise).code == E220_SUCCESS && getRSSIdBm(noise) < -100) {
+		 *     e220ttl.sendFixedMessage(0x00, 0x02, 23, &reading, sizeof(reading));
+		 * }
+		 * @endcode
+		 */
+		ResponseStatus readRSSI(byte &ambient, byte &lastPacket, unsigned long timeout = E220_RSSI_TIMEOUT);
+		/** @brief Read the ambient noise RSSI register, see readRSSI() */
+		ResponseStatus readAmbientRSSI(byte &rssi, unsigned long timeout = E220_RSSI_TIMEOUT);
+		/** @brief Read the RSSI register of the last packet received, see readRSSI() */
+		ResponseStatus readLastPacketRSSI(byte &rssi, unsigned long timeout = E220_RSSI_TIMEOUT);
+
+		/**
+		 * @brief Send the RSSI register read without waiting for the answer
+		 * @return ResponseStatus, ERR_E220_BUSY if the module is receiving or sending,
+		 *         ERR_E220_NOT_SUPPORT (nothing written) if the cached
+		 *         configuration has RSSI ambient noise disabled
+		 *
+		 * Non-blocking half of readRSSI(): collect the answer with pollRSSI().
+		 */
+		ResponseStatus requestRSSI();
+
+		/**
+		 * @brief Collect the answer of requestRSSI()
+		 * @return E220_SUCCESS with the values set, ERR_E220_BUSY while the
+		 *         answer is incomplete, ERR_E220_HEAD_NOT_RECOGNIZED if the
+		 *         bytes are not an answer (they are consumed)
+		 */
+		Status pollRSSI(byte &ambient, byte &lastPacket);
+
+		/**
+		 * @brief Set the air data rate used to compute the frame gap
+		 * @param airDataRate Air data rate configured on the module
+		 *
+		 * @note Updated automatically by getConfiguration() and setConfiguration()
+		 */
+		void setAirDataRate(AIR_DATA_RATE airDataRate);
+
+		/**
+		 * @brief Silence, in microseconds, that closes a received frame
+		 * @return 4 UART character times plus one byte at the air data rate
+		 */
+		unsigned long getFrameGapMicros();
 /** @} */ // End of Message Reception group
 
 /**
@@ -1392,7 +1987,7 @@ class LoRa_E220 {
 		 * }
 		 * @endcode
 		 */
-		ResponseStatus sendFixedMessage(byte ADDH, byte ADDL, byte CHAN, const String message);
+		ResponseStatus sendFixedMessage(byte ADDH, byte ADDL, byte CHAN, const String &message);
 
         /**
          * @brief Send fixed message to specific address (binary)
@@ -1474,9 +2069,284 @@ class LoRa_E220 {
          * }
          * @endcode
          */
-        ResponseStatus sendBroadcastFixedMessage(byte CHAN, const String message);
+        ResponseStatus sendBroadcastFixedMessage(byte CHAN, const String &message);
 /** @} */ // End of Broadcast Transmission group
 
+/**
+ * @name Non-blocking Transmission
+ * @brief Methods for sending without waiting for the module to finish
+ *
+ * The blocking send methods wait for AUX (up to 5 seconds) plus a guard
+ * delay after every write. These methods write the data and return at once;
+ * the application completes the send by calling poll() from its loop.
+ * @{
+ */
+        /**
+         * @brief Start a non-blocking send of binary data
+         * @param message Pointer to data buffer to send
+         * @param size Number of bytes to send (max 200 bytes)
+         * @return ResponseStatus of the UART write
+         *
+         * Writes the data to the module and returns immediately. The buffer can be
+         * reused as soon as this method returns.
+         *
+         * @note Returns ERR_E220_BUSY if a previous send is still pending
+         * @note In fixed mode, first 3 bytes are used for addressing (ADDH, ADDL, CHAN)
+         *
+         * @example Sending without blocking the loop:
+         * @code
+         * e220ttl.beginSend(data, sizeof(data));
+         *
+         * void loop() {
+         *     if (e220ttl.poll() == SEND_COMPLETE) {
+         *         Serial.println(e220ttl.getSendStatus().getResponseDescription());
+         *     }
+         *     // service other peripherals...
+         * }
+         * @endcode
+         */
+        ResponseStatus beginSend(const void *message, const uint8_t size);
+
+        /**
+         * @brief Start a non-blocking send to a specific address
+         * @param ADDH High address byte (0x00-0xFF)
+         * @param ADDL Low address byte (0x00-0xFF)
+         * @param CHAN Channel number (0-255)
+         * @param message Pointer to binary data to send
+         * @param size Number of bytes to send (max 197 bytes)
+         * @return ResponseStatus of the UART write
+         *
+         * Same as beginSend() for fixed transmission: the 3 address bytes and the
+         * payload are written directly, without copying them in a temporary buffer.
+         */
+        ResponseStatus beginSendFixedMessage(byte ADDH, byte ADDL, byte CHAN, const void *message, const uint8_t size);
+
+        /**
+         * @brief Advance the non-blocking send state machine
+         * @return Current send state
+         *
+         * Checks AUX and the timeouts without waiting. Call it from loop()
+         * until it returns SEND_COMPLETE or SEND_FAILED.
+         *
+         * @note Cheap to call when no send is pending
+         */
+        SEND_STATE poll();
+
+        /**
+         * @brief Get the current send state without advancing it
+         * @return Current send state
+         */
+        SEND_STATE getSendState();
+
+        /**
+         * @brief Check if a non-blocking send is still in progress
+         * @return true while the state is SEND_WAIT_AUX or SEND_GUARD_TIME
+         */
+        bool isSendPending();
+
+        /**
+         * @brief Get the result of the last non-blocking send
+         * @return E220_SUCCESS, ERR_E220_TIMEOUT, ERR_E220_BUSY while pending, or a UART error
+         */
+        ResponseStatus getSendStatus();
+/** @} */ // End of Non-blocking Transmission group
+
+#ifdef LoRa_E220_PROFILE
+		/**
+		 * @brief Durations recorded since begin() or resetProfile()
+		 *
+		 * @example Where a configuration read spends its time:
+		 * @code
+		 * e220ttl.resetProfile();
+		 * e220ttl.getConfiguration(configuration);
+		 * const PhaseStats &modeSwitch = e220ttl.getProfile().phases[PROFILE_MODE_SWITCH];
+		 * Serial.print(modeSwitch.count);
+		 * Serial.print(F(" mode switches, mean us: "));
+		 * Serial.println(modeSwitch.getMean());
+		 * @endcode
+		 * @note Only with LoRa_E220_PROFILE defined
+		 */
+		const ProfileStats &getProfile() { return this->profile; }
+		/** @brief Clear the recorded durations */
+		void resetProfile() { this->profile.clear(); }
+#endif
+
+/**
+ * @name Typed Messages
+ * @brief Send and receive a struct with its size checked by the compiler
+ *
+ * The type must be trivially copyable and fit a packet (MAX_SIZE_TX_PACKET,
+ * 197 bytes in fixed mode), otherwise the sketch does not compile. The
+ * variants taking a SUB_PACKET_SETTING also check the type against the
+ * configured sub packet size. Data goes straight from/to the caller's
+ * object: no temporary buffer, no ResponseStructContainer to close().
+ * @{
+ */
+		/**
+		 * @brief Send a struct in transparent mode
+		 * @param message Struct to send
+		 * @return ResponseStatus indicating success or failure
+		 *
+		 * @example Sending a sensor reading:
+		 * @code
+		 * struct Reading { uint16_t id; float temperature; };
+		 * Reading reading = { 1, 21.5 };
+		 * ResponseStatus status = e220ttl.send(reading);
+		 * @endcode
+		 */
+		template <typename T>
+		ResponseStatus send(const T &message) {
+			assertMessageType<T, MAX_SIZE_TX_PACKET>();
+			return this->transmitStruct(NULL, 0, &message, sizeof(T));
+		}
+
+		/**
+		 * @brief Send a struct to a specific address in fixed mode
+		 * @param ADDH High address byte (0x00-0xFF)
+		 * @param ADDL Low address byte (0x00-0xFF)
+		 * @param CHAN Channel number (0-255)
+		 * @param message Struct to send
+		 * @return ResponseStatus indicating success or failure
+		 */
+		template <typename T>
+		ResponseStatus send(byte ADDH, byte ADDL, byte CHAN, const T &message) {
+			assertMessageType<T, MAX_SIZE_TX_PACKET - 3>();
+			byte header[3] = { ADDH, ADDL, CHAN };
+			return this->transmitStruct(header, sizeof(header), &message, sizeof(T));
+		}
+
+		/**
+		 * @brief Send a struct in transparent mode, checked against a sub packet size
+		 * @tparam SPS Sub packet setting configured on both modules
+		 * @param message Struct to send
+		 * @return ResponseStatus indicating success or failure
+		 *
+		 * @example Refusing a struct larger than a 32-byte sub packet:
+		 * @code
+		 * ResponseStatus status = e220ttl.send<SPS_032_11>(reading);
+		 * @endcode
+		 */
+		template <SUB_PACKET_SETTING SPS, typename T>
+		ResponseStatus send(const T &message) {
+			static_assert(sizeof(T) <= getSubPacketSizeBytes(SPS), "Message type does not fit the sub packet size");
+			return this->send(message);
+		}
+
+		/**
+		 * @brief Send a struct in fixed mode, checked against a sub packet size
+		 * @tparam SPS Sub packet setting configured on both modules
+		 * @param ADDH High address byte (0x00-0xFF)
+		 * @param ADDL Low address byte (0x00-0xFF)
+		 * @param CHAN Channel number (0-255)
+		 * @param message Struct to send
+		 * @return ResponseStatus indicating success or failure
+		 */
+		template <SUB_PACKET_SETTING SPS, typename T>
+		ResponseStatus send(byte ADDH, byte ADDL, byte CHAN, const T &message) {
+			static_assert(sizeof(T) <= getSubPacketSizeBytes(SPS), "Message type does not fit the sub packet size");
+			return this->send(ADDH, ADDL, CHAN, message);
+		}
+
+		/**
+		 * @brief Receive a struct into the caller's object
+		 * @param message Struct filled with the received bytes
+		 * @return ResponseStatus indicating success or failure
+		 *
+		 * @example Receiving a sensor reading:
+		 * @code
+		 * Reading reading;
+		 * if (e220ttl.available() && e220ttl.receive(reading).code == E220_SUCCESS) {
+		 *     Serial.println(reading.temperature);
+		 * }
+		 * @endcode
+		 */
+		template <typename T>
+		ResponseStatus receive(T &message) {
+			assertMessageType<T, MAX_SIZE_TX_PACKET>();
+			return this->receiveInto(&message, sizeof(T), NULL);
+		}
+
+		/**
+		 * @brief Receive a struct followed by its RSSI byte
+		 * @param message Struct filled with the received bytes
+		 * @param rssi Set to the RSSI byte appended by the module
+		 * @return ResponseStatus indicating success or failure
+		 *
+		 * @note RSSI must be enabled in device configuration
+		 */
+		template <typename T>
+		ResponseStatus receive(T &message, byte &rssi) {
+			assertMessageType<T, MAX_SIZE_TX_PACKET>();
+			return this->receiveInto(&message, sizeof(T), &rssi);
+		}
+
+		/**
+		 * @brief Receive a struct, checked against a sub packet size
+		 * @tparam SPS Sub packet setting configured on both modules
+		 * @param message Struct filled with the received bytes
+		 * @return ResponseStatus indicating success or failure
+		 */
+		template <SUB_PACKET_SETTING SPS, typename T>
+		ResponseStatus receive(T &message) {
+			static_assert(sizeof(T) <= getSubPacketSizeBytes(SPS), "Message type does not fit the sub packet size");
+			return this->receive(message);
+		}
+
+		/**
+		 * @brief Receive a struct and its RSSI byte, checked against a sub packet size
+		 * @tparam SPS Sub packet setting configured on both modules
+		 * @param message Struct filled with the received bytes
+		 * @param rssi Set to the RSSI byte appended by the module
+		 * @return ResponseStatus indicating success or failure
+		 */
+		template <SUB_PACKET_SETTING SPS, typename T>
+		ResponseStatus receive(T &message, byte &rssi) {
+			static_assert(sizeof(T) <= getSubPacketSizeBytes(SPS), "Message type does not fit the sub packet size");
+			return this->receive(message, rssi);
+		}
+/** @} */ // End of Typed Messages group
+
+/**
+ * @name AUX Pin Tracking
+ * @brief Methods for reading the AUX status and its recorded edges
+ * @{
+ */
+        /**
+         * @brief Read the AUX level
+         * @return true if AUX is HIGH (module idle) or no AUX pin is configured
+         *
+         * Uses the level recorded by the interrupt when begin(true) was used,
+         * digitalRead() otherwise.
+         */
+        bool isAuxHigh();
+
+        /**
+         * @brief Check if AUX is tracked by interrupt
+         * @return true if begin(true) attached the AUX interrupt
+         */
+        bool isAuxInterruptEnabled();
+
+        /**
+         * @brief Pop the oldest AUX edge recorded by the interrupt
+         * @param edge Filled with the edge timestamp (micros()) and new level
+         * @return true if an edge was available
+         *
+         * A falling edge (busy) marks the start of a transmission, a mode switch, or
+         * incoming data about to be written on UART. A rising edge (idle) marks its end.
+         *
+         * @note The buffer holds AUX_EDGE_BUFFER_SIZE edges, newer edges are dropped when full
+         *
+         * @example Detecting the start of a reception:
+         * @code
+         * AuxEdge edge;
+         * while (e220ttl.readAuxEdge(edge)) {
+         *     if (edge.level == LOW) Serial.println("Module busy (receiving or sending)");
+         * }
+         * @endcode
+         */
+        bool readAuxEdge(AuxEdge &edge);
+/** @} */ // End of AUX Pin Tracking group
+
 /**
  * @name Utility and Advanced Methods
  * @brief Additional methods for special operations and diagnostics
@@ -1568,6 +2438,8 @@ class LoRa_E220 {
  * @{
  */
 	private:
+		friend class LoRa_E220_Pacer;  ///< Writes frames without the AUX wait
+
 		HardwareSerial* hs;  ///< Hardware Serial interface pointer
 
 #ifdef ACTIVATE_SOFTWARE_SERIAL
@@ -1580,9 +2452,7 @@ class LoRa_E220 {
 		int8_t rxE220pin = -1;  ///< RX pin number (-1 if not used)
 		int8_t auxPin = -1;     ///< AUX status pin number (-1 if not used)
 
-#ifdef HARDWARE_SERIAL_SELECTABLE_PIN
-		uint32_t serialConfig = SERIAL_8N1;  ///< Serial configuration for ESP32
-#endif
+		uint32_t serialConfig = SERIAL_8N1;  ///< Host UART frame format (set by the ESP32 constructors)
 
 		int8_t m0Pin = -1;  ///< M0 mode control pin (-1 if not used)
 		int8_t m1Pin = -1;  ///< M1 mode control pin (-1 if not used)
@@ -1645,21 +2515,111 @@ class LoRa_E220 {
 		NeedsStream serialDef;
 
 		MODE_TYPE mode = MODE_0_NORMAL;
+		unsigned long modeSwitchMicros = 0;  ///< Measured mode transition time, 0 if unknown
+		uint8_t programDepth = 0;            ///< Nested enterProgramMode() calls
+		MODE_TYPE programPrevMode = MODE_0_NORMAL;  ///< Mode restored by the outermost exitProgramMode()
+
+		AIR_DATA_RATE airDataRate = AIR_DATA_RATE_010_24;  ///< Air data rate, for the frame gap
+
+		Configuration cachedConfiguration;   ///< Last configuration read or written
+		bool configurationCached = false;    ///< cachedConfiguration is valid
+		bool cryptCached = false;            ///< cachedConfiguration.CRYPT is the key written, not the read back
+
+		uint16_t frameLength = 0;            ///< Bytes received in the current frame
+		unsigned long frameLastByte = 0;     ///< micros() of the last byte of the current frame
+
+		SEND_STATE sendState = SEND_IDLE;    ///< Non-blocking send state
+		Status sendStatus = E220_SUCCESS;    ///< Result of the last non-blocking send
+		unsigned long sendStateTime = 0;     ///< millis() when the current send state was entered
+
+#ifdef LoRa_E220_PROFILE
+		ProfileStats profile = ProfileStats(); ///< Phase durations
+#endif
+
+		bool auxInterrupt = false;                        ///< AUX tracked by interrupt
+		volatile byte auxLevel = HIGH;                    ///< AUX level recorded by the interrupt
+		volatile AuxEdge auxEdges[AUX_EDGE_BUFFER_SIZE];  ///< Edges written by the interrupt
+		volatile uint8_t auxEdgeHead = 0;                 ///< Next slot written by the interrupt
+		volatile uint8_t auxEdgeTail = 0;                 ///< Next slot read by readAuxEdge()
+
+		static LoRa_E220 *auxInterruptOwner;              ///< Instance served by the AUX interrupt
+		static void auxInterruptHandler();
+		void onAuxChange();
 
 		void managedDelay(unsigned long timeout);
+		Status writeStruct(const void *header, uint8_t headerSize, const void *structureManaged, uint16_t size_);
 		Status waitCompleteResponse(unsigned long timeout = 1000, unsigned int waitNoAux = 100);
+		Status waitAuxHigh(unsigned long timeout, unsigned int waitNoAux, unsigned long guardTime);
+		Status switchMode(MODE_TYPE mode, unsigned long &elapsed);
 		void flush();
 		void cleanUARTBuffer();
 
 		Status sendStruct(void *structureManaged, uint16_t size_);
+		Status sendStruct(const void *header, uint8_t headerSize, const void *structureManaged, uint16_t size_);
+		ResponseStatus transmitStruct(const void *header, uint8_t headerSize, const void *structureManaged, uint16_t size_);
+		ResponseStatus beginSendStruct(const void *header, uint8_t headerSize, const void *message, uint16_t size);
 		Status receiveStruct(void *structureManaged, uint16_t size_);
+		ResponseStatus receiveInto(void *message, uint16_t size, byte *rssi);
+
+		template <typename T, uint16_t MAX_SIZE>
+		static void assertMessageType() {
+			static_assert(E220_IS_TRIVIALLY_COPYABLE(T), "Message type must be trivially copyable");
+			static_assert(sizeof(T) <= MAX_SIZE, "Message type is bigger than a packet");
+		}
 		bool writeProgramCommand(PROGRAM_COMMAND cmd, REGISTER_ADDRESS addr, PACKET_LENGHT pl);
+		Status writeRegisters(PROGRAM_COMMAND saveType, uint8_t address, const uint8_t *values, uint8_t length);
+		Status writeChangedRegisters(const Configuration &configuration, PROGRAM_COMMAND saveType, bool writeUnknownCrypt, bool *written);
 
-		RESPONSE_STATUS checkUARTConfiguration(MODE_TYPE mode);
+		void setStreamBaud(UART_BPS_RATE bpsRate);
+		Status checkDataLink();
+		void updateFromConfiguration(const Configuration &configuration);
 
 #ifdef LoRa_E220_DEBUG
 		void printParameters(struct Configuration *configuration);
 #endif
 };
 
+/**
+ * @brief Keeps the module in program mode for the lifetime of the object
+ *
+ * Calls enterProgramMode() on construction and exitProgramMode() on
+ * destruction, so the configuration calls of a scope share one pair of mode
+ * changes and the previous mode is restored on every return path.
+ *
+ * @example Provisioning:
+ * @code
+ * {
+ *     LoRa_E220_ConfigSession session(e220ttl);
+ *     if (session.getStatus() != E220_SUCCESS) return;
+ *
+ *     ModuleInformation information;
+ *     Configuration configuration;
+ *     e220ttl.getModuleInformation(information);
+ *     e220ttl.getConfiguration(configuration);
+ *     configuration.ADDL = nodeAddress;
+ *     e220ttl.setConfiguration(configuration, WRITE_CFG_PWR_DWN_SAVE);
+ * } // back to the previous mode
+ * @endcode
+ */
+class LoRa_E220_ConfigSession {
+	public:
+		explicit LoRa_E220_ConfigSession(LoRa_E220 &e220) : e220(e220) {
+			this->status = e220.enterProgramMode();
+		}
+
+		~LoRa_E220_ConfigSession() {
+			if (this->status == E220_SUCCESS) this->e220.exitProgramMode();
+		}
+
+		LoRa_E220_ConfigSession(const LoRa_E220_ConfigSession &) = delete;
+		LoRa_E220_ConfigSession &operator=(const LoRa_E220_ConfigSession &) = delete;
+
+		/** Result of entering program mode, the calls of the session fail without it */
+		Status getStatus() { return this->status; }
+
+	private:
+		LoRa_E220 &e220;
+		Status status;
+};
+
 #endif
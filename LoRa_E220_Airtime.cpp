@@ -0,0 +1,81 @@
+/**
+ * @file LoRa_E220_Airtime.cpp
+ * @brief Implementation of the airtime-based pacing scheduler
+ *
+ * @author Alteriom
+ *
+ * @note The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Alteriom - Enhancements and CI/CD improvements
+ */
+
+#include "LoRa_E220_Airtime.h"
+
+LoRa_E220_Pacer::LoRa_E220_Pacer(LoRa_E220 &e220, AIR_DATA_RATE airDataRate, SUB_PACKET_SETTING subPacketSetting,
+		UART_BPS_RATE bpsRate, unsigned long marginMicros){
+	this->e220 = &e220;
+	this->airDataRate = airDataRate;
+	this->subPacketSetting = subPacketSetting;
+	this->bpsRate = bpsRate;
+	this->marginMicros = marginMicros;
+	this->lastStatus.code = E220_SUCCESS;
+}
+
+ResponseStatus LoRa_E220_Pacer::sendMessage(const void *message, const uint8_t size){
+	return this->queue(NULL, 0, message, size);
+}
+
+ResponseStatus LoRa_E220_Pacer::sendFixedMessage(byte ADDH, byte ADDL, byte CHAN, const void *message, const uint8_t size){
+	byte header[3] = { ADDH, ADDL, CHAN };
+	return this->queue(header, sizeof(header), message, size);
+}
+
+ResponseStatus LoRa_E220_Pacer::queue(const void *header, uint8_t headerSize, const void *message, uint8_t size){
+	ResponseStatus status;
+	if (this->isPending()) {
+		status.code = ERR_E220_BUSY;
+		return status;
+	}
+	if (headerSize + size > MAX_SIZE_TX_PACKET + 2 || size == 0) {
+		status.code = ERR_E220_PACKET_TOO_BIG;
+		return status;
+	}
+
+	if (headerSize > 0) memcpy(this->frame, header, headerSize);
+	memcpy(this->frame + headerSize, message, size);
+	this->headerSize = headerSize;
+	this->pendingSize = headerSize + size;
+
+	// write at once if the radio is already free
+	this->poll();
+
+	status.code = E220_SUCCESS;
+	return status;
+}
+
+unsigned long LoRa_E220_Pacer::getFreeInMicros(){
+	if (!this->busy) return 0;
+
+	long remaining = (long)(this->freeAt - micros());
+	if (remaining <= 0) {
+		this->busy = false;
+		return 0;
+	}
+	return remaining;
+}
+
+bool LoRa_E220_Pacer::poll(){
+	if (!this->isPending() || this->getFreeInMicros() > 0) return false;
+
+	this->lastStatus.code = this->e220->writeStruct(NULL, 0, this->frame, this->pendingSize);
+
+	// the module starts on air once the UART transfer ends; the address header is not sent
+	this->freeAt = micros()
+			+ getUARTTransferMicros(this->bpsRate, this->pendingSize)
+			+ getAirtimeMicros(this->airDataRate, this->subPacketSetting, this->pendingSize - this->headerSize)
+			+ this->marginMicros;
+	this->busy = true;
+	this->pendingSize = 0;
+
+	return true;
+}
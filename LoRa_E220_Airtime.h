@@ -0,0 +1,185 @@
+/**
+ * @file LoRa_E220_Airtime.h
+ * @brief Time-on-air model of the E220 and a pacing scheduler built on it
+ *
+ * The module only reports the end of a transmission through AUX, so the
+ * blocking send waits up to 5 seconds plus a guard delay. The functions of
+ * this file compute how long a payload occupies the UART and the air, in
+ * constant expressions when the parameters are known at compile time.
+ * LoRa_E220_Pacer uses them to start the next send the moment the radio is
+ * predicted to be free, without waiting on AUX.
+ *
+ * The LLCC68 LoRa parameters behind each air data rate are not published;
+ * the table uses the spreading factor and bandwidth whose LoRa bit rate is
+ * nearest the nominal one, with coding rate 4/5, explicit header, CRC on
+ * and an 8 symbol preamble. Measure AUX once on the bench and use the
+ * margin of the pacer for the difference.
+ *
+ * @author Alteriom
+ *
+ * @note The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Alteriom - Enhancements and CI/CD improvements
+ */
+#ifndef LoRa_E220_Airtime_h
+#define LoRa_E220_Airtime_h
+
+#include "LoRa_E220.h"
+
+/**
+ * @brief Preamble length, in symbols, used by the model
+ */
+#define E220_PREAMBLE_SYMBOLS 8
+
+/**
+ * @brief Spreading factor assumed for an air data rate
+ */
+static constexpr uint8_t getSpreadingFactor(AIR_DATA_RATE airDataRate)
+{
+	return airDataRate == AIR_DATA_RATE_111_625 ? 5
+		: airDataRate == AIR_DATA_RATE_110_384 ? 6
+		: airDataRate == AIR_DATA_RATE_101_192 ? 6
+		: airDataRate == AIR_DATA_RATE_100_96 ? 6
+		: airDataRate == AIR_DATA_RATE_011_48 ? 7
+		: 9;
+}
+
+/**
+ * @brief Symbol time, in microseconds, for an air data rate (2^SF / bandwidth)
+ */
+static constexpr uint32_t getSymbolMicros(AIR_DATA_RATE airDataRate)
+{
+	return airDataRate == AIR_DATA_RATE_111_625 ? 64      // SF5 BW500
+		: airDataRate == AIR_DATA_RATE_110_384 ? 128      // SF6 BW500
+		: airDataRate == AIR_DATA_RATE_101_192 ? 256      // SF6 BW250
+		: airDataRate == AIR_DATA_RATE_100_96 ? 512       // SF6 BW125
+		: airDataRate == AIR_DATA_RATE_011_48 ? 1024      // SF7 BW125
+		: 4096;                                           // SF9 BW125
+}
+
+/**
+ * @brief Payload symbols of one radio packet (Semtech LoRa modem formula)
+ */
+static constexpr uint32_t getPayloadSymbols(AIR_DATA_RATE airDataRate, uint8_t payloadSize)
+{
+	// 8 + ceil((8 PL - 4 SF + 28 + 16 CRC) / (4 SF)) * (CR + 4), the ceil argument is positive up to SF11
+	return 8 + ((8 * (uint32_t)payloadSize + 43) / (4 * getSpreadingFactor(airDataRate))) * 5;
+}
+
+/**
+ * @brief Time on air, in microseconds, of one radio packet
+ * @param airDataRate Air data rate configured on the module
+ * @param payloadSize Bytes in the packet (at most one sub packet)
+ */
+static constexpr uint32_t getPacketAirtimeMicros(AIR_DATA_RATE airDataRate, uint8_t payloadSize)
+{
+	// preamble + 4.25 sync symbols, then the payload symbols
+	return (E220_PREAMBLE_SYMBOLS * 4 + 17) * getSymbolMicros(airDataRate) / 4
+		+ getPayloadSymbols(airDataRate, payloadSize) * getSymbolMicros(airDataRate);
+}
+
+/**
+ * @brief Time on air, in microseconds, of a payload split in sub packets
+ * @param airDataRate Air data rate configured on the module
+ * @param subPacketSetting Sub packet size configured on the module
+ * @param size Payload bytes (without the fixed-mode address header)
+ *
+ * @example Checking a link budget at compile time:
+ * @code
+ * static_assert(getAirtimeMicros(AIR_DATA_RATE_111_625, SPS_064_10, 48) < 20000,
+ *               "48-byte reading must fit the 20 ms slot");
+ * @endcode
+ */
+static constexpr uint32_t getAirtimeMicros(AIR_DATA_RATE airDataRate, SUB_PACKET_SETTING subPacketSetting, uint16_t size)
+{
+	return size > getSubPacketSizeBytes(subPacketSetting)
+		? getPacketAirtimeMicros(airDataRate, getSubPacketSizeBytes(subPacketSetting))
+			+ getAirtimeMicros(airDataRate, subPacketSetting, size - getSubPacketSizeBytes(subPacketSetting))
+		: getPacketAirtimeMicros(airDataRate, (uint8_t)size);
+}
+
+/**
+ * @brief Time, in microseconds, to move bytes over the UART (8N1)
+ */
+static constexpr uint32_t getUARTTransferMicros(UART_BPS_RATE bpsRate, uint16_t size)
+{
+	return (uint32_t)size * 10000000UL / (uint32_t)bpsRate;
+}
+
+/**
+ * @brief Sends at the rate of the air link, predicted by the airtime model
+ *
+ * A send is queued (one frame) and poll() writes it when the radio is
+ * predicted to be free: end of the previous UART transfer plus its airtime
+ * and the margin. Neither call blocks.
+ *
+ * @example Streaming readings at 62.5 kbps:
+ * @code
+ * LoRa_E220_Pacer pacer(e220ttl, AIR_DATA_RATE_111_625, SPS_200_00, UART_BPS_RATE_9600);
+ *
+ * void loop() {
+ *     if (!pacer.isPending()) {
+ *         Reading reading = readSensor();
+ *         pacer.sendFixedMessage(0x00, 0x01, 23, &reading, sizeof(reading));
+ *     }
+ *     pacer.poll();
+ * }
+ * @endcode
+ */
+class LoRa_E220_Pacer {
+	public:
+		/**
+		 * @param e220 Initialized device
+		 * @param airDataRate Air data rate configured on the module
+		 * @param subPacketSetting Sub packet size configured on the module
+		 * @param bpsRate UART rate between microcontroller and module
+		 * @param marginMicros Extra time added after each predicted transmission
+		 */
+		LoRa_E220_Pacer(LoRa_E220 &e220, AIR_DATA_RATE airDataRate, SUB_PACKET_SETTING subPacketSetting,
+				UART_BPS_RATE bpsRate = UART_BPS_RATE_9600, unsigned long marginMicros = 1000);
+
+		/**
+		 * @brief Queue binary data for a transparent transmission
+		 * @return ERR_E220_BUSY if a frame is already queued,
+		 *         ERR_E220_PACKET_TOO_BIG if it exceeds a packet
+		 */
+		ResponseStatus sendMessage(const void *message, const uint8_t size);
+
+		/**
+		 * @brief Queue binary data for a fixed transmission
+		 * @return ERR_E220_BUSY if a frame is already queued,
+		 *         ERR_E220_PACKET_TOO_BIG if it exceeds a packet
+		 */
+		ResponseStatus sendFixedMessage(byte ADDH, byte ADDL, byte CHAN, const void *message, const uint8_t size);
+
+		/**
+		 * @brief Write the queued frame if the radio is predicted free
+		 * @return true if a frame was written by this call
+		 */
+		bool poll();
+
+		/** A frame is waiting for the radio */
+		bool isPending() { return this->pendingSize > 0; }
+		/** Microseconds until the radio is predicted free (0 if free) */
+		unsigned long getFreeInMicros();
+		/** Status of the last UART write */
+		ResponseStatus getLastStatus() { return this->lastStatus; }
+
+	private:
+		LoRa_E220 *e220;
+		AIR_DATA_RATE airDataRate;
+		SUB_PACKET_SETTING subPacketSetting;
+		UART_BPS_RATE bpsRate;
+		unsigned long marginMicros;
+
+		uint8_t frame[MAX_SIZE_TX_PACKET + 3];
+		uint8_t headerSize = 0;
+		uint8_t pendingSize = 0;   ///< Frame bytes queued, header included
+		unsigned long freeAt = 0;  ///< micros() when the radio is predicted free
+		bool busy = false;         ///< freeAt is meaningful
+		ResponseStatus lastStatus;
+
+		ResponseStatus queue(const void *header, uint8_t headerSize, const void *message, uint8_t size);
+};
+
+#endif
@@ -0,0 +1,207 @@
+/**
+ * @file LoRa_E220_Batch.cpp
+ * @brief Implementation of the batching transmit queue and its frame reader
+ *
+ * @author Alteriom
+ *
+ * @note The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Alteriom - Enhancements and CI/CD improvements
+ */
+
+#include "LoRa_E220_Batch.h"
+
+LoRa_E220_BatchQueue::LoRa_E220_BatchQueue(LoRa_E220 &e220, SUB_PACKET_SETTING subPacketSetting, unsigned long maxDelay){
+	this->e220 = &e220;
+	this->maxDelay = maxDelay;
+
+	this->capacity = getSubPacketSizeBytes(subPacketSetting);
+	if (this->capacity > E220_BATCH_BUFFER_SIZE) {
+		this->capacity = E220_BATCH_BUFFER_SIZE;
+	}
+
+	for (uint8_t i = 0; i < E220_BATCH_DESTINATIONS; i++) {
+		this->destinations[i].used = false;
+	}
+}
+
+uint8_t LoRa_E220_BatchQueue::getFrameCapacity(){
+	return this->capacity;
+}
+
+uint16_t LoRa_E220_BatchQueue::getPendingMessages(){
+	uint16_t pending = 0;
+	for (uint8_t i = 0; i < E220_BATCH_DESTINATIONS; i++) {
+		if (this->destinations[i].used) pending += this->destinations[i].messages;
+	}
+	return pending;
+}
+
+ResponseStatus LoRa_E220_BatchQueue::enqueue(byte ADDH, byte ADDL, byte CHAN, const void *message, uint8_t size){
+	ResponseStatus status;
+	status.code = E220_SUCCESS;
+
+	// magic + length byte + message
+	if (1 + 1 + size > this->capacity) {
+		status.code = ERR_E220_PACKET_TOO_BIG;
+		return status;
+	}
+
+	Destination *destination = this->find(ADDH, ADDL, CHAN);
+	if (destination && destination->length + 1 + size > this->capacity) {
+		status = this->send(*destination);
+		if (status.code != E220_SUCCESS) this->drop(*destination);
+		destination = NULL;
+	}
+	if (!destination) {
+		destination = this->reserve(ADDH, ADDL, CHAN, status);
+	}
+
+	destination->data[destination->length++] = size;
+	memcpy(destination->data + destination->length, message, size);
+	destination->length += size;
+	destination->messages++;
+
+	// no room left for even an empty message
+	if (destination->length + 1 > this->capacity) {
+		ResponseStatus sent = this->send(*destination);
+		if (sent.code != E220_SUCCESS) status = sent;
+	}
+
+	return status;
+}
+
+ResponseStatus LoRa_E220_BatchQueue::poll(){
+	ResponseStatus status;
+	status.code = E220_SUCCESS;
+
+	for (uint8_t i = 0; i < E220_BATCH_DESTINATIONS; i++) {
+		Destination &destination = this->destinations[i];
+		if (destination.used && (millis() - destination.since) >= this->maxDelay) {
+			status = this->send(destination);
+		}
+	}
+	return status;
+}
+
+ResponseStatus LoRa_E220_BatchQueue::flush(){
+	ResponseStatus status;
+	status.code = E220_SUCCESS;
+
+	for (uint8_t i = 0; i < E220_BATCH_DESTINATIONS; i++) {
+		if (this->destinations[i].used) {
+			ResponseStatus sent = this->send(this->destinations[i]);
+			if (sent.code != E220_SUCCESS) status = sent;
+		}
+	}
+	return status;
+}
+
+ResponseStatus LoRa_E220_BatchQueue::flush(byte ADDH, byte ADDL, byte CHAN){
+	ResponseStatus status;
+	status.code = E220_SUCCESS;
+
+	Destination *destination = this->find(ADDH, ADDL, CHAN);
+	if (destination) status = this->send(*destination);
+	return status;
+}
+
+LoRa_E220_BatchQueue::Destination *LoRa_E220_BatchQueue::find(byte ADDH, byte ADDL, byte CHAN){
+	for (uint8_t i = 0; i < E220_BATCH_DESTINATIONS; i++) {
+		Destination &destination = this->destinations[i];
+		if (destination.used && destination.ADDH == ADDH && destination.ADDL == ADDL && destination.CHAN == CHAN) {
+			return &destination;
+		}
+	}
+	return NULL;
+}
+
+/*
+
+Take a free slot for a new destination; when all are busy the oldest frame
+is sent to make room
+
+*/
+
+LoRa_E220_BatchQueue::Destination *LoRa_E220_BatchQueue::reserve(byte ADDH, byte ADDL, byte CHAN, ResponseStatus &status){
+	Destination *destination = NULL;
+	for (uint8_t i = 0; i < E220_BATCH_DESTINATIONS && !destination; i++) {
+		if (!this->destinations[i].used) destination = &this->destinations[i];
+	}
+
+	if (!destination) {
+		unsigned long now = millis();
+		destination = &this->destinations[0];
+		for (uint8_t i = 1; i < E220_BATCH_DESTINATIONS; i++) {
+			if ((now - this->destinations[i].since) > (now - destination->since)) {
+				destination = &this->destinations[i];
+			}
+		}
+		ResponseStatus sent = this->send(*destination);
+		if (sent.code != E220_SUCCESS) {
+			this->drop(*destination);
+			status = sent;
+		}
+	}
+
+	destination->used = true;
+	destination->ADDH = ADDH;
+	destination->ADDL = ADDL;
+	destination->CHAN = CHAN;
+	destination->data[0] = E220_BATCH_MAGIC;
+	destination->length = 1;
+	destination->messages = 0;
+	destination->since = millis();
+	return destination;
+}
+
+ResponseStatus LoRa_E220_BatchQueue::send(Destination &destination){
+	ResponseStatus status = this->e220->sendFixedMessage(destination.ADDH, destination.ADDL, destination.CHAN, destination.data, destination.length);
+
+	/* a failed frame stays queued, to be retried */
+	if (status.code == E220_SUCCESS) {
+		this->framesSent++;
+		this->messagesSent += destination.messages;
+		destination.used = false;
+	}
+
+	return status;
+}
+
+/*
+
+Give up a frame that could not be sent, its slot is needed
+
+*/
+
+void LoRa_E220_BatchQueue::drop(Destination &destination){
+	this->framesDropped++;
+	this->messagesDropped += destination.messages;
+	destination.used = false;
+}
+
+LoRa_E220_BatchReader::LoRa_E220_BatchReader(const void *frame, uint16_t length){
+	this->frame = (const uint8_t *)frame;
+	this->length = length;
+	this->position = 1;
+}
+
+bool LoRa_E220_BatchReader::isBatch(){
+	return this->length > 0 && this->frame[0] == E220_BATCH_MAGIC;
+}
+
+bool LoRa_E220_BatchReader::next(const uint8_t *&message, uint8_t &size){
+	if (!this->isBatch() || this->position >= this->length) return false;
+
+	uint8_t messageSize = this->frame[this->position];
+	if (this->position + 1 + messageSize > this->length) {
+		// truncated frame: stop here
+		this->position = this->length;
+		return false;
+	}
+
+	message = this->frame + this->position + 1;
+	size = messageSize;
+	this->position += 1 + messageSize;
+	return true;
+}
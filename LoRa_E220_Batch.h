@@ -0,0 +1,198 @@
+/**
+ * @file LoRa_E220_Batch.h
+ * @brief Transmit queue packing small fixed-mode messages into full sub packets
+ *
+ * Every fixed transmission costs a radio preamble, the wait on AUX and the
+ * guard delay, whatever its size. LoRa_E220_BatchQueue collects the messages
+ * for the same destination (ADDH, ADDL, CHAN) and sends them as one frame,
+ * up to the configured sub packet size. LoRa_E220_BatchReader splits a
+ * received frame back into messages.
+ *
+ * Frame layout (payload of a fixed transmission):
+ * @code
+ * E220_BATCH_MAGIC | len1 | message1 | len2 | message2 | ...
+ * @endcode
+ *
+ * @author Alteriom
+ *
+ * @note The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Alteriom - Enhancements and CI/CD improvements
+ */
+#ifndef LoRa_E220_Batch_h
+#define LoRa_E220_Batch_h
+
+#include "LoRa_E220.h"
+
+/**
+ * @brief First byte of a batch frame
+ */
+#define E220_BATCH_MAGIC 0xB7
+
+/**
+ * @brief Number of destinations batched at the same time
+ * @note Each destination uses E220_BATCH_BUFFER_SIZE bytes of RAM
+ */
+#ifndef E220_BATCH_DESTINATIONS
+	#define E220_BATCH_DESTINATIONS 2
+#endif
+
+/**
+ * @brief Frame buffer size of a destination (payload of a fixed transmission)
+ */
+#ifndef E220_BATCH_BUFFER_SIZE
+	#define E220_BATCH_BUFFER_SIZE (MAX_SIZE_TX_PACKET - 3)
+#endif
+
+/**
+ * @brief Batching transmit queue for fixed transmission
+ *
+ * A frame is sent when the next message does not fit, when its oldest
+ * message reaches the maximum delay (checked by poll()), or on flush().
+ * A frame whose send fails stays queued and is retried by the next poll()
+ * or flush(); it is dropped (getMessagesDropped()) only when its slot is
+ * needed for new messages.
+ *
+ * @example Batching sensor readings to a gateway:
+ * @code
+ * LoRa_E220_BatchQueue batch(e220ttl, SPS_064_10, 500);
+ *
+ * void loop() {
+ *     Reading reading = readSensor();
+ *     batch.enqueue(0x00, 0x01, 23, &reading, sizeof(reading));
+ *     batch.poll();
+ * }
+ * @endcode
+ */
+class LoRa_E220_BatchQueue {
+	public:
+		/**
+		 * @brief Create a queue sending through an initialized device
+		 * @param e220 Device used for the transmissions
+		 * @param subPacketSetting Sub packet size configured on the modules
+		 * @param maxDelay Longest time, in milliseconds, a message waits in the queue
+		 */
+		LoRa_E220_BatchQueue(LoRa_E220 &e220, SUB_PACKET_SETTING subPacketSetting = SPS_200_00, unsigned long maxDelay = 100);
+
+		/**
+		 * @brief Add a message for a destination
+		 * @param ADDH High address byte (0x00-0xFF)
+		 * @param ADDL Low address byte (0x00-0xFF)
+		 * @param CHAN Channel number (0-255)
+		 * @param message Pointer to the data, copied in the queue
+		 * @param size Number of bytes
+		 * @return ResponseStatus of the frame sent to make room, if any;
+		 *         ERR_E220_PACKET_TOO_BIG if the message alone does not fit a frame
+		 */
+		ResponseStatus enqueue(byte ADDH, byte ADDL, byte CHAN, const void *message, uint8_t size);
+
+		/**
+		 * @brief Send the frames whose oldest message reached the maximum delay
+		 * @return ResponseStatus of the last frame sent (E220_SUCCESS if none)
+		 * @note Call it from the loop
+		 */
+		ResponseStatus poll();
+
+		/**
+		 * @brief Send every pending frame now
+		 * @return ResponseStatus of the last failed frame, or E220_SUCCESS
+		 */
+		ResponseStatus flush();
+
+		/**
+		 * @brief Send the pending frame of a destination now
+		 * @return ResponseStatus of the frame (E220_SUCCESS if nothing was pending)
+		 */
+		ResponseStatus flush(byte ADDH, byte ADDL, byte CHAN);
+
+		/**
+		 * @brief Usable payload of a frame, limited by the sub packet size
+		 */
+		uint8_t getFrameCapacity();
+
+		/** Number of messages waiting in the queue */
+		uint16_t getPendingMessages();
+		/** Number of frames transmitted */
+		unsigned long getFramesSent() { return this->framesSent; }
+		/** Number of messages transmitted */
+		unsigned long getMessagesSent() { return this->messagesSent; }
+		/** Number of frames given up after a failed send */
+		unsigned long getFramesDropped() { return this->framesDropped; }
+		/** Number of messages given up after a failed send */
+		unsigned long getMessagesDropped() { return this->messagesDropped; }
+
+	private:
+		struct Destination {
+			bool used;
+			byte ADDH;
+			byte ADDL;
+			byte CHAN;
+			uint8_t length;        ///< Bytes in data, magic included
+			uint8_t messages;      ///< Messages in data
+			unsigned long since;   ///< millis() of the first message
+			uint8_t data[E220_BATCH_BUFFER_SIZE];
+		};
+
+		LoRa_E220 *e220;
+		uint8_t capacity;
+		unsigned long maxDelay;
+		Destination destinations[E220_BATCH_DESTINATIONS];
+
+		unsigned long framesSent = 0;
+		unsigned long messagesSent = 0;
+		unsigned long framesDropped = 0;
+		unsigned long messagesDropped = 0;
+
+		Destination *find(byte ADDH, byte ADDL, byte CHAN);
+		Destination *reserve(byte ADDH, byte ADDL, byte CHAN, ResponseStatus &status);
+		ResponseStatus send(Destination &destination);
+		void drop(Destination &destination);
+};
+
+/**
+ * @brief Iterates the messages of a received batch frame
+ *
+ * Works in place on the caller's buffer: the messages point into it.
+ *
+ * @example Unpacking a frame:
+ * @code
+ * uint8_t frame[MAX_SIZE_TX_PACKET];
+ * uint16_t length;
+ * if (e220ttl.receiveFrame(frame, sizeof(frame), length).code == E220_SUCCESS) {
+ *     LoRa_E220_BatchReader reader(frame, length);
+ *     const uint8_t *message;
+ *     uint8_t size;
+ *     while (reader.next(message, size)) {
+ *         // Process size bytes...
+ *     }
+ * }
+ * @endcode
+ */
+class LoRa_E220_BatchReader {
+	public:
+		/**
+		 * @param frame Received frame
+		 * @param length Number of bytes in the frame
+		 */
+		LoRa_E220_BatchReader(const void *frame, uint16_t length);
+
+		/**
+		 * @brief True if the frame starts with E220_BATCH_MAGIC
+		 */
+		bool isBatch();
+
+		/**
+		 * @brief Get the next message
+		 * @param message Set to the first byte of the message in the frame
+		 * @param size Set to the message size
+		 * @return false at the end of the frame, or if the frame is malformed
+		 */
+		bool next(const uint8_t *&message, uint8_t &size);
+
+	private:
+		const uint8_t *frame;
+		uint16_t length;
+		uint16_t position;
+};
+
+#endif
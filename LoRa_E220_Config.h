@@ -0,0 +1,202 @@
+/**
+ * @file LoRa_E220_Config.h
+ * @brief Compile-time configuration builder producing the 8 register bytes
+ *
+ * Configuration mirrors the registers with bitfields, whose bit order is up
+ * to the compiler, and is only checked by the module answering WRONG_FORMAT.
+ * LoRa_E220_ConfigBuilder packs the typed settings with explicit shifts in
+ * constant expressions: the register bytes are computed by the compiler, an
+ * out of range value fails the build, and the result can live in flash.
+ * That takes a constexpr variable: a const one may be initialised at start
+ * up, where a wrong value passes masked and PROGMEM data is not in flash.
+ *
+ * Checked at compile time: every value fits its field (an enum cast from a
+ * wrong number) and the channel is inside the band of OPERATING_FREQUENCY.
+ * The module accepts every other combination of settings.
+ *
+ * @author Alteriom
+ *
+ * @note The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Alteriom - Enhancements and CI/CD improvements
+ */
+#ifndef LoRa_E220_Config_h
+#define LoRa_E220_Config_h
+
+#include "LoRa_E220.h"
+
+/**
+ * @brief Highest channel of the band selected by OPERATING_FREQUENCY
+ *
+ * 410.125 + 83 MHz for the 400 MHz modules and 850.125 + 80 MHz for the
+ * 900 MHz ones (data sheets); the documented 31 MHz range otherwise.
+ * Define it before the include for other variants.
+ */
+#ifndef E220_MAX_CHANNEL
+	#if OPERATING_FREQUENCY == 410
+		#define E220_MAX_CHANNEL 83
+	#elif OPERATING_FREQUENCY == 850
+		#define E220_MAX_CHANNEL 80
+	#else
+		#define E220_MAX_CHANNEL 31
+	#endif
+#endif
+
+/**
+ * @brief The 8 configuration registers (00H-07H) in wire order
+ *
+ * ADDH ADDL SPED OPTION CHAN TRANSMISSION_MODE CRYPT_H CRYPT_L
+ */
+struct ConfigurationRegisters {
+	uint8_t registers[PL_CONFIGURATION];
+};
+
+/**
+ * @brief Immutable builder of the configuration registers, usable in constant expressions
+ *
+ * Starts from the factory settings (address 0, 9600 8N1, 2.4 kbps, 200 byte
+ * sub packets, channel 23, transparent, WOR 2000 ms); each setter returns a
+ * modified copy.
+ *
+ * @example A node configuration built by the compiler and kept in flash
+ * (constexpr, so that .channel(200) does not compile):
+ * @code
+ * static constexpr ConfigurationRegisters NODE_CONFIG PROGMEM = LoRa_E220_ConfigBuilder()
+ *     .address(0x00, 0x03)
+ *     .channel(40)
+ *     .airDataRate(AIR_DATA_RATE_111_625)
+ *     .fixedTransmission(FT_FIXED_TRANSMISSION)
+ *     .rssi(RSSI_ENABLED)
+ *     .build();
+ *
+ * Configuration configuration;
+ * loadConfiguration_P(&NODE_CONFIG, configuration);
+ * e220ttl.updateConfiguration(configuration, WRITE_CFG_PWR_DWN_SAVE);
+ * @endcode
+ */
+class LoRa_E220_ConfigBuilder {
+	public:
+		constexpr LoRa_E220_ConfigBuilder()
+			: LoRa_E220_ConfigBuilder(0x00, 0x00, 0x62, 0x00, 0x17, 0x03, 0x00, 0x00) {}
+
+		/** Module address */
+		constexpr LoRa_E220_ConfigBuilder address(byte ADDH, byte ADDL) const {
+			return LoRa_E220_ConfigBuilder(ADDH, ADDL, sped, option, chan, transmissionMode, cryptH, cryptL);
+		}
+		/** Channel, frequency OPERATING_FREQUENCY + CHAN MHz, at most E220_MAX_CHANNEL */
+		constexpr LoRa_E220_ConfigBuilder channel(byte CHAN) const {
+			return LoRa_E220_ConfigBuilder(addh, addl, sped, option,
+					CHAN <= E220_MAX_CHANNEL ? CHAN : channelOutOfBand(CHAN), transmissionMode, cryptH, cryptL);
+		}
+
+		/** SPED bits 7-5 */
+		constexpr LoRa_E220_ConfigBuilder uartBaudRate(UART_BPS_TYPE uartBaudRate) const {
+			return this->withSped(5, 0x07, uartBaudRate);
+		}
+		/** SPED bits 4-3 */
+		constexpr LoRa_E220_ConfigBuilder uartParity(E220_UART_PARITY uartParity) const {
+			return this->withSped(3, 0x03, uartParity);
+		}
+		/** SPED bits 2-0 */
+		constexpr LoRa_E220_ConfigBuilder airDataRate(AIR_DATA_RATE airDataRate) const {
+			return this->withSped(0, 0x07, airDataRate);
+		}
+
+		/** OPTION bits 7-6 */
+		constexpr LoRa_E220_ConfigBuilder subPacketSetting(SUB_PACKET_SETTING subPacketSetting) const {
+			return this->withOption(6, 0x03, subPacketSetting);
+		}
+		/** OPTION bit 5 */
+		constexpr LoRa_E220_ConfigBuilder rssiAmbientNoise(RSSI_AMBIENT_NOISE_ENABLE rssiAmbientNoise) const {
+			return this->withOption(5, 0x01, rssiAmbientNoise);
+		}
+		/** OPTION bits 1-0 */
+		constexpr LoRa_E220_ConfigBuilder transmissionPower(TRANSMISSION_POWER transmissionPower) const {
+			return this->withOption(0, 0x03, transmissionPower);
+		}
+
+		/** TRANSMISSION_MODE bit 7: RSSI byte after each received packet */
+		constexpr LoRa_E220_ConfigBuilder rssi(RSSI_ENABLE_BYTE enableRSSI) const {
+			return this->withTransmissionMode(7, 0x01, enableRSSI);
+		}
+		/** TRANSMISSION_MODE bit 6 */
+		constexpr LoRa_E220_ConfigBuilder fixedTransmission(FIDEX_TRANSMISSION fixedTransmission) const {
+			return this->withTransmissionMode(6, 0x01, fixedTransmission);
+		}
+		/** TRANSMISSION_MODE bit 4 */
+		constexpr LoRa_E220_ConfigBuilder lbt(LBT_ENABLE_BYTE enableLBT) const {
+			return this->withTransmissionMode(4, 0x01, enableLBT);
+		}
+		/** TRANSMISSION_MODE bits 2-0 */
+		constexpr LoRa_E220_ConfigBuilder worPeriod(WOR_PERIOD WORPeriod) const {
+			return this->withTransmissionMode(0, 0x07, WORPeriod);
+		}
+
+		/** Encryption key (write only on the module) */
+		constexpr LoRa_E220_ConfigBuilder crypt(uint16_t key) const {
+			return LoRa_E220_ConfigBuilder(addh, addl, sped, option, chan, transmissionMode, key >> 8, key & 0xFF);
+		}
+
+		/** The register bytes, in wire order */
+		constexpr ConfigurationRegisters build() const {
+			return ConfigurationRegisters{ { addh, addl, sped, option, chan, transmissionMode, cryptH, cryptL } };
+		}
+
+		/** One register byte (REGISTER_ADDRESS or 0-7) */
+		constexpr uint8_t getRegister(uint8_t address) const {
+			return address == 0 ? addh : address == 1 ? addl : address == 2 ? sped : address == 3 ? option
+				: address == 4 ? chan : address == 5 ? transmissionMode : address == 6 ? cryptH : cryptL;
+		}
+
+	private:
+		uint8_t addh, addl, sped, option, chan, transmissionMode, cryptH, cryptL;
+
+		constexpr LoRa_E220_ConfigBuilder(uint8_t addh, uint8_t addl, uint8_t sped, uint8_t option,
+				uint8_t chan, uint8_t transmissionMode, uint8_t cryptH, uint8_t cryptL)
+			: addh(addh), addl(addl), sped(sped), option(option),
+			  chan(chan), transmissionMode(transmissionMode), cryptH(cryptH), cryptL(cryptL) {}
+
+		/*
+		 * Not constexpr: reached while evaluating a constant expression, they
+		 * stop the compilation with their name in the error. At run time the
+		 * value passes (masked to its field).
+		 */
+		static uint8_t channelOutOfBand(uint8_t value) { return value; }
+		static uint8_t valueOutOfField(uint8_t value) { return value; }
+
+		static constexpr uint8_t field(uint8_t value, uint8_t shift, uint8_t mask, uint8_t current) {
+			return (current & ~(mask << shift)) | (((value & ~mask) == 0 ? value : valueOutOfField(value)) & mask) << shift;
+		}
+
+		constexpr LoRa_E220_ConfigBuilder withSped(uint8_t shift, uint8_t mask, uint8_t value) const {
+			return LoRa_E220_ConfigBuilder(addh, addl, field(value, shift, mask, sped), option, chan, transmissionMode, cryptH, cryptL);
+		}
+		constexpr LoRa_E220_ConfigBuilder withOption(uint8_t shift, uint8_t mask, uint8_t value) const {
+			return LoRa_E220_ConfigBuilder(addh, addl, sped, field(value, shift, mask, option), chan, transmissionMode, cryptH, cryptL);
+		}
+		constexpr LoRa_E220_ConfigBuilder withTransmissionMode(uint8_t shift, uint8_t mask, uint8_t value) const {
+			return LoRa_E220_ConfigBuilder(addh, addl, sped, option, chan, field(value, shift, mask, transmissionMode), cryptH, cryptL);
+		}
+};
+
+/**
+ * @brief Copy registers into a Configuration for setConfiguration()/updateConfiguration()
+ */
+static inline void loadConfiguration(const ConfigurationRegisters &registers, Configuration &configuration)
+{
+	memcpy(&configuration.ADDH, registers.registers, PL_CONFIGURATION);
+}
+
+/**
+ * @brief Same as loadConfiguration() for registers stored with PROGMEM
+ */
+static inline void loadConfiguration_P(const ConfigurationRegisters *registers, Configuration &configuration)
+{
+#if defined(__AVR__) || defined(ESP8266)
+	memcpy_P(&configuration.ADDH, registers->registers, PL_CONFIGURATION);
+#else
+	memcpy(&configuration.ADDH, registers->registers, PL_CONFIGURATION);
+#endif
+}
+
+#endif
@@ -0,0 +1,176 @@
+/**
+ * @file LoRa_E220_Fragment.cpp
+ * @brief Implementation of payload fragmentation and reassembly
+ *
+ * @author Alteriom
+ *
+ * @note The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Alteriom - Enhancements and CI/CD improvements
+ */
+
+#include "LoRa_E220_Fragment.h"
+
+LoRa_E220_Fragmenter::LoRa_E220_Fragmenter(LoRa_E220 &e220, byte ADDH, byte ADDL, SUB_PACKET_SETTING subPacketSetting){
+	this->e220 = &e220;
+	this->ADDH = ADDH;
+	this->ADDL = ADDL;
+
+	// one fragment per radio packet: within the sub packet and the fixed-mode payload
+	uint8_t frameSize = getSubPacketSizeBytes(subPacketSetting);
+	if (frameSize > MAX_SIZE_TX_PACKET - 3) {
+		frameSize = MAX_SIZE_TX_PACKET - 3;
+	}
+	this->fragmentSize = frameSize - E220_FRAGMENT_HEADER_SIZE;
+}
+
+ResponseStatus LoRa_E220_Fragmenter::send(byte ADDH, byte ADDL, byte CHAN, const void *message, uint16_t size){
+	ResponseStatus status;
+
+	uint16_t count = (size + this->fragmentSize - 1) / this->fragmentSize;
+	if (count == 0) count = 1;
+	if (count > 255) {
+		status.code = ERR_E220_PACKET_TOO_BIG;
+		return status;
+	}
+
+	const uint8_t *data = (const uint8_t *)message;
+	uint8_t frame[MAX_SIZE_TX_PACKET - 3];
+	frame[0] = E220_FRAGMENT_MAGIC;
+	frame[1] = this->ADDH;
+	frame[2] = this->ADDL;
+	frame[3] = this->id++;
+	frame[5] = count;
+	frame[6] = this->fragmentSize;
+
+	for (uint16_t index = 0; index < count; index++) {
+		uint16_t offset = index * this->fragmentSize;
+		uint8_t length = (size - offset > this->fragmentSize) ? this->fragmentSize : size - offset;
+
+		frame[4] = index;
+		memcpy(frame + E220_FRAGMENT_HEADER_SIZE, data + offset, length);
+
+		status = this->e220->sendFixedMessage(ADDH, ADDL, CHAN, frame, E220_FRAGMENT_HEADER_SIZE + length);
+		if (status.code != E220_SUCCESS) return status;
+	}
+
+	return status;
+}
+
+LoRa_E220_Reassembler::LoRa_E220_Reassembler(void *storage, uint16_t size, uint8_t slots, unsigned long timeout){
+	if (slots == 0) slots = 1;
+	if (slots > E220_FRAGMENT_SLOTS) slots = E220_FRAGMENT_SLOTS;
+
+	this->storage = (uint8_t *)storage;
+	this->slotCount = slots;
+	this->slotSize = size / slots;
+	this->timeout = timeout;
+
+	for (uint8_t i = 0; i < E220_FRAGMENT_SLOTS; i++) {
+		this->slots[i].used = false;
+	}
+}
+
+void LoRa_E220_Reassembler::poll(){
+	for (uint8_t i = 0; i < this->slotCount; i++) {
+		Slot &slot = this->slots[i];
+		if (slot.used && (int8_t)i != this->completed && (millis() - slot.since) > this->timeout) {
+			DEBUG_PRINTLN(F("Fragment timeout, partial payload dropped"));
+			slot.used = false;
+			this->dropped++;
+		}
+	}
+}
+
+Status LoRa_E220_Reassembler::push(const void *frame, uint16_t length){
+	const uint8_t *fragment = (const uint8_t *)frame;
+
+	// the payload returned by the previous push() is released now
+	if (this->completed >= 0) {
+		this->slots[this->completed].used = false;
+		this->completed = -1;
+	}
+	this->poll();
+
+	if (length < E220_FRAGMENT_HEADER_SIZE || fragment[0] != E220_FRAGMENT_MAGIC) {
+		return ERR_E220_WRONG_FORMAT;
+	}
+
+	uint16_t origin = ((uint16_t)fragment[1] << 8) | fragment[2];
+	uint8_t id = fragment[3];
+	uint8_t index = fragment[4];
+	uint8_t count = fragment[5];
+	uint8_t fragmentSize = fragment[6];
+	uint16_t dataLength = length - E220_FRAGMENT_HEADER_SIZE;
+
+	if (count == 0 || index >= count || fragmentSize == 0 || dataLength > fragmentSize
+			|| (index + 1 < count && dataLength != fragmentSize)) {
+		return ERR_E220_WRONG_FORMAT;
+	}
+	if ((uint32_t)index * fragmentSize + dataLength > this->slotSize) {
+		return ERR_E220_PACKET_TOO_BIG;
+	}
+
+	int8_t empty = -1;
+	int8_t found = -1;
+	for (uint8_t i = 0; i < this->slotCount && found < 0; i++) {
+		Slot &slot = this->slots[i];
+		if (!slot.used) {
+			if (empty < 0) empty = i;
+		} else if (slot.origin == origin) {
+			if (slot.id == id && slot.count == count && slot.fragmentSize == fragmentSize) {
+				found = i;
+			} else {
+				// the sender moved on to another payload: the old one will never complete
+				slot.used = false;
+				this->dropped++;
+				if (empty < 0) empty = i;
+			}
+		}
+	}
+
+	if (found < 0) {
+		if (empty < 0) {
+			DEBUG_PRINTLN(F("No free fragment slot, fragment dropped"));
+			return ERR_E220_BUF_TOO_SMALL;
+		}
+
+		Slot &slot = this->slots[empty];
+		slot.used = true;
+		slot.origin = origin;
+		slot.id = id;
+		slot.count = count;
+		slot.fragmentSize = fragmentSize;
+		slot.received = 0;
+		slot.size = 0;
+		memset(slot.map, 0, sizeof(slot.map));
+		found = empty;
+	}
+
+	Slot &slot = this->slots[found];
+	slot.since = millis();
+
+	if (!(slot.map[index >> 3] & (1 << (index & 7)))) {
+		slot.map[index >> 3] |= (1 << (index & 7));
+		slot.received++;
+		memcpy(this->slotData(found) + (uint16_t)index * fragmentSize, fragment + E220_FRAGMENT_HEADER_SIZE, dataLength);
+		if (index + 1 == count) {
+			slot.size = (uint16_t)index * fragmentSize + dataLength;
+		}
+	}
+
+	if (slot.received < slot.count) return ERR_E220_BUSY;
+
+	this->completed = found;
+	return E220_SUCCESS;
+}
+
+bool LoRa_E220_Reassembler::getMessage(const uint8_t *&message, uint16_t &size, uint16_t &origin){
+	if (this->completed < 0) return false;
+
+	Slot &slot = this->slots[this->completed];
+	message = this->slotData(this->completed);
+	size = slot.size;
+	origin = slot.origin;
+	return true;
+}
@@ -0,0 +1,183 @@
+/**
+ * @file LoRa_E220_Fragment.h
+ * @brief Fragmentation and reassembly of payloads larger than a packet
+ *
+ * A fixed transmission carries at most MAX_SIZE_TX_PACKET bytes, and the
+ * module splits anything larger than its sub packet size into separate
+ * radio packets the receiver cannot tell apart. LoRa_E220_Fragmenter cuts a
+ * payload into fragments that each fit one sub packet, with a header that
+ * lets LoRa_E220_Reassembler put them back together.
+ *
+ * Fragment layout (payload of a fixed transmission):
+ * @code
+ * E220_FRAGMENT_MAGIC | ADDH | ADDL | id | index | count | fragment size | data
+ * @endcode
+ * ADDH/ADDL is the sender address, so fragments of different senders never mix.
+ *
+ * @author Alteriom
+ *
+ * @note The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Alteriom - Enhancements and CI/CD improvements
+ */
+#ifndef LoRa_E220_Fragment_h
+#define LoRa_E220_Fragment_h
+
+#include "LoRa_E220.h"
+
+/**
+ * @brief First byte of a fragment
+ */
+#define E220_FRAGMENT_MAGIC 0xF7
+
+/**
+ * @brief Size of the fragment header
+ */
+#define E220_FRAGMENT_HEADER_SIZE 7
+
+/**
+ * @brief Maximum number of payloads reassembled at the same time
+ */
+#ifndef E220_FRAGMENT_SLOTS
+	#define E220_FRAGMENT_SLOTS 2
+#endif
+
+/**
+ * @brief Sends payloads of any size (up to 255 fragments) in fixed transmission
+ *
+ * @example Sending a 2 KB blob:
+ * @code
+ * LoRa_E220_Fragmenter fragmenter(e220ttl, 0x00, 0x03, SPS_064_10);
+ * ResponseStatus status = fragmenter.send(0x00, 0x01, 23, blob, sizeof(blob));
+ * @endcode
+ */
+class LoRa_E220_Fragmenter {
+	public:
+		/**
+		 * @brief Create a fragmenter sending through an initialized device
+		 * @param e220 Device used for the transmissions
+		 * @param ADDH High byte of this device address, written in every fragment
+		 * @param ADDL Low byte of this device address, written in every fragment
+		 * @param subPacketSetting Sub packet size configured on the modules
+		 */
+		LoRa_E220_Fragmenter(LoRa_E220 &e220, byte ADDH, byte ADDL, SUB_PACKET_SETTING subPacketSetting = SPS_200_00);
+
+		/**
+		 * @brief Send a payload as a sequence of fragments
+		 * @param ADDH High address byte of the receiver
+		 * @param ADDL Low address byte of the receiver
+		 * @param CHAN Channel number (0-255)
+		 * @param message Pointer to the payload
+		 * @param size Number of bytes
+		 * @return ResponseStatus of the first failed fragment, or E220_SUCCESS;
+		 *         ERR_E220_PACKET_TOO_BIG if it needs more than 255 fragments
+		 */
+		ResponseStatus send(byte ADDH, byte ADDL, byte CHAN, const void *message, uint16_t size);
+
+		/**
+		 * @brief Payload bytes carried by each fragment
+		 */
+		uint8_t getFragmentSize() { return this->fragmentSize; }
+
+	private:
+		LoRa_E220 *e220;
+		byte ADDH;
+		byte ADDL;
+		uint8_t fragmentSize;
+		uint8_t id = 0;
+};
+
+/**
+ * @brief Rebuilds payloads from received fragments into caller-provided memory
+ *
+ * The storage is split into equal slots, one per payload being reassembled.
+ * A partial payload is dropped when no fragment arrived for the timeout.
+ *
+ * @example Receiving blobs:
+ * @code
+ * uint8_t storage[4096];
+ * LoRa_E220_Reassembler reassembler(storage, sizeof(storage), 1, 2000);
+ *
+ * void loop() {
+ *     uint8_t frame[MAX_SIZE_TX_PACKET];
+ *     uint16_t length;
+ *     if (e220ttl.pollFrame(frame, sizeof(frame), length) == E220_SUCCESS
+ *             && reassembler.push(frame, length) == E220_SUCCESS) {
+ *         const uint8_t *blob;
+ *         uint16_t size, origin;
+ *         reassembler.getMessage(blob, size, origin);
+ *         // Process size bytes from origin...
+ *     }
+ *     reassembler.poll();
+ * }
+ * @endcode
+ */
+class LoRa_E220_Reassembler {
+	public:
+		/**
+		 * @param storage Caller memory for the payloads
+		 * @param size Size of the storage
+		 * @param slots Payloads reassembled at the same time (max E220_FRAGMENT_SLOTS)
+		 * @param timeout Milliseconds after which a partial payload is dropped
+		 */
+		LoRa_E220_Reassembler(void *storage, uint16_t size, uint8_t slots = 1, unsigned long timeout = 5000);
+
+		/**
+		 * @brief Add a received fragment
+		 * @param frame Received frame
+		 * @param length Number of bytes in the frame
+		 * @return E220_SUCCESS when it completes a payload (see getMessage()),
+		 *         ERR_E220_BUSY when more fragments are needed,
+		 *         ERR_E220_WRONG_FORMAT if the frame is not a fragment,
+		 *         ERR_E220_PACKET_TOO_BIG if the payload does not fit a slot,
+		 *         ERR_E220_BUF_TOO_SMALL if every slot holds another payload:
+		 *         the fragment is dropped, so its payload can no longer complete
+		 *
+		 * @note The completed payload is valid until the next push()
+		 */
+		Status push(const void *frame, uint16_t length);
+
+		/**
+		 * @brief Get the payload completed by the last push()
+		 * @param message Set to the payload, in the storage
+		 * @param size Set to the payload size
+		 * @param origin Set to the sender address (ADDH << 8 | ADDL)
+		 * @return false if the last push() did not complete a payload
+		 */
+		bool getMessage(const uint8_t *&message, uint16_t &size, uint16_t &origin);
+
+		/**
+		 * @brief Drop the partial payloads older than the timeout
+		 * @note Call it from the loop, push() also does it
+		 */
+		void poll();
+
+		/** Number of partial payloads dropped on timeout */
+		unsigned long getDropped() { return this->dropped; }
+
+	private:
+		struct Slot {
+			bool used;
+			uint16_t origin;
+			uint8_t id;
+			uint8_t count;
+			uint8_t received;        ///< Distinct fragments received
+			uint8_t fragmentSize;
+			uint16_t size;           ///< Payload size, known with the last fragment
+			unsigned long since;     ///< millis() of the last fragment
+			uint8_t map[32];         ///< One bit per received fragment
+		};
+
+		uint8_t *storage;
+		uint16_t slotSize;
+		uint8_t slotCount;
+		unsigned long timeout;
+		Slot slots[E220_FRAGMENT_SLOTS];
+		int8_t completed = -1;
+
+		unsigned long dropped = 0;
+
+		uint8_t *slotData(uint8_t slot) { return this->storage + (uint16_t)slot * this->slotSize; }
+};
+
+#endif
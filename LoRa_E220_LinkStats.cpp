@@ -0,0 +1,167 @@
+/**
+ * @file LoRa_E220_LinkStats.cpp
+ * @brief Implementation of the per-source link quality statistics
+ *
+ * @author Alteriom
+ *
+ * @note The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Alteriom - Enhancements and CI/CD improvements
+ */
+
+#include "LoRa_E220_LinkStats.h"
+
+LoRa_E220_LinkStats::LoRa_E220_LinkStats(LinkStatsEntry *table, uint16_t capacity, uint8_t smoothing){
+	this->table = table;
+	this->capacity = capacity;
+	this->smoothing = (smoothing > 8) ? 8 : smoothing;
+	this->clear();
+}
+
+void LoRa_E220_LinkStats::clear(){
+	for (uint16_t i = 0; i < this->capacity; i++) {
+		this->table[i].used = false;
+	}
+	this->sources = 0;
+	this->evictions = 0;
+}
+
+uint16_t LoRa_E220_LinkStats::hash(uint16_t address) const {
+	// multiplicative hash: nearby addresses land apart
+	return (uint16_t)(address * 40503U) % this->capacity;
+}
+
+const LinkStatsEntry *LoRa_E220_LinkStats::find(byte ADDH, byte ADDL) const {
+	if (this->capacity == 0) return NULL;
+
+	uint16_t address = ((uint16_t)ADDH << 8) | ADDL;
+	uint16_t slot = this->hash(address);
+	uint16_t probes = (this->capacity < E220_LINK_STATS_PROBES) ? this->capacity : E220_LINK_STATS_PROBES;
+	for (uint16_t i = 0; i < probes; i++) {
+		const LinkStatsEntry &entry = this->table[slot];
+		if (entry.used && entry.address == address) return &entry;
+		if (++slot == this->capacity) slot = 0;
+	}
+	return NULL;
+}
+
+/*
+
+The whole probe window is scanned, so replacing an entry in place never hides
+another one: no tombstones are needed
+
+*/
+
+LinkStatsEntry *LoRa_E220_LinkStats::lookup(uint16_t address){
+	if (this->capacity == 0) return NULL;
+
+	uint16_t slot = this->hash(address);
+	uint16_t probes = (this->capacity < E220_LINK_STATS_PROBES) ? this->capacity : E220_LINK_STATS_PROBES;
+	LinkStatsEntry *empty = NULL;
+	LinkStatsEntry *oldest = NULL;
+	for (uint16_t i = 0; i < probes; i++) {
+		LinkStatsEntry &entry = this->table[slot];
+		if (!entry.used) {
+			if (!empty) empty = &entry;
+		} else if (entry.address == address) {
+			return &entry;
+		} else if (!oldest || (long)(entry.lastSeen - oldest->lastSeen) < 0) {
+			oldest = &entry;
+		}
+		if (++slot == this->capacity) slot = 0;
+	}
+
+	LinkStatsEntry *entry = empty;
+	if (entry) {
+		this->sources++;
+	} else {
+		DEBUG_PRINTLN(F("Link stats: table full, oldest source replaced"));
+		entry = oldest;
+		this->evictions++;
+	}
+
+	memset(entry, 0, sizeof(LinkStatsEntry));
+	entry->used = true;
+	entry->address = address;
+	return entry;
+}
+
+void LoRa_E220_LinkStats::sample(LinkStatsEntry &entry, uint8_t rssi){
+	entry.lastRSSI = rssi;
+	entry.lastSeen = millis();
+
+	if (entry.received == 0) {
+		entry.mean = (uint16_t)rssi << 8;
+		entry.variance = 0;
+		entry.minRSSI = rssi;
+		entry.maxRSSI = rssi;
+	} else {
+		/* EWMA of mean and variance: var = (1 - a) (var + a diff^2) */
+		int32_t diff = ((int32_t)rssi << 8) - entry.mean;
+		uint32_t magnitude = (diff < 0) ? -diff : diff;
+		uint32_t square = (magnitude * magnitude) >> 8;
+		entry.mean = (uint16_t)(entry.mean + diff / (1 << this->smoothing));
+		entry.variance += square >> this->smoothing;
+		entry.variance -= entry.variance >> this->smoothing;
+		if (rssi < entry.minRSSI) entry.minRSSI = rssi;
+		if (rssi > entry.maxRSSI) entry.maxRSSI = rssi;
+	}
+
+	uint8_t bin = 0;
+	if (rssi >= E220_LINK_STATS_HISTOGRAM_MIN) {
+		bin = (rssi - E220_LINK_STATS_HISTOGRAM_MIN) / E220_LINK_STATS_BIN_WIDTH;
+		if (bin >= E220_LINK_STATS_BINS) bin = E220_LINK_STATS_BINS - 1;
+	}
+	if (entry.histogram[bin] == 0xFF) {
+		// keep the shape of the distribution, weighted to recent packets
+		for (uint8_t i = 0; i < E220_LINK_STATS_BINS; i++) entry.histogram[i] >>= 1;
+	}
+	entry.histogram[bin]++;
+}
+
+const LinkStatsEntry *LoRa_E220_LinkStats::update(byte ADDH, byte ADDL, byte rssi){
+	LinkStatsEntry *entry = this->lookup(((uint16_t)ADDH << 8) | ADDL);
+	if (!entry) return NULL;
+
+	this->sample(*entry, rssi);
+	if (entry->received < 0xFFFF) entry->received++;
+	return entry;
+}
+
+const LinkStatsEntry *LoRa_E220_LinkStats::update(byte ADDH, byte ADDL, byte rssi, uint8_t sequence){
+	LinkStatsEntry *entry = this->lookup(((uint16_t)ADDH << 8) | ADDL);
+	if (!entry) return NULL;
+
+	this->sample(*entry, rssi);
+
+	uint8_t gap = sequence - entry->lastSequence;
+	if (entry->sequenced && gap == 0) return entry;
+
+	if (entry->sequenced && gap < 0x80) {
+		uint32_t lost = (uint32_t)entry->lost + gap - 1;
+		entry->lost = (lost > 0xFFFF) ? 0xFFFF : lost;
+	}
+	entry->sequenced = true;
+	entry->lastSequence = sequence;
+	if (entry->received < 0xFFFF) entry->received++;
+	return entry;
+}
+
+uint16_t LoRa_E220_LinkStats::getWeakest(const LinkStatsEntry **entries, uint16_t count) const {
+	uint16_t found = 0;
+	for (uint16_t i = 0; i < this->capacity; i++) {
+		const LinkStatsEntry *entry = &this->table[i];
+		if (!entry->used) continue;
+
+		// insertion in the sorted result, the table is walked once
+		uint16_t position = found;
+		while (position > 0 && entries[position - 1]->mean > entry->mean) position--;
+		if (position >= count) continue;
+
+		uint16_t last = (found < count) ? found : count - 1;
+		for (uint16_t j = last; j > position; j--) entries[j] = entries[j - 1];
+		entries[position] = entry;
+		if (found < count) found++;
+	}
+	return found;
+}
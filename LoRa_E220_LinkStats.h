@@ -0,0 +1,170 @@
+/**
+ * @file LoRa_E220_LinkStats.h
+ * @brief Per-source link quality statistics in a fixed-size table
+ *
+ * The module appends one RSSI byte to each received packet and the library
+ * keeps no history. LoRa_E220_LinkStats keeps, for each source address,
+ * running statistics updated in constant time: exponentially weighted mean
+ * and variance, minimum and maximum, a histogram and the packets lost
+ * according to the sequence numbers carried by the application.
+ *
+ * The table is an array supplied by the caller, searched by open
+ * addressing on the address: no allocation, and a lookup touches a few
+ * consecutive entries. When a source does not find a free entry within
+ * E220_LINK_STATS_PROBES, it replaces the least recently updated one.
+ *
+ * @author Alteriom
+ *
+ * @note The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Alteriom - Enhancements and CI/CD improvements
+ */
+#ifndef LoRa_E220_LinkStats_h
+#define LoRa_E220_LinkStats_h
+
+#include "LoRa_E220.h"
+
+/**
+ * @brief Histogram bins of an entry
+ */
+#ifndef E220_LINK_STATS_BINS
+	#define E220_LINK_STATS_BINS 8
+#endif
+
+/**
+ * @brief Lowest RSSI byte of the histogram (128 is -128 dBm), lower values go in the first bin
+ */
+#ifndef E220_LINK_STATS_HISTOGRAM_MIN
+	#define E220_LINK_STATS_HISTOGRAM_MIN 128
+#endif
+
+/**
+ * @brief Width, in RSSI units (dB), of a histogram bin; higher values go in the last bin
+ */
+#ifndef E220_LINK_STATS_BIN_WIDTH
+	#define E220_LINK_STATS_BIN_WIDTH 16
+#endif
+
+/**
+ * @brief Entries inspected for a source before replacing one
+ */
+#ifndef E220_LINK_STATS_PROBES
+	#define E220_LINK_STATS_PROBES 8
+#endif
+
+/**
+ * @brief Statistics of one source address
+ *
+ * The mean and the variance are in RSSI units (the byte returned by the
+ * module), with 8 fractional bits.
+ */
+struct LinkStatsEntry {
+	uint16_t address;        ///< ADDH << 8 | ADDL
+	bool used;
+	bool sequenced;          ///< lastSequence is valid
+	uint8_t lastSequence;
+	uint8_t minRSSI;
+	uint8_t maxRSSI;
+	uint8_t lastRSSI;
+	uint16_t mean;           ///< EWMA of the RSSI, 8 fractional bits
+	uint32_t variance;       ///< EWMA of the squared deviation, 8 fractional bits
+	uint16_t received;       ///< Packets counted, saturates at 65535
+	uint16_t lost;           ///< Packets missing from the sequence, saturates at 65535
+	unsigned long lastSeen;  ///< millis() of the last packet
+	uint8_t histogram[E220_LINK_STATS_BINS]; ///< Halved when a bin would overflow
+
+	/** Mean RSSI in dBm */
+	int16_t getMeanDbm() const { return getRSSIdBm((this->mean + 128) >> 8); }
+	/** Variance, in dB squared */
+	uint16_t getVariance() const { return (this->variance + 128) >> 8; }
+	/** Share of the sequenced packets lost, in percent */
+	uint8_t getLossPercent() const {
+		uint32_t total = (uint32_t)this->received + this->lost;
+		return total == 0 ? 0 : (uint8_t)((uint32_t)this->lost * 100 / total);
+	}
+};
+
+/**
+ * @brief Per-source RSSI statistics, O(1) per packet and no allocation
+ *
+ * @example Ranking the nodes heard by a gateway:
+ * @code
+ * LinkStatsEntry table[512];
+ * LoRa_E220_LinkStats linkStats(table, 512);
+ *
+ * // for each packet, the source and the sequence number come from the payload
+ * linkStats.update(reading.ADDH, reading.ADDL, rssi, reading.sequence);
+ *
+ * const LinkStatsEntry *weakest[5];
+ * uint16_t found = linkStats.getWeakest(weakest, 5);
+ * for (uint16_t i = 0; i < found; i++) {
+ *     Serial.print(weakest[i]->address, HEX);
+ *     Serial.print(F(": "));
+ *     Serial.print(weakest[i]->getMeanDbm());
+ *     Serial.println(F(" dBm"));
+ * }
+ * @endcode
+ */
+class LoRa_E220_LinkStats {
+	public:
+		/**
+		 * @param table Entries, kept by the caller
+		 * @param capacity Number of entries, a few more than the sources expected
+		 * @param smoothing Weight of a new sample is 1 / 2^smoothing (3: 1/8)
+		 */
+		LoRa_E220_LinkStats(LinkStatsEntry *table, uint16_t capacity, uint8_t smoothing = 3);
+
+		/**
+		 * @brief Account a packet without sequence number
+		 * @return Entry of the source
+		 */
+		const LinkStatsEntry *update(byte ADDH, byte ADDL, byte rssi);
+
+		/**
+		 * @brief Account a packet and its sequence number (8 bits, wrapping)
+		 *
+		 * A gap forward counts the missing packets as lost. A repeated number
+		 * updates the RSSI only; a jump back (reboot of the node) restarts the
+		 * sequence.
+		 * @return Entry of the source
+		 */
+		const LinkStatsEntry *update(byte ADDH, byte ADDL, byte rssi, uint8_t sequence);
+
+		/**
+		 * @brief Statistics of a source
+		 * @return NULL if the source is not in the table
+		 */
+		const LinkStatsEntry *find(byte ADDH, byte ADDL) const;
+
+		/**
+		 * @brief The sources with the lowest mean RSSI, weakest first
+		 * @param entries Filled with up to count entries
+		 * @param count Size of entries
+		 * @return Number of entries filled
+		 */
+		uint16_t getWeakest(const LinkStatsEntry **entries, uint16_t count) const;
+
+		/** Forget every source */
+		void clear();
+
+		/** Sources in the table */
+		uint16_t getSources() const { return this->sources; }
+		/** Sources replaced for lack of room */
+		unsigned long getEvictions() const { return this->evictions; }
+		/** Entry by position, for iterating the table (check used) */
+		const LinkStatsEntry &getEntry(uint16_t index) const { return this->table[index]; }
+		uint16_t getCapacity() const { return this->capacity; }
+
+	private:
+		LinkStatsEntry *table;
+		uint16_t capacity;
+		uint8_t smoothing;
+		uint16_t sources = 0;
+		unsigned long evictions = 0;
+
+		uint16_t hash(uint16_t address) const;
+		LinkStatsEntry *lookup(uint16_t address);
+		void sample(LinkStatsEntry &entry, uint8_t rssi);
+};
+
+#endif
@@ -0,0 +1,67 @@
+/**
+ * @file LoRa_E220_Noise.cpp
+ * @brief Implementation of the ambient noise sampler
+ *
+ * @author Alteriom
+ *
+ * @note The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Alteriom - Enhancements and CI/CD improvements
+ */
+
+#include "LoRa_E220_Noise.h"
+
+LoRa_E220_NoiseSampler::LoRa_E220_NoiseSampler(LoRa_E220 &e220, unsigned long period, uint8_t smoothing){
+	this->e220 = &e220;
+	this->period = period;
+	this->smoothing = (smoothing > 8) ? 8 : smoothing;
+}
+
+bool LoRa_E220_NoiseSampler::poll(){
+	if (!this->waiting) {
+		if (this->samples + this->failures > 0 && (millis() - this->requestedAt) < this->period) return false;
+
+		Status request = this->e220->requestRSSI().code;
+		if (request == ERR_E220_BUSY) return false;  // busy module: try again on the next call
+		if (request != E220_SUCCESS) {
+			// RSSI disabled or wrong mode: count it and try again after a period
+			this->failures++;
+			this->requestedAt = millis();
+			return false;
+		}
+		this->waiting = true;
+		this->requestedAt = millis();
+		return false;
+	}
+
+	byte ambient, lastPacket;
+	Status result = this->e220->pollRSSI(ambient, lastPacket);
+	if (result == ERR_E220_BUSY) {
+		if ((millis() - this->requestedAt) <= E220_RSSI_TIMEOUT) return false;
+		result = ERR_E220_TIMEOUT;
+	}
+	this->waiting = false;
+
+	if (result != E220_SUCCESS) {
+		DEBUG_PRINTLN(F("Noise sample failed"));
+		this->failures++;
+		return false;
+	}
+
+	this->ambient = ambient;
+	this->lastPacket = lastPacket;
+	this->sampledAt = millis();
+	if (this->samples == 0) {
+		this->floor = (uint16_t)ambient << 8;
+	} else {
+		int32_t diff = ((int32_t)ambient << 8) - this->floor;
+		this->floor = (uint16_t)(this->floor + diff / (1 << this->smoothing));
+	}
+	this->samples++;
+	return true;
+}
+
+bool LoRa_E220_NoiseSampler::isChannelClear(int16_t thresholdDbm){
+	if (this->samples == 0 || (millis() - this->sampledAt) > 2 * this->period) return false;
+	return getRSSIdBm(this->ambient) < thresholdDbm;
+}
@@ -0,0 +1,94 @@
+/**
+ * @file LoRa_E220_Noise.h
+ * @brief Periodic ambient noise sampling spread across loop iterations
+ *
+ * readRSSI() waits a few milliseconds for the module. LoRa_E220_NoiseSampler
+ * sends the read from one call of poll() and collects the answer in a later
+ * one, so the loop never waits; it keeps the last sample and a smoothed
+ * noise floor for deciding when to transmit.
+ *
+ * @author Alteriom
+ *
+ * @note The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Alteriom - Enhancements and CI/CD improvements
+ */
+#ifndef LoRa_E220_Noise_h
+#define LoRa_E220_Noise_h
+
+#include "LoRa_E220.h"
+
+/**
+ * @brief Samples the ambient noise RSSI register without blocking
+ *
+ * A sample is skipped, not failed, while the module is receiving or
+ * sending: the next poll() tries again.
+ *
+ * @note Needs RSSI ambient noise enabled in the configuration
+ *
+ * @example Sending when the channel is quiet:
+ * @code
+ * LoRa_E220_NoiseSampler noise(e220ttl, 50);
+ *
+ * void loop() {
+ *     noise.poll();
+ *     if (pending && noise.isChannelClear(-95)) {
+ *         e220ttl.sendFixedMessage(0x00, 0x02, 23, &reading, sizeof(reading));
+ *         pending = false;
+ *     }
+ * }
+ * @endcode
+ */
+class LoRa_E220_NoiseSampler {
+	public:
+		/**
+		 * @param e220 Initialized device, in normal mode
+		 * @param period Milliseconds between samples
+		 * @param smoothing Weight of a new sample in the noise floor is 1 / 2^smoothing
+		 */
+		LoRa_E220_NoiseSampler(LoRa_E220 &e220, unsigned long period = 100, uint8_t smoothing = 2);
+
+		/**
+		 * @brief Send the next read when due, or collect the answer
+		 * @return true if a new sample was stored by this call
+		 */
+		bool poll();
+
+		/** A sample was taken */
+		bool hasSample() { return this->samples > 0; }
+		/** RSSI byte of the last ambient noise sample */
+		byte getAmbientRSSI() { return this->ambient; }
+		/** RSSI byte of the last packet received, as read with the last sample */
+		byte getLastPacketRSSI() { return this->lastPacket; }
+		/** Smoothed ambient noise, in dBm */
+		int16_t getNoiseFloorDbm() { return getRSSIdBm((this->floor + 128) >> 8); }
+		/** millis() of the last sample */
+		unsigned long getSampledAt() { return this->sampledAt; }
+
+		/**
+		 * @brief The last sample is below a level and not older than two periods
+		 * @param thresholdDbm Highest acceptable noise, in dBm
+		 */
+		bool isChannelClear(int16_t thresholdDbm);
+
+		/** Samples stored */
+		unsigned long getSamples() { return this->samples; }
+		/** Reads refused (RSSI disabled, wrong mode) or without a valid answer */
+		unsigned long getFailures() { return this->failures; }
+
+	private:
+		LoRa_E220 *e220;
+		unsigned long period;
+		uint8_t smoothing;
+
+		bool waiting = false;         ///< Read sent, answer pending
+		unsigned long requestedAt = 0;
+		unsigned long sampledAt = 0;
+		byte ambient = 0;
+		byte lastPacket = 0;
+		uint16_t floor = 0;           ///< EWMA of the ambient RSSI, 8 fractional bits
+		unsigned long samples = 0;
+		unsigned long failures = 0;
+};
+
+#endif
@@ -0,0 +1,165 @@
+/**
+ * @file LoRa_E220_RemoteConfig.cpp
+ * @brief Implementation of the acknowledged remote configuration
+ *
+ * @author Alteriom
+ *
+ * @note The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Alteriom - Enhancements and CI/CD improvements
+ */
+
+#include "LoRa_E220_RemoteConfig.h"
+
+LoRa_E220_RemoteConfig::LoRa_E220_RemoteConfig(LoRa_E220 &e220, RemoteConfigTarget *targets, uint16_t count,
+		uint8_t window, unsigned long timeout, uint8_t maxAttempts){
+	this->e220 = &e220;
+	this->targets = targets;
+	this->count = count;
+	this->window = (window == 0) ? 1 : window;
+	this->timeout = timeout;
+	this->maxAttempts = (maxAttempts == 0) ? 1 : maxAttempts;
+}
+
+void LoRa_E220_RemoteConfig::begin(const Configuration &configuration, PROGRAM_COMMAND saveType){
+	this->command[0] = SPECIAL_WIFI_CONF_COMMAND;
+	this->command[1] = SPECIAL_WIFI_CONF_COMMAND;
+	this->command[2] = saveType;
+	this->command[3] = REG_ADDRESS_CFG;
+	this->command[4] = PL_CONFIGURATION;
+	memcpy(this->command + 5, &configuration.ADDH, PL_CONFIGURATION);
+
+	for (uint16_t i = 0; i < this->count; i++) {
+		RemoteConfigTarget &target = this->targets[i];
+		target.status = ERR_E220_BUSY;
+		target.attempts = 0;
+		target.waiting = false;
+		target.sentAt = 0;
+	}
+
+	this->sending = NULL;
+	this->next = 0;
+	this->waiting = 0;
+	this->succeeded = 0;
+	this->failed = 0;
+	this->commandsSent = 0;
+	this->running = this->count > 0;
+}
+
+bool LoRa_E220_RemoteConfig::poll(){
+	if (!this->running) return false;
+
+	/* the send in progress first: a failed write is retried like a lost echo */
+	if (this->sending) {
+		SEND_STATE state = this->e220->poll();
+		if (state == SEND_COMPLETE || state == SEND_FAILED) {
+			RemoteConfigTarget &target = *this->sending;
+			this->sending = NULL;
+			if (state == SEND_FAILED && target.waiting) {
+				target.waiting = false;
+				this->waiting--;
+				if (target.attempts >= this->maxAttempts) {
+					this->finish(target, this->e220->getSendStatus().code);
+				}
+			}
+		}
+	}
+
+	this->receive();
+	this->expire();
+	this->sendNext();
+
+	this->running = this->succeeded + this->failed < this->count;
+	return this->running;
+}
+
+void LoRa_E220_RemoteConfig::receive(){
+	uint16_t length;
+	Status result = this->e220->pollFrame(this->frame, sizeof(this->frame), length);
+	if (result != E220_SUCCESS) return;
+
+	/* CF CF C1 00 08 and the registers, an optional RSSI byte after them */
+	if (length < E220_REMOTE_CONFIG_COMMAND_SIZE || this->frame[0] != SPECIAL_WIFI_CONF_COMMAND
+			|| this->frame[1] != SPECIAL_WIFI_CONF_COMMAND || this->frame[2] != RETURNED_COMMAND
+			|| this->frame[3] != REG_ADDRESS_CFG || this->frame[4] != PL_CONFIGURATION) {
+		DEBUG_PRINTLN(F("Remote config: frame ignored"));
+		return;
+	}
+
+	const uint8_t *registers = this->frame + 5;
+	for (uint16_t i = 0; i < this->count; i++) {
+		RemoteConfigTarget &target = this->targets[i];
+		if (!target.waiting || target.ADDH != registers[0] || target.ADDL != registers[1]) continue;
+
+		target.waiting = false;
+		this->waiting--;
+
+		/* CRYPT is write only, it reads back as 0; the channel is the target's own,
+		   the command holds the one of the last target sent */
+		const uint8_t *pushed = this->command + 5;
+		bool same = registers[REG_ADDRESS_SPED] == pushed[REG_ADDRESS_SPED]
+				&& registers[REG_ADDRESS_OPTION] == pushed[REG_ADDRESS_OPTION]
+				&& registers[REG_ADDRESS_TRANS_MODE] == pushed[REG_ADDRESS_TRANS_MODE]
+				&& registers[REG_ADDRESS_CHANNEL] == target.CHAN;
+		this->finish(target, same ? E220_SUCCESS : ERR_E220_INVALID_PARAM);
+		return;
+	}
+}
+
+void LoRa_E220_RemoteConfig::expire(){
+	for (uint16_t i = 0; i < this->count; i++) {
+		RemoteConfigTarget &target = this->targets[i];
+		if (!target.waiting || &target == this->sending || (millis() - target.sentAt) <= this->timeout) continue;
+
+		DEBUG_PRINT(F("Remote config: no echo from "));
+		DEBUG_PRINTLN(((uint16_t)target.ADDH << 8) | target.ADDL);
+
+		target.waiting = false;
+		this->waiting--;
+		if (target.attempts >= this->maxAttempts) {
+			this->finish(target, ERR_E220_NO_RESPONSE_FROM_DEVICE);
+		}
+	}
+}
+
+void LoRa_E220_RemoteConfig::sendNext(){
+	if (this->sending || this->waiting >= this->window || this->e220->isSendPending()) return;
+
+	for (uint16_t n = 0; n < this->count; n++) {
+		uint16_t i = (this->next + n) % this->count;
+		RemoteConfigTarget &target = this->targets[i];
+		if (target.status != ERR_E220_BUSY || target.waiting) continue;
+
+		/* the node keeps its address and channel */
+		this->command[5] = target.ADDH;
+		this->command[6] = target.ADDL;
+		this->command[5 + REG_ADDRESS_CHANNEL] = target.CHAN;
+
+		target.attempts++;
+		target.waiting = true;
+		target.sentAt = millis();
+		this->waiting++;
+		this->commandsSent++;
+		this->next = (i + 1) % this->count;
+
+		ResponseStatus status = this->e220->beginSendFixedMessage(target.ADDH, target.ADDL, target.CHAN,
+				this->command, sizeof(this->command));
+		if (status.code == E220_SUCCESS) {
+			this->sending = &target;
+		} else {
+			target.waiting = false;
+			this->waiting--;
+			if (target.attempts >= this->maxAttempts) this->finish(target, status.code);
+		}
+		return;
+	}
+}
+
+void LoRa_E220_RemoteConfig::finish(RemoteConfigTarget &target, Status status){
+	target.status = status;
+	if (status == E220_SUCCESS) {
+		this->succeeded++;
+	} else {
+		this->failed++;
+	}
+}
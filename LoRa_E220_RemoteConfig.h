@@ -0,0 +1,139 @@
+/**
+ * @file LoRa_E220_RemoteConfig.h
+ * @brief Acknowledged remote configuration of a list of nodes
+ *
+ * A module in normal mode that receives CF CF followed by a program mode
+ * command runs it and sends the answer back on air, prefixed with CF CF.
+ * sendConfigurationMessage() only sends the command. LoRa_E220_RemoteConfig
+ * pushes a configuration to a list of nodes, matches the echoed registers to
+ * the node by its address, retries the nodes that did not answer and keeps
+ * several commands in flight, so a silent node costs one timeout in
+ * parallel with the others instead of one after the other.
+ *
+ * Each node keeps its own address: ADDH and ADDL of the configuration are
+ * replaced by those of the target, which also identify the echo (the
+ * answer carries no source address).
+ *
+ * @author Alteriom
+ *
+ * @note The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Alteriom - Enhancements and CI/CD improvements
+ */
+#ifndef LoRa_E220_RemoteConfig_h
+#define LoRa_E220_RemoteConfig_h
+
+#include "LoRa_E220.h"
+
+/**
+ * @brief Bytes of a remote configuration command: CF CF, command, address, length, registers
+ */
+#define E220_REMOTE_CONFIG_COMMAND_SIZE (2 + 3 + PL_CONFIGURATION)
+
+/**
+ * @brief A node to configure and its result
+ *
+ * Fill ADDH, ADDL and CHAN; begin() resets the other fields.
+ */
+struct RemoteConfigTarget {
+	byte ADDH;            ///< Address of the node
+	byte ADDL;
+	byte CHAN;            ///< Channel the node listens on
+	Status status;        ///< ERR_E220_BUSY while in progress, then E220_SUCCESS,
+	                      ///< ERR_E220_NO_RESPONSE_FROM_DEVICE (no echo), ERR_E220_INVALID_PARAM
+	                      ///< (echo with other values) or the error of the last send
+	uint8_t attempts;     ///< Commands sent to the node
+	bool waiting;         ///< Waiting for the echo of the last command
+	unsigned long sentAt; ///< millis() of the last command
+};
+
+/**
+ * @brief Pushes a configuration to a list of nodes and collects the echoes
+ *
+ * Driven by poll() from the loop; nothing blocks. The commands go out as
+ * non-blocking fixed transmissions, so the local module must be in fixed
+ * transmission mode, and the frames received meanwhile are consumed.
+ *
+ * @note The radio is half duplex: an echo arriving while the next command
+ *       is on air is lost and the node is retried. A window of 1 sends
+ *       strictly one command at a time.
+ * @note Each node keeps its address and its channel (RemoteConfigTarget::CHAN),
+ *       whatever the configuration holds. The echo is sent with the new
+ *       settings of the node: changing the air data rate of the nodes cannot
+ *       be confirmed this way
+ *
+ * @example Raising the power of a field of nodes:
+ * @code
+ * RemoteConfigTarget nodes[] = { { 0x00, 0x10, 23 }, { 0x00, 0x11, 23 }, { 0x00, 0x12, 23 } };
+ * LoRa_E220_RemoteConfig rollout(e220ttl, nodes, 3);
+ *
+ * configuration.OPTION.transmissionPower = POWER_22;
+ * rollout.begin(configuration, WRITE_CFG_PWR_DWN_SAVE);
+ * while (rollout.poll()) {}
+ *
+ * for (uint8_t i = 0; i < 3; i++) {
+ *     Serial.println(getResponseDescriptionByParams(nodes[i].status));
+ * }
+ * @endcode
+ */
+class LoRa_E220_RemoteConfig {
+	public:
+		/**
+		 * @param e220 Initialized device, in fixed transmission mode
+		 * @param targets Nodes to configure, kept by the caller
+		 * @param count Number of targets
+		 * @param window Commands waiting for their echo at the same time
+		 * @param timeout Milliseconds to wait for an echo
+		 * @param maxAttempts Commands sent to a node before giving up
+		 */
+		LoRa_E220_RemoteConfig(LoRa_E220 &e220, RemoteConfigTarget *targets, uint16_t count,
+				uint8_t window = 4, unsigned long timeout = 3000, uint8_t maxAttempts = 3);
+
+		/**
+		 * @brief Start pushing a configuration to every target
+		 * @param configuration Registers to write, ADDH, ADDL and CHAN are those of each target
+		 * @param saveType WRITE_CFG_PWR_DWN_SAVE or WRITE_CFG_PWR_DWN_LOSE
+		 */
+		void begin(const Configuration &configuration, PROGRAM_COMMAND saveType = WRITE_CFG_PWR_DWN_SAVE);
+
+		/**
+		 * @brief Advance the rollout: collect echoes, expire and send commands
+		 * @return true while some target is still in progress
+		 */
+		bool poll();
+
+		/** Every target has a final status (true before begin()) */
+		bool isDone() { return !this->running; }
+		/** Targets configured and confirmed */
+		uint16_t getSucceeded() { return this->succeeded; }
+		/** Targets given up */
+		uint16_t getFailed() { return this->failed; }
+		/** Commands sent, retries included */
+		unsigned long getCommandsSent() { return this->commandsSent; }
+
+	private:
+		LoRa_E220 *e220;
+		RemoteConfigTarget *targets;
+		uint16_t count;
+		uint8_t window;
+		unsigned long timeout;
+		uint8_t maxAttempts;
+
+		uint8_t command[E220_REMOTE_CONFIG_COMMAND_SIZE];
+		uint8_t frame[MAX_SIZE_TX_PACKET + 1];
+
+		bool running = false;
+		RemoteConfigTarget *sending = NULL; ///< Target of the send in progress
+		uint16_t next = 0;                  ///< Round robin position of the next command
+		uint8_t waiting = 0;                ///< Targets waiting for an echo
+		uint16_t succeeded = 0;
+		uint16_t failed = 0;
+		unsigned long commandsSent = 0;
+
+		void receive();
+		void expire();
+		void sendNext();
+		void finish(RemoteConfigTarget &target, Status status);
+};
+
+#endif
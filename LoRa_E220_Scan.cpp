@@ -0,0 +1,136 @@
+/**
+ * @file LoRa_E220_Scan.cpp
+ * @brief Implementation of the channel noise scanner
+ *
+ * @author Alteriom
+ *
+ * @note The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Alteriom - Enhancements and CI/CD improvements
+ */
+
+#include "LoRa_E220_Scan.h"
+
+LoRa_E220_ChannelScanner::LoRa_E220_ChannelScanner(LoRa_E220 &e220){
+	this->e220 = &e220;
+}
+
+ResponseStatus LoRa_E220_ChannelScanner::measure(byte firstChannel, byte lastChannel, ChannelScanResult *results, uint8_t samples, int16_t &original){
+	ResponseStatus rc;
+	Configuration configuration;
+	original = -1;
+	rc = this->e220->getCachedConfiguration(configuration);
+	if (rc.code!=E220_SUCCESS) return rc;
+	original = configuration.CHAN;
+
+	/* the noise registers answer only with ambient noise enabled; OPTION only,
+	   a key read back as 0 must not replace the running one */
+	bool enableNoise = configuration.OPTION.RSSIAmbientNoise != RSSI_AMBIENT_NOISE_ENABLED;
+	if (enableNoise) {
+		configuration.OPTION.RSSIAmbientNoise = RSSI_AMBIENT_NOISE_ENABLED;
+		rc = this->e220->updateConfiguration(configuration, WRITE_CFG_PWR_DWN_LOSE, false);
+		if (rc.code!=E220_SUCCESS) return rc;
+	}
+
+	unsigned long start = micros();
+	for (uint16_t channel = firstChannel; channel <= lastChannel; channel++) {
+		ChannelScanResult &result = results[channel - firstChannel];
+		result.CHAN = channel;
+		result.meanRSSI = 0;
+		result.maxRSSI = 0;
+		result.samples = 0;
+
+		rc = this->e220->setChannel(channel, true);
+		if (rc.code!=E220_SUCCESS) break;
+
+		uint16_t sum = 0;
+		for (uint8_t sample = 0; sample < samples; sample++) {
+			byte rssi;
+			for (uint8_t attempt = 0; attempt < E220_SCAN_SAMPLE_ATTEMPTS; attempt++) {
+				if (this->e220->readAmbientRSSI(rssi).code != E220_SUCCESS) continue;
+				sum += rssi;
+				if (rssi > result.maxRSSI) result.maxRSSI = rssi;
+				result.samples++;
+				break;
+			}
+		}
+		if (result.samples > 0) result.meanRSSI = (sum + result.samples / 2) / result.samples;
+
+		DEBUG_PRINT(F("Scan channel "));
+		DEBUG_PRINT(channel);
+		DEBUG_PRINT(F(": "));
+		DEBUG_PRINTLN(getRSSIdBm(result.meanRSSI));
+	}
+	this->scanMicros = micros() - start;
+
+	if (enableNoise) {
+		ResponseStatus restore = this->e220->getCachedConfiguration(configuration);
+		if (restore.code==E220_SUCCESS) {
+			configuration.OPTION.RSSIAmbientNoise = RSSI_AMBIENT_NOISE_DISABLED;
+			restore = this->e220->updateConfiguration(configuration, WRITE_CFG_PWR_DWN_LOSE, false);
+		}
+		if (rc.code==E220_SUCCESS) rc = restore;
+	}
+	return rc;
+}
+
+ResponseStatus LoRa_E220_ChannelScanner::scan(byte firstChannel, byte lastChannel, ChannelScanResult *results, uint8_t samples){
+	ResponseStatus rc;
+	if (lastChannel < firstChannel || samples == 0) {
+		rc.code = ERR_E220_INVALID_PARAM;
+		return rc;
+	}
+
+	int16_t original;
+	rc = this->measure(firstChannel, lastChannel, results, samples, original);
+	if (rc.code==E220_SUCCESS) rank(results, lastChannel - firstChannel + 1);
+
+	/* nothing to restore when the configuration could not be read */
+	if (original < 0) return rc;
+	ResponseStatus restore = this->e220->setChannel(original, true);
+	if (rc.code==E220_SUCCESS) rc = restore;
+	return rc;
+}
+
+ResponseStatus LoRa_E220_ChannelScanner::scanAndSelect(byte firstChannel, byte lastChannel, ChannelScanResult *results,
+		uint8_t samples, PROGRAM_COMMAND saveType){
+	ResponseStatus rc;
+	if (lastChannel < firstChannel || samples == 0) {
+		rc.code = ERR_E220_INVALID_PARAM;
+		return rc;
+	}
+
+	int16_t original;
+	rc = this->measure(firstChannel, lastChannel, results, samples, original);
+	if (rc.code==E220_SUCCESS) {
+		rank(results, lastChannel - firstChannel + 1);
+		if (results[0].samples == 0) rc.code = ERR_E220_NO_RESPONSE_FROM_DEVICE;
+	}
+	if (original < 0) return rc;
+
+	/* on failure, back to the channel of before, temporarily */
+	bool selected = (rc.code==E220_SUCCESS);
+	ResponseStatus select = this->e220->setChannel(selected ? results[0].CHAN : original,
+			!selected || saveType != WRITE_CFG_PWR_DWN_SAVE);
+	if (rc.code==E220_SUCCESS) rc = select;
+	return rc;
+}
+
+void LoRa_E220_ChannelScanner::rank(ChannelScanResult *results, uint16_t count){
+	// insertion sort: quietest mean, then quietest peak; channels without samples last
+	for (uint16_t i = 1; i < count; i++) {
+		ChannelScanResult result = results[i];
+		uint16_t j = i;
+		while (j > 0) {
+			const ChannelScanResult &previous = results[j - 1];
+			bool louder = (previous.samples == 0 && result.samples > 0)
+					|| (previous.samples > 0 && result.samples > 0
+						&& (previous.meanRSSI > result.meanRSSI
+							|| (previous.meanRSSI == result.meanRSSI && previous.maxRSSI > result.maxRSSI)));
+			if (!louder) break;
+			results[j] = results[j - 1];
+			j--;
+		}
+		results[j] = result;
+	}
+}
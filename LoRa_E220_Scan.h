@@ -0,0 +1,90 @@
+/**
+ * @file LoRa_E220_Scan.h
+ * @brief Ambient noise scan of a channel range to pick the quietest channel
+ *
+ * The noise registers are read in normal mode and the channel is written in
+ * program mode, so each channel costs one setChannel() (a temporary one
+ * register write, with the AUX-timed mode switches) and the RSSI reads,
+ * instead of a full configuration read and write.
+ *
+ * @author Alteriom
+ *
+ * @note The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Alteriom - Enhancements and CI/CD improvements
+ */
+#ifndef LoRa_E220_Scan_h
+#define LoRa_E220_Scan_h
+
+#include "LoRa_E220.h"
+
+/**
+ * @brief Attempts for one noise sample while the module is busy
+ */
+#ifndef E220_SCAN_SAMPLE_ATTEMPTS
+	#define E220_SCAN_SAMPLE_ATTEMPTS 3
+#endif
+
+/**
+ * @brief Noise measured on one channel
+ */
+struct ChannelScanResult {
+	byte CHAN;
+	byte meanRSSI;   ///< Mean of the ambient RSSI bytes, dBm = getRSSIdBm(meanRSSI)
+	byte maxRSSI;    ///< Loudest sample
+	uint8_t samples; ///< Samples read (0: no answer, ranked last)
+};
+
+/**
+ * @brief Scans a channel range and ranks the channels, quietest first
+ *
+ * RSSI ambient noise is enabled for the scan if needed, with a temporary
+ * write, and restored afterwards, like the channel.
+ *
+ * @example Moving to the quietest channel of the band:
+ * @code
+ * LoRa_E220_ChannelScanner scanner(e220ttl);
+ * ChannelScanResult results[84];
+ * if (scanner.scanAndSelect(0, 83, results, 4, WRITE_CFG_PWR_DWN_SAVE).code == E220_SUCCESS) {
+ *     Serial.print(F("Channel "));
+ *     Serial.println(results[0].CHAN);
+ * }
+ * @endcode
+ */
+class LoRa_E220_ChannelScanner {
+	public:
+		/**
+		 * @param e220 Initialized device, in normal mode
+		 */
+		LoRa_E220_ChannelScanner(LoRa_E220 &e220);
+
+		/**
+		 * @brief Measure the channels and go back to the current one
+		 * @param firstChannel First channel of the range
+		 * @param lastChannel Last channel of the range
+		 * @param results lastChannel - firstChannel + 1 entries, sorted on return
+		 * @param samples Noise samples per channel
+		 * @return ResponseStatus of the first failed channel write, or E220_SUCCESS
+		 */
+		ResponseStatus scan(byte firstChannel, byte lastChannel, ChannelScanResult *results, uint8_t samples = 4);
+
+		/**
+		 * @brief Scan, then stay on the quietest channel
+		 * @param saveType WRITE_CFG_PWR_DWN_SAVE to keep the channel over a power cycle
+		 * @return ResponseStatus of the scan or of the channel write
+		 */
+		ResponseStatus scanAndSelect(byte firstChannel, byte lastChannel, ChannelScanResult *results,
+				uint8_t samples = 4, PROGRAM_COMMAND saveType = WRITE_CFG_PWR_DWN_LOSE);
+
+		/** Duration of the last scan, in microseconds */
+		unsigned long getScanMicros() { return this->scanMicros; }
+
+	private:
+		LoRa_E220 *e220;
+		unsigned long scanMicros = 0;
+
+		ResponseStatus measure(byte firstChannel, byte lastChannel, ChannelScanResult *results, uint8_t samples, int16_t &original);
+		static void rank(ChannelScanResult *results, uint16_t count);
+};
+
+#endif
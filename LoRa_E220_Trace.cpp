@@ -0,0 +1,89 @@
+/**
+ * @file LoRa_E220_Trace.cpp
+ * @brief Implementation of the binary event trace
+ *
+ * @author Alteriom
+ *
+ * @note The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Alteriom - Enhancements and CI/CD improvements
+ */
+#include "LoRa_E220_Trace.h"
+
+#ifdef LoRa_E220_TRACE
+
+static_assert((E220_TRACE_SIZE & (E220_TRACE_SIZE - 1)) == 0, "E220_TRACE_SIZE must be a power of 2");
+
+TraceEvent LoRa_E220_Trace::events[E220_TRACE_SIZE];
+volatile uint32_t LoRa_E220_Trace::recorded = 0;
+volatile bool LoRa_E220_Trace::enabled = true;
+
+uint32_t LoRa_E220_Trace::getRecorded() {
+	/* 4 bytes, not read atomically on 8 bit targets */
+	uint8_t state = lock();
+	uint32_t count = recorded;
+	unlock(state);
+	return count;
+}
+
+uint32_t LoRa_E220_Trace::getOverwritten() {
+	uint32_t count = getRecorded();
+	return count > E220_TRACE_SIZE ? count - E220_TRACE_SIZE : 0;
+}
+
+void LoRa_E220_Trace::clear() {
+	uint8_t state = lock();
+	recorded = 0;
+	unlock(state);
+}
+
+uint16_t LoRa_E220_Trace::read(TraceEvent *copy, uint16_t count) {
+	uint32_t end = getRecorded();
+	uint32_t kept = end > E220_TRACE_SIZE ? E220_TRACE_SIZE : end;
+	if (kept > count) kept = count;
+
+	/* one event at a time: the interrupts stay enabled between them */
+	for (uint16_t i = 0; i < kept; i++) {
+		uint8_t state = lock();
+		copy[i] = events[(end - kept + i) & (E220_TRACE_SIZE - 1)];
+		unlock(state);
+	}
+	return kept;
+}
+
+static size_t writeLittleEndian(Print &out, uint32_t value, uint8_t bytes) {
+	uint8_t buffer[4];
+	for (uint8_t i = 0; i < bytes; i++) {
+		buffer[i] = value & 0xFF;
+		value >>= 8;
+	}
+	return out.write(buffer, bytes);
+}
+
+size_t LoRa_E220_Trace::dump(Print &out) {
+	/* the slots are read in place: nothing may overwrite them meanwhile */
+	bool wasEnabled = enabled;
+	enabled = false;
+
+	uint32_t end = getRecorded();
+	uint16_t kept = end > E220_TRACE_SIZE ? E220_TRACE_SIZE : end;
+
+	size_t written = out.write((const uint8_t *)"E2TR", 4);
+	written += writeLittleEndian(out, E220_TRACE_FORMAT_VERSION, 1);
+	written += writeLittleEndian(out, 8, 1);
+	written += writeLittleEndian(out, kept, 2);
+	written += writeLittleEndian(out, end, 4);
+
+	for (uint16_t i = 0; i < kept; i++) {
+		const TraceEvent &event = events[(end - kept + i) & (E220_TRACE_SIZE - 1)];
+		written += writeLittleEndian(out, event.time, 4);
+		written += writeLittleEndian(out, event.event, 1);
+		written += writeLittleEndian(out, event.arg1, 1);
+		written += writeLittleEndian(out, event.arg2, 2);
+	}
+
+	enabled = wasEnabled;
+	return written;
+}
+
+#endif
@@ -0,0 +1,189 @@
+/**
+ * @file LoRa_E220_Trace.h
+ * @brief Binary event trace in a fixed RAM ring buffer
+ *
+ * LoRa_E220_DEBUG prints through Serial and changes the timing being
+ * debugged: a configuration read alone prints about 20 lines. With
+ * LoRa_E220_TRACE defined (build flag, so the library sources see it too),
+ * the library records instead an 8 byte event at its hot paths: a micros()
+ * timestamp, an event ID and two arguments, in a ring buffer that keeps the
+ * last E220_TRACE_SIZE events. Recording costs a few instructions with the
+ * interrupts disabled; dump() later writes the ring in binary and
+ * scripts/decode_trace.py turns it into a readable timeline on the host.
+ *
+ * Without LoRa_E220_TRACE the E220_TRACE() macros compile to nothing and no
+ * RAM is reserved.
+ *
+ * @author Alteriom
+ *
+ * @note The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Alteriom - Enhancements and CI/CD improvements
+ */
+#ifndef LoRa_E220_Trace_h
+#define LoRa_E220_Trace_h
+
+#if ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+//#define LoRa_E220_TRACE
+
+/**
+ * @brief Events kept by the ring, a power of 2 (8 bytes each)
+ */
+#ifndef E220_TRACE_SIZE
+	#define E220_TRACE_SIZE 64
+#endif
+
+/**
+ * @brief Version of the dump() format, checked by the decoder
+ */
+#define E220_TRACE_FORMAT_VERSION 1
+
+/**
+ * @brief Events recorded by the library, with the meaning of their arguments
+ *
+ * scripts/decode_trace.py reads the names from this enum: keep one
+ * "TRACE_NAME = value," per line.
+ */
+enum TRACE_EVENT {
+	TRACE_MODE_SWITCH 		= 1,  ///< arg1 mode, arg2 AUX transition in us (0 without AUX, saturated)
+	TRACE_AUX_EDGE 			= 2,  ///< arg1 AUX level, from the AUX interrupt
+	TRACE_AUX_WAIT 			= 3,  ///< arg1 Status, arg2 ms until AUX HIGH (waitCompleteResponse)
+	TRACE_UART_WRITE 		= 4,  ///< arg1 Status, arg2 bytes written
+	TRACE_UART_READ 		= 5,  ///< arg1 Status, arg2 bytes read (receiveStruct)
+	TRACE_PROGRAM_COMMAND 	= 6,  ///< arg1 command, arg2 address << 8 | length
+	TRACE_CONFIGURATION 	= 7,  ///< arg1 Status, arg2 CHAN << 8 | SPED, of a configuration read or write
+	TRACE_REGISTER_WRITE 	= 8,  ///< arg1 command (C0/C2), arg2 address << 8 | length, registers written by updateConfiguration() or setChannel()
+	TRACE_SEND_BEGIN 		= 9,  ///< arg1 Status, arg2 bytes, non-blocking send written
+	TRACE_SEND_END 			= 10, ///< arg1 Status, arg2 ms since the write, non-blocking send finished
+	TRACE_FRAME 			= 11, ///< arg1 Status, arg2 bytes, frame closed by the framer
+	TRACE_RSSI 				= 12, ///< arg1 ambient RSSI, arg2 last packet RSSI (RSSI register read)
+	TRACE_USER 				= 128 ///< First ID free for the application
+};
+
+/**
+ * @brief One recorded event
+ */
+struct TraceEvent {
+	uint32_t time;  ///< micros() when recorded
+	uint8_t event;  ///< TRACE_EVENT or an application ID from TRACE_USER
+	uint8_t arg1;
+	uint16_t arg2;
+};
+
+#ifdef LoRa_E220_TRACE
+
+/**
+ * @brief The trace ring, shared by every LoRa_E220 instance and the application
+ *
+ * @example Capturing the events of a configuration read:
+ * @code
+ * LoRa_E220_Trace::clear();
+ * e220ttl.getConfiguration(configuration);
+ * LoRa_E220_Trace::dump(Serial);
+ * @endcode
+ * Then on the host, with the serial output saved to capture.bin:
+ * @code
+ * python3 scripts/decode_trace.py capture.bin
+ * @endcode
+ */
+class LoRa_E220_Trace {
+	public:
+		/** @brief Record an event, from the loop */
+		static inline void record(uint8_t event, uint8_t arg1 = 0, uint16_t arg2 = 0) {
+			if (!enabled) return;
+			uint32_t time = micros();
+			uint8_t state = lock();
+			store(time, event, arg1, arg2);
+			unlock(state);
+		}
+
+		/**
+		 * @brief Record an event from an interrupt handler
+		 * @note A single interrupt may record: it is not locked against another one
+		 */
+		static inline void recordFromISR(uint8_t event, uint8_t arg1 = 0, uint16_t arg2 = 0) {
+			if (!enabled) return;
+			store(micros(), event, arg1, arg2);
+		}
+
+		/**
+		 * @brief Copy the events kept, oldest first
+		 * @param events Filled with up to count events, the most recent ones
+		 * @param count Size of events
+		 * @return Number of events copied
+		 */
+		static uint16_t read(TraceEvent *events, uint16_t count);
+
+		/**
+		 * @brief Write the events kept to a stream, in binary
+		 *
+		 * Header "E2TR", format version, event size, event count (2 bytes)
+		 * and events recorded since clear() (4 bytes), then the events oldest
+		 * first; every field little endian. Recording is paused meanwhile.
+		 * @return Bytes written
+		 */
+		static size_t dump(Print &out);
+
+		/** @brief Forget the events */
+		static void clear();
+		/** @brief Pause (false) or resume (true) the recording */
+		static void setEnabled(bool enable) { enabled = enable; }
+		static bool isEnabled() { return enabled; }
+
+		/** Events recorded since clear(), kept or overwritten */
+		static uint32_t getRecorded();
+		/** Events overwritten by newer ones */
+		static uint32_t getOverwritten();
+
+	private:
+		static TraceEvent events[E220_TRACE_SIZE];
+		static volatile uint32_t recorded;
+		static volatile bool enabled;
+
+		/*
+		 * Short critical sections: AVR restores the interrupt flag it found,
+		 * elsewhere the interrupts are enabled again on unlock, so record(),
+		 * read(), clear() and getRecorded() are not for interrupt handlers.
+		 */
+		static inline uint8_t lock() {
+#if defined(__AVR__)
+			uint8_t sreg = SREG;
+			cli();
+			return sreg;
+#else
+			noInterrupts();
+			return 0;
+#endif
+		}
+		static inline void unlock(uint8_t state) {
+#if defined(__AVR__)
+			SREG = state;
+#else
+			(void)state;
+			interrupts();
+#endif
+		}
+
+		static inline void store(uint32_t time, uint8_t event, uint8_t arg1, uint16_t arg2) {
+			TraceEvent &slot = events[recorded & (E220_TRACE_SIZE - 1)];
+			slot.time = time;
+			slot.event = event;
+			slot.arg1 = arg1;
+			slot.arg2 = arg2;
+			recorded = recorded + 1;
+		}
+};
+
+	#define E220_TRACE(event, arg1, arg2) { LoRa_E220_Trace::record(event, arg1, arg2); }
+	#define E220_TRACE_ISR(event, arg1, arg2) { LoRa_E220_Trace::recordFromISR(event, arg1, arg2); }
+#else
+	#define E220_TRACE(event, arg1, arg2) {}
+	#define E220_TRACE_ISR(event, arg1, arg2) {}
+#endif
+
+#endif
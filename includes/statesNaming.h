@@ -134,7 +134,8 @@ typedef enum RESPONSE_STATUS {
   ERR_E220_NO_RESPONSE_FROM_DEVICE,      ///< No response from device - check wiring
   ERR_E220_WRONG_UART_CONFIG,            ///< UART configuration error - use 9600bps for config
   ERR_E220_WRONG_FORMAT,                 ///< Invalid command or data format
-  ERR_E220_PACKET_TOO_BIG                ///< Packet exceeds 200-byte limit
+  ERR_E220_PACKET_TOO_BIG,               ///< Packet exceeds 200-byte limit
+  ERR_E220_BUSY                          ///< Previous non-blocking operation still in progress
 } Status;
 
 /**
@@ -205,6 +206,9 @@ static String getResponseDescriptionByParams(byte status){
 	  case ERR_E220_PACKET_TOO_BIG:
 		return F("The device support only 200byte of data transmission!"); // Packet size error
 		break;
+	  case ERR_E220_BUSY:
+		return F("Busy! (Previous operation still in progress)");      // Non-blocking operation pending
+		break;
 	  default:
 		return F("Invalid status!");                                    // Unknown status code
 	}
@@ -286,7 +290,7 @@ static String getUARTParityDescriptionByParams(byte uartParity){
  * 
  * @note These are the binary values stored in configuration
  * @note Default is UART_BPS_9600 (0b011)
- * @warning Configuration mode requires 9600 bps regardless of this setting
+ * @note Configuration mode always runs at 9600 bps, the library switches the host UART
  * 
  * @see UART_BPS_RATE for actual baud rate values
  */
@@ -314,7 +318,7 @@ enum UART_BPS_TYPE
  * - Default: 9600 bps (reliable for most applications)
  * - Higher rates: Better for high-throughput applications
  * 
- * @note Configuration mode always uses 9600 bps regardless of this setting
+ * @note Configuration mode always uses 9600 bps, the library switches the host UART to it
  * @note Higher baud rates may be less reliable with Software Serial
  * @warning Ensure both device and controller support the selected rate
  * 
@@ -335,6 +339,36 @@ enum UART_BPS_RATE
   UART_BPS_RATE_115200 = 115200   ///< 115200 bits per second
 };
 
+/**
+ * @brief Baud rate of a register value, usable in constant expressions
+ */
+static constexpr UART_BPS_RATE getUARTBaudRate(UART_BPS_TYPE uartBaudRate)
+{
+	return uartBaudRate == UART_BPS_1200 ? UART_BPS_RATE_1200
+		: uartBaudRate == UART_BPS_2400 ? UART_BPS_RATE_2400
+		: uartBaudRate == UART_BPS_4800 ? UART_BPS_RATE_4800
+		: uartBaudRate == UART_BPS_19200 ? UART_BPS_RATE_19200
+		: uartBaudRate == UART_BPS_38400 ? UART_BPS_RATE_38400
+		: uartBaudRate == UART_BPS_57600 ? UART_BPS_RATE_57600
+		: uartBaudRate == UART_BPS_115200 ? UART_BPS_RATE_115200
+		: UART_BPS_RATE_9600;
+}
+
+/**
+ * @brief Register value of a baud rate, usable in constant expressions
+ */
+static constexpr UART_BPS_TYPE getUARTBaudType(UART_BPS_RATE bpsRate)
+{
+	return bpsRate == UART_BPS_RATE_1200 ? UART_BPS_1200
+		: bpsRate == UART_BPS_RATE_2400 ? UART_BPS_2400
+		: bpsRate == UART_BPS_RATE_4800 ? UART_BPS_4800
+		: bpsRate == UART_BPS_RATE_19200 ? UART_BPS_19200
+		: bpsRate == UART_BPS_RATE_38400 ? UART_BPS_38400
+		: bpsRate == UART_BPS_RATE_57600 ? UART_BPS_57600
+		: bpsRate == UART_BPS_RATE_115200 ? UART_BPS_115200
+		: UART_BPS_9600;
+}
+
 /**
  * @brief Get human-readable UART baud rate description
  * @param uartBaudRate Baud rate type value (0-7)
@@ -439,6 +473,16 @@ enum SUB_PACKET_SETTING {
 	SPS_032_11 = 0b11
 
 };
+/**
+ * @brief Payload bytes of a sub packet setting, usable in constant expressions
+ */
+static constexpr uint8_t getSubPacketSizeBytes(SUB_PACKET_SETTING subPacketSetting)
+{
+	return subPacketSetting == SPS_200_00 ? 200
+		: subPacketSetting == SPS_128_01 ? 128
+		: subPacketSetting == SPS_064_10 ? 64
+		: 32;
+}
 static String getSubPacketSettingByParams(byte subPacketSetting)
 {
 	switch (subPacketSetting)
@@ -479,6 +523,14 @@ static String getRSSIAmbientNoiseEnableByParams(byte rssiAmbientNoiseEnabled)
 	}
 }
 
+/**
+ * @brief Signal strength in dBm of an RSSI byte, -(256 - RSSI) per the data sheet
+ */
+static constexpr int16_t getRSSIdBm(byte rssi)
+{
+	return -(256 - (int16_t)rssi);
+}
+
 enum WOR_PERIOD {
 	WOR_500_000 = 0b000,
 	WOR_1000_001 = 0b001,
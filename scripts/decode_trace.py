@@ -0,0 +1,129 @@
+#!/usr/bin/env python3
+"""Decode the binary event trace written by LoRa_E220_Trace::dump().
+
+Usage: python3 scripts/decode_trace.py <capture> [--header LoRa_E220_Trace.h]
+
+The capture is the raw serial output (a file, or - for stdin); text printed
+before or between dumps is skipped. Event names come from the TRACE_EVENT
+enum of LoRa_E220_Trace.h and status names from includes/statesNaming.h, so
+the decoder follows the library it sits in.
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+MAGIC = b"E2TR"
+FORMAT_VERSION = 1
+HEADER = struct.Struct("<4sBBHI")
+EVENT = struct.Struct("<IBBH")
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), os.pardir)
+
+MODES = {0: "NORMAL", 1: "WOR_TRANSMITTER", 2: "WOR_RECEIVER", 3: "PROGRAM"}
+COMMANDS = {0xC0: "WRITE_SAVE", 0xC1: "READ", 0xC2: "WRITE_LOSE"}
+
+
+def read_event_names(path):
+    names = {}
+    with open(path) as header:
+        for match in re.finditer(r"^\s*TRACE_(\w+)\s*=\s*(\d+)", header.read(), re.MULTILINE):
+            names[int(match.group(2))] = match.group(1)
+    return names
+
+
+def read_status_names(path):
+    """The RESPONSE_STATUS enum, numbered from E220_SUCCESS = 1."""
+    names = {}
+    value = None
+    with open(path) as header:
+        text = header.read()
+    body = text[text.index("enum RESPONSE_STATUS"):]
+    body = body[body.index("{") + 1:body.index("}")]
+    for line in body.splitlines():
+        match = re.match(r"\s*(E220_\w+|ERR_E220_\w+)\s*(?:=\s*(\d+))?", line)
+        if not match:
+            continue
+        value = int(match.group(2)) if match.group(2) else value + 1
+        names[value] = match.group(1)
+    return names
+
+
+def describe(name, arg1, arg2, statuses):
+    status = statuses.get(arg1, str(arg1))
+    if name == "MODE_SWITCH":
+        return "mode %s, AUX %s us" % (MODES.get(arg1, arg1), arg2 if arg2 < 0xFFFF else ">65535")
+    if name == "AUX_EDGE":
+        return "AUX %s" % ("HIGH" if arg1 else "LOW")
+    if name == "AUX_WAIT":
+        return "%s after %d ms" % (status, arg2)
+    if name in ("UART_WRITE", "UART_READ", "SEND_BEGIN", "FRAME"):
+        return "%s, %d bytes" % (status, arg2)
+    if name in ("PROGRAM_COMMAND", "REGISTER_WRITE"):
+        return "%s, address %d, length %d" % (COMMANDS.get(arg1, "0x%02X" % arg1), arg2 >> 8, arg2 & 0xFF)
+    if name == "CONFIGURATION":
+        return "%s, CHAN %d, SPED 0x%02X" % (status, arg2 >> 8, arg2 & 0xFF)
+    if name == "SEND_END":
+        return "%s after %d ms" % (status, arg2)
+    if name == "RSSI":
+        return "ambient %d dBm, last packet %d dBm" % (arg1 - 256, arg2 - 256)
+    return "arg1 %d, arg2 %d" % (arg1, arg2)
+
+
+def decode(data, names, statuses, out):
+    dumps = 0
+    position = data.find(MAGIC)
+    while position >= 0 and position + HEADER.size <= len(data):
+        magic, version, size, count, recorded = HEADER.unpack_from(data, position)
+        position += HEADER.size
+        if version != FORMAT_VERSION or size != EVENT.size:
+            out.write("dump %d: unsupported format %d (event size %d), skipped\n" % (dumps + 1, version, size))
+            position = data.find(MAGIC, position)
+            continue
+        if position + count * size > len(data):
+            out.write("dump %d: truncated, %d of %d events\n" % (dumps + 1, (len(data) - position) // size, count))
+            count = (len(data) - position) // size
+
+        dumps += 1
+        out.write("dump %d: %d events, %d recorded, %d overwritten\n" % (dumps, count, recorded, recorded - count))
+        first = previous = None
+        for index in range(count):
+            time, event, arg1, arg2 = EVENT.unpack_from(data, position)
+            position += size
+            if first is None:
+                first = previous = time
+            # micros() wraps after about 71 minutes
+            elapsed = (time - first) & 0xFFFFFFFF
+            delta = (time - previous) & 0xFFFFFFFF
+            previous = time
+            name = names.get(event, "USER+%d" % (event - 128) if event >= 128 else "EVENT_%d" % event)
+            out.write("%4d %12d us %+10d us  %-16s %s\n" % (index, elapsed, delta, name, describe(name, arg1, arg2, statuses)))
+        position = data.find(MAGIC, position)
+    return dumps
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode a LoRa_E220_Trace::dump() capture")
+    parser.add_argument("capture", help="raw capture file, - for stdin")
+    parser.add_argument("--header", default=os.path.join(ROOT, "LoRa_E220_Trace.h"), help="LoRa_E220_Trace.h for the event names")
+    parser.add_argument("--states", default=os.path.join(ROOT, "includes", "statesNaming.h"), help="statesNaming.h for the status names")
+    args = parser.parse_args()
+
+    if args.capture == "-":
+        data = sys.stdin.buffer.read()
+    else:
+        with open(args.capture, "rb") as capture:
+            data = capture.read()
+
+    names = read_event_names(args.header)
+    statuses = read_status_names(args.states)
+    if decode(data, names, statuses, sys.stdout) == 0:
+        sys.stderr.write("no trace dump found\n")
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,399 @@
+/**
+ * @file Arduino.h
+ * @brief Minimal Arduino core for the PlatformIO native test environment
+ *
+ * Lets the real LoRa_E220 class compile and run on the host. It provides:
+ * - A virtual clock: every millis()/micros() read advances time by one tick,
+ *   so the library's busy-wait loops terminate deterministically
+ * - Digital pins with edge interrupts
+ * - An in-memory Stream/HardwareSerial whose bytes are timestamped, so a
+ *   peripheral can deliver data at the real UART rate
+ *
+ * Peripherals (for example a simulated E220 module) derive from
+ * NativePeripheral and register with nativeHost() to receive pin writes,
+ * serial writes and clock updates.
+ *
+ * @note Only used by `pio test -e native`, never by Arduino builds
+ */
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <deque>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define SERIAL_8N1 0x06
+
+#define PROGMEM
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define digitalPinToInterrupt(p) (p)
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+
+//=============================================================================
+// STRING
+//=============================================================================
+
+class String {
+	public:
+		String() {}
+		String(const char *cstr) : buffer(cstr ? cstr : "") {}
+		String(const __FlashStringHelper *fstr) : buffer(reinterpret_cast<const char *>(fstr)) {}
+		String(const std::string &str) : buffer(str) {}
+		explicit String(char c) : buffer(1, c) {}
+		String(int value, unsigned char base = 10) { fromNumber((long)value, base); }
+		String(unsigned int value, unsigned char base = 10) { fromNumber((unsigned long)value, base); }
+		String(long value, unsigned char base = 10) { fromNumber(value, base); }
+		String(unsigned long value, unsigned char base = 10) { fromNumber(value, base); }
+
+		unsigned int length() const { return buffer.length(); }
+		bool isEmpty() const { return buffer.empty(); }
+		const char *c_str() const { return buffer.c_str(); }
+		char charAt(unsigned int index) const { return index < buffer.length() ? buffer[index] : 0; }
+		char operator[](unsigned int index) const { return charAt(index); }
+		String substring(unsigned int from) const { return substring(from, length()); }
+		String substring(unsigned int from, unsigned int to) const {
+			if (from > to) { unsigned int t = from; from = to; to = t; }
+			if (from >= length()) return String();
+			if (to > length()) to = length();
+			return String(buffer.substr(from, to - from));
+		}
+		bool startsWith(const String &prefix) const { return buffer.compare(0, prefix.buffer.length(), prefix.buffer) == 0; }
+		bool endsWith(const String &suffix) const {
+			return suffix.length() <= length() && buffer.compare(length() - suffix.length(), suffix.length(), suffix.buffer) == 0;
+		}
+		bool reserve(unsigned int size) { buffer.reserve(size); return true; }
+		bool concat(const String &str) { buffer += str.buffer; return true; }
+		bool concat(char c) { buffer += c; return true; }
+		String &operator+=(const String &str) { buffer += str.buffer; return *this; }
+		String &operator+=(char c) { buffer += c; return *this; }
+		bool operator==(const String &rhs) const { return buffer == rhs.buffer; }
+		bool operator!=(const String &rhs) const { return buffer != rhs.buffer; }
+		long toInt() const { return strtol(buffer.c_str(), NULL, 10); }
+
+		friend String operator+(const String &lhs, const String &rhs) { return String(lhs.buffer + rhs.buffer); }
+
+	private:
+		std::string buffer;
+
+		void fromNumber(long value, unsigned char base) {
+			if (value < 0 && base == 10) { buffer = "-"; fromNumber((unsigned long)-value, base, true); }
+			else fromNumber((unsigned long)value, base, false);
+		}
+		void fromNumber(unsigned long value, unsigned char base, bool append = false) {
+			char tmp[8 * sizeof(unsigned long) + 1];
+			char *p = &tmp[sizeof(tmp) - 1];
+			*p = '\0';
+			do { unsigned long d = value % base; *--p = (char)(d < 10 ? '0' + d : 'A' + d - 10); value /= base; } while (value);
+			if (append) buffer += p; else buffer = p;
+		}
+};
+
+//=============================================================================
+// HOST STATE: CLOCK, PINS AND PERIPHERALS
+//=============================================================================
+
+/**
+ * @brief Base class of every simulated device attached to the host
+ */
+class NativePeripheral {
+	public:
+		virtual ~NativePeripheral() {}
+		/** Called after each clock change with the current time */
+		virtual void update(unsigned long long nowMicros) { (void)nowMicros; }
+		/** Next time at which update() must run, or ~0 if nothing is scheduled */
+		virtual unsigned long long nextEventMicros() { return ~0ULL; }
+		/** Called when the host drives an output pin */
+		virtual void onPinWrite(uint8_t pin, uint8_t level) { (void)pin; (void)level; }
+};
+
+#define NATIVE_PIN_COUNT 64
+
+struct NativeHostState {
+	unsigned long long nowMicros;
+	unsigned long tickMicros;
+	uint8_t pinLevel[NATIVE_PIN_COUNT];
+	uint8_t pinMode[NATIVE_PIN_COUNT];
+	void (*isr[NATIVE_PIN_COUNT])(void);
+	int isrMode[NATIVE_PIN_COUNT];
+	std::vector<NativePeripheral *> peripherals;
+	bool updating;
+
+	void reset() {
+		nowMicros = 0;
+		tickMicros = 1;
+		memset(pinLevel, HIGH, sizeof(pinLevel));
+		memset(pinMode, INPUT, sizeof(pinMode));
+		memset(isr, 0, sizeof(isr));
+		memset(isrMode, 0, sizeof(isrMode));
+		peripherals.clear();
+		updating = false;
+	}
+
+	void updatePeripherals() {
+		if (updating) return;
+		updating = true;
+		for (size_t i = 0; i < peripherals.size(); i++) peripherals[i]->update(nowMicros);
+		updating = false;
+	}
+
+	unsigned long long nextEvent() {
+		unsigned long long next = ~0ULL;
+		for (size_t i = 0; i < peripherals.size(); i++) {
+			unsigned long long e = peripherals[i]->nextEventMicros();
+			if (e < next) next = e;
+		}
+		return next;
+	}
+
+	/** Advance the clock to an absolute time, running every event on the way */
+	void advanceTo(unsigned long long target) {
+		if (updating) { if (target > nowMicros) nowMicros = target; return; }
+		for (;;) {
+			unsigned long long next = nextEvent();
+			if (next > target) break;
+			if (next > nowMicros) nowMicros = next;
+			updatePeripherals();
+			if (nextEvent() <= nowMicros) {
+				// guard against a peripheral that does not consume its event
+				nowMicros++;
+			}
+		}
+		if (target > nowMicros) nowMicros = target;
+		updatePeripherals();
+	}
+
+	void tick() { advanceTo(nowMicros + tickMicros); }
+};
+
+inline NativeHostState &nativeHost() {
+	static NativeHostState state;
+	static bool initialized = false;
+	if (!initialized) { initialized = true; state.reset(); }
+	return state;
+}
+
+/** Reset clock, pins and peripherals between tests */
+inline void nativeHostReset() { nativeHost().reset(); }
+/** Register a simulated device */
+inline void nativeHostAttach(NativePeripheral *peripheral) { nativeHost().peripherals.push_back(peripheral); }
+/** Unregister a simulated device before deleting it */
+inline void nativeHostDetach(NativePeripheral *peripheral) {
+	std::vector<NativePeripheral *> &peripherals = nativeHost().peripherals;
+	for (size_t i = 0; i < peripherals.size(); i++) {
+		if (peripherals[i] == peripheral) { peripherals.erase(peripherals.begin() + i); return; }
+	}
+}
+/** Simulate caller work: let time pass without reading the clock */
+inline void nativeHostAdvance(unsigned long long us) { nativeHost().advanceTo(nativeHost().nowMicros + us); }
+/** Current virtual time without advancing it */
+inline unsigned long long nativeHostNow() { return nativeHost().nowMicros; }
+
+/** Drive an input pin from a peripheral, firing any attached interrupt */
+inline void nativeSetPinLevel(uint8_t pin, uint8_t level) {
+	NativeHostState &h = nativeHost();
+	uint8_t old = h.pinLevel[pin];
+	h.pinLevel[pin] = level ? HIGH : LOW;
+	if (old == h.pinLevel[pin] || !h.isr[pin]) return;
+	int mode = h.isrMode[pin];
+	if (mode == CHANGE || (mode == RISING && level) || (mode == FALLING && !level)) h.isr[pin]();
+}
+
+inline unsigned long micros() { nativeHost().tick(); return (unsigned long)nativeHost().nowMicros; }
+inline unsigned long millis() { nativeHost().tick(); return (unsigned long)(nativeHost().nowMicros / 1000ULL); }
+inline void delayMicroseconds(unsigned int us) { nativeHostAdvance(us); }
+inline void delay(unsigned long ms) { nativeHostAdvance((unsigned long long)ms * 1000ULL); }
+inline void yield() { nativeHost().tick(); }
+
+inline void pinMode(uint8_t pin, uint8_t mode) { nativeHost().pinMode[pin] = mode; }
+inline int digitalRead(uint8_t pin) { return nativeHost().pinLevel[pin]; }
+inline void digitalWrite(uint8_t pin, uint8_t level) {
+	NativeHostState &h = nativeHost();
+	h.pinLevel[pin] = level ? HIGH : LOW;
+	for (size_t i = 0; i < h.peripherals.size(); i++) h.peripherals[i]->onPinWrite(pin, h.pinLevel[pin]);
+}
+inline void attachInterrupt(uint8_t interrupt, void (*isr)(void), int mode) {
+	nativeHost().isr[interrupt] = isr;
+	nativeHost().isrMode[interrupt] = mode;
+}
+inline void detachInterrupt(uint8_t interrupt) { nativeHost().isr[interrupt] = 0; }
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+//=============================================================================
+// PRINT / STREAM / SERIAL
+//=============================================================================
+
+class Print {
+	public:
+		virtual ~Print() {}
+		virtual size_t write(uint8_t c) = 0;
+		virtual size_t write(const uint8_t *buffer, size_t size) {
+			size_t n = 0;
+			while (size--) { if (write(*buffer++)) n++; else break; }
+			return n;
+		}
+		size_t write(const char *buffer, size_t size) { return write((const uint8_t *)buffer, size); }
+
+		// Debug output of the library is not captured on the host
+		template<typename T> size_t print(const T &, int = DEC) { return 0; }
+		template<typename T> size_t println(const T &, int = DEC) { return 0; }
+		size_t println() { return 0; }
+};
+
+class Stream : public Print {
+	public:
+		virtual int available() = 0;
+		virtual int read() = 0;
+		virtual int peek() = 0;
+		virtual void flush() {}
+
+		void setTimeout(unsigned long timeout) { this->timeout = timeout; }
+		unsigned long getTimeout() const { return this->timeout; }
+
+		size_t readBytes(char *buffer, size_t length) {
+			size_t count = 0;
+			while (count < length) {
+				int c = timedRead();
+				if (c < 0) break;
+				*buffer++ = (char)c;
+				count++;
+			}
+			return count;
+		}
+		size_t readBytes(uint8_t *buffer, size_t length) { return readBytes((char *)buffer, length); }
+
+		String readString() {
+			String ret;
+			int c = timedRead();
+			while (c >= 0) { ret += (char)c; c = timedRead(); }
+			return ret;
+		}
+		String readStringUntil(char terminator) {
+			String ret;
+			int c = timedRead();
+			while (c >= 0 && c != terminator) { ret += (char)c; c = timedRead(); }
+			return ret;
+		}
+
+	protected:
+		unsigned long timeout = 1000;
+
+		int timedRead() {
+			unsigned long start = millis();
+			do {
+				int c = read();
+				if (c >= 0) return c;
+			} while (millis() - start < this->timeout);
+			return -1;
+		}
+};
+
+class NativeSerialPort;
+
+/**
+ * @brief Device on the other end of a NativeSerialPort
+ */
+class NativeSerialDevice {
+	public:
+		virtual ~NativeSerialDevice() {}
+		/** Byte written by the host, with the host baud rate at that moment */
+		virtual void onHostByte(uint8_t c, unsigned long baud) = 0;
+};
+
+/**
+ * @brief In-memory UART: bytes delivered by a device become readable at their arrival time
+ */
+class NativeSerialPort : public Stream {
+	public:
+		void begin(unsigned long baud) { this->baud = baud; this->opened = true; this->beginCount++; }
+		void begin(unsigned long baud, uint32_t config) { (void)config; begin(baud); }
+		void end() { this->opened = false; }
+		operator bool() const { return true; }
+
+		void attachDevice(NativeSerialDevice *device) { this->device = device; }
+		unsigned long getBaud() const { return this->baud; }
+		unsigned int getBeginCount() const { return this->beginCount; }
+		size_t getWrittenBytes() const { return this->writtenBytes; }
+		size_t getWriteCalls() const { return this->writeCalls; }
+
+		/** Queue bytes for the host, the first at @p atMicros, then one every @p byteMicros */
+		void deliver(const uint8_t *data, size_t size, unsigned long long atMicros, unsigned long byteMicros) {
+			for (size_t i = 0; i < size; i++) rx.push_back(Pending(atMicros + (unsigned long long)i * byteMicros, data[i]));
+		}
+		unsigned long long lastDeliveryMicros() const { return rx.empty() ? 0 : rx.back().at; }
+
+		int available() {
+			int count = 0;
+			unsigned long long now = nativeHostNow();
+			for (size_t i = 0; i < rx.size() && rx[i].at <= now; i++) count++;
+			return count;
+		}
+		int read() {
+			if (!available()) return -1;
+			uint8_t c = rx.front().value;
+			rx.pop_front();
+			return c;
+		}
+		int peek() { return available() ? rx.front().value : -1; }
+
+		size_t write(uint8_t c) {
+			this->writtenBytes++;
+			this->writeCalls++;
+			if (this->device && this->opened) this->device->onHostByte(c, this->baud);
+			return 1;
+		}
+		size_t write(const uint8_t *buffer, size_t size) {
+			this->writeCalls++;
+			for (size_t i = 0; i < size; i++) {
+				this->writtenBytes++;
+				if (this->device && this->opened) this->device->onHostByte(buffer[i], this->baud);
+			}
+			return size;
+		}
+		using Print::write;
+
+	private:
+		struct Pending {
+			Pending(unsigned long long at, uint8_t value) : at(at), value(value) {}
+			unsigned long long at;
+			uint8_t value;
+		};
+		std::deque<Pending> rx;
+		NativeSerialDevice *device = NULL;
+		unsigned long baud = 9600;
+		bool opened = false;
+		unsigned int beginCount = 0;
+		size_t writtenBytes = 0;
+		size_t writeCalls = 0;
+};
+
+class HardwareSerial : public NativeSerialPort {};
+
+static HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,413 @@
+/**
+ * @file E220Simulator.h
+ * @brief Simulated EByte E220 module for the PlatformIO native test environment
+ *
+ * Sits on the other end of a NativeSerialPort and drives the AUX pin, so the
+ * real LoRa_E220 class runs unchanged on the host. It models:
+ * - Modes from the M0/M1 pins (AUX LOW while switching)
+ * - The program mode register protocol: C0/C2 write (saved/temporary),
+ *   C1 read, answered with C1 + address + length + data, FF FF FF on error;
+ *   only at 9600 bps, and CRYPT reads back as 0 like the real module. After
+ *   the answer to a write, AUX stays LOW while the registers are stored and
+ *   command bytes received meanwhile are dropped
+ * - Transmission: UART bytes are collected until the line is idle for 3
+ *   characters or a sub packet is full, then sent over the air sub packet by
+ *   sub packet with the time on air of LoRa_E220_Airtime.h. AUX stays LOW
+ *   until the buffer is empty
+ * - Fixed (3-byte address header) and transparent addressing, broadcast
+ *   address 0xFFFF, channel and air data rate matching
+ * - Reception on linked simulators: output at the configured UART rate,
+ *   AUX LOW during the output, RSSI byte appended when enabled in REG5
+ * - WOR: mode 1 adds the wake-up preamble to the airtime, mode 2 only
+ *   receives packets sent from mode 1
+ * - RSSI registers: with ambient noise enabled (REG1 bit 5), C0 C1 C2 C3 +
+ *   address + length written in normal mode reads the ambient noise and
+ *   last packet RSSI, answered C1 + address + length + values
+ * - Wireless configuration: a packet received in normal mode made of CF CF
+ *   and a command runs it, and the answer goes back on air, prefixed with
+ *   CF CF, as a broadcast on the module's channel
+ *
+ * Not modelled: encryption, LBT, power levels.
+ *
+ * @note Header only: include it from the test file
+ */
+#ifndef NATIVE_E220_SIMULATOR_H
+#define NATIVE_E220_SIMULATOR_H
+
+#include "Arduino.h"
+#include "LoRa_E220_Airtime.h"
+
+#define E220_SIMULATOR_REGISTERS 8
+#define E220_SIMULATOR_BUFFER 400
+#define E220_SIMULATOR_MAX_PEERS 8
+#define E220_SIMULATOR_NEVER (~0ULL)
+
+class E220Simulator : public NativePeripheral, public NativeSerialDevice {
+	public:
+		/** Working registers 00H-07H: ADDH ADDL SPED OPTION CHAN TRANSMISSION_MODE CRYPT_H CRYPT_L */
+		uint8_t registers[E220_SIMULATOR_REGISTERS] = { 0x00, 0x00, 0x62, 0x00, 0x17, 0x03, 0x00, 0x00 };
+		/** Registers kept over a power cycle (written by C0) */
+		uint8_t saved[E220_SIMULATOR_REGISTERS] = { 0x00, 0x00, 0x62, 0x00, 0x17, 0x03, 0x00, 0x00 };
+		/** Product information at 08H-0AH */
+		uint8_t productInformation[3] = { 0x20, 0x0B, 0x14 };
+
+		/** RSSI byte appended to packets received by this module */
+		uint8_t rssi = 200;
+		/** RSSI byte of the ambient noise register */
+		uint8_t ambientRSSI = 160;
+		/** Ambient noise per channel (256 entries), instead of ambientRSSI when set */
+		const uint8_t *channelNoise = NULL;
+		/** RSSI byte of the last packet register */
+		uint8_t lastPacketRSSI = 0;
+		/** AUX LOW time after a mode change */
+		unsigned long modeSwitchMicros = 2000;
+		/** Time between the end of a command and the start of the answer */
+		unsigned long commandMicros = 1000;
+		/** AUX LOW time after the answer to a C0/C2 write, while the registers are stored */
+		unsigned long registerWriteMicros = 5000;
+		/** Time between the end of a packet on air and the UART output */
+		unsigned long receiveMicros = 500;
+		/** Highest UART rate the wiring carries in normal mode, 0 for any: faster bytes are lost */
+		unsigned long maxDataBaud = 0;
+
+		unsigned long packetsSent = 0;       ///< Sub packets put on air
+		unsigned long packetsReceived = 0;   ///< Sub packets output on the UART
+		unsigned long bytesDropped = 0;      ///< Bytes lost: wrong baud rate, full buffer, busy mode
+		unsigned long programModeEntries = 0; ///< Switches into mode 3
+		unsigned long wirelessCommands = 0;   ///< CF CF commands run from the air
+
+		E220Simulator(NativeSerialPort &port, int8_t auxPin, int8_t m0Pin = -1, int8_t m1Pin = -1)
+			: port(&port), auxPin(auxPin), m0Pin(m0Pin), m1Pin(m1Pin) {
+			port.attachDevice(this);
+			nativeHostAttach(this);
+			this->mode = this->modeFromPins();
+			this->updateAux();
+		}
+
+		~E220Simulator() {
+			nativeHostDetach(this);
+			for (uint8_t i = 0; i < this->peerCount; i++) this->peers[i]->removePeer(this);
+		}
+
+		/** Put two modules in radio range of each other */
+		static void link(E220Simulator &a, E220Simulator &b) {
+			a.addPeer(&b);
+			b.addPeer(&a);
+		}
+
+		/** Restore the registers saved by C0, as after a power cycle */
+		void powerCycle() {
+			memcpy(this->registers, this->saved, sizeof(this->registers));
+			this->txLength = 0;
+			this->commandLength = 0;
+		}
+
+		/** Current mode from M0/M1 (0 normal, 1 WOR TX, 2 WOR RX, 3 program) */
+		uint8_t getMode() const { return this->mode; }
+		/** A packet is on air or waiting in the buffer */
+		bool isTransmitting() const { return this->txLength > 0 || this->airEnd != E220_SIMULATOR_NEVER; }
+		/** UART rate configured in REG2 */
+		unsigned long getUARTBaud() const { return uartBaud(this->registers[2] >> 5); }
+		AIR_DATA_RATE getAirDataRate() const { return (AIR_DATA_RATE)(this->registers[2] & 0x07); }
+		SUB_PACKET_SETTING getSubPacketSetting() const { return (SUB_PACKET_SETTING)(this->registers[3] >> 6); }
+		uint16_t getAddress() const { return ((uint16_t)this->registers[0] << 8) | this->registers[1]; }
+		uint8_t getChannel() const { return this->registers[4]; }
+		bool isFixedTransmission() const { return this->registers[5] & 0x40; }
+		bool isRSSIEnabled() const { return this->registers[5] & 0x80; }
+
+		/**
+		 * @brief Receive a packet from the air, as if sent by a module in range
+		 * @param woken The sender was in WOR transmitter mode
+		 */
+		void receiveFromAir(const uint8_t *data, uint8_t size, uint16_t address, uint8_t channel, AIR_DATA_RATE airDataRate, bool woken = false) {
+			if (this->mode == 3 || this->switching) return;
+			if (this->mode == 2 && !woken) return;
+			if (channel != this->getChannel() || airDataRate != this->getAirDataRate()) return;
+			if (address != 0xFFFF && address != this->getAddress()) return;
+
+			// a write, or a bare read: an echo (CF CF C1 + data) is output like any packet
+			if (this->mode == 0 && size >= 5 && data[0] == 0xCF && data[1] == 0xCF
+					&& (data[2] == 0xC0 || data[2] == 0xC2 || (data[2] == 0xC1 && size == 5))) {
+				this->onWirelessCommand(data + 2, size - 2);
+				return;
+			}
+
+			unsigned long baud = this->getUARTBaud();
+			if (this->port->getBaud() != baud) {
+				this->bytesDropped += size;
+				return;
+			}
+
+			unsigned long charMicros = 10000000UL / baud;
+			unsigned long long start = nativeHostNow() + this->receiveMicros;
+			if (start < this->rxOutputEnd) start = this->rxOutputEnd;
+			this->port->deliver(data, size, start, charMicros);
+			if (this->isRSSIEnabled()) {
+				this->port->deliver(&this->rssi, 1, start + (unsigned long long)size * charMicros, charMicros);
+				size++;
+			}
+			this->rxOutputEnd = start + (unsigned long long)size * charMicros;
+			this->lastPacketRSSI = this->rssi;
+			this->packetsReceived++;
+			this->updateAux();
+		}
+
+		// NativeSerialDevice
+		void onHostByte(uint8_t c, unsigned long baud) {
+			unsigned long long now = nativeHostNow();
+			unsigned long charMicros = 10000000UL / baud;
+			if (this->hostByteEnd < now) this->hostByteEnd = now;
+			this->hostByteEnd += charMicros;
+
+			if (this->mode == 3) {
+				if (baud != 9600 || now < this->storeEnd) { this->bytesDropped++; return; }
+				this->onCommandByte(c);
+				return;
+			}
+			if (this->mode == 2 || baud != this->getUARTBaud() || this->txLength >= E220_SIMULATOR_BUFFER
+					|| (this->maxDataBaud && baud > this->maxDataBaud)) {
+				this->bytesDropped++;
+				return;
+			}
+
+			if (this->txLength == 0 && this->airEnd == E220_SIMULATOR_NEVER) this->needHeader = this->isFixedTransmission();
+			this->txBuffer[this->txLength++] = c;
+			this->txIdleAt = this->hostByteEnd + 3 * charMicros;
+			if (this->txLength == 6 && this->mode == 0 && (this->registers[3] & 0x20) && this->airEnd == E220_SIMULATOR_NEVER
+					&& this->txBuffer[0] == 0xC0 && this->txBuffer[1] == 0xC1 && this->txBuffer[2] == 0xC2 && this->txBuffer[3] == 0xC3) {
+				this->txLength = 0;
+				this->onRSSICommand(this->txBuffer[4], this->txBuffer[5], baud);
+			}
+			this->updateAux();
+		}
+
+		// NativePeripheral
+		void onPinWrite(uint8_t pin, uint8_t level) {
+			(void)level;
+			if (pin != this->m0Pin && pin != this->m1Pin) return;
+			uint8_t newMode = this->modeFromPins();
+			if (newMode == this->mode && !this->switching) return;
+			if (newMode == 3 && this->mode != 3) this->programModeEntries++;
+			this->mode = newMode;
+			this->switching = true;
+			this->switchEnd = nativeHostNow() + this->modeSwitchMicros;
+			this->commandLength = 0;
+			this->updateAux();
+		}
+
+		unsigned long long nextEventMicros() {
+			unsigned long long next = E220_SIMULATOR_NEVER;
+			if (this->switching && this->switchEnd < next) next = this->switchEnd;
+			if (this->airEnd < next) next = this->airEnd;
+			if (this->airEnd == E220_SIMULATOR_NEVER && this->txLength > 0 && !this->switching && this->mode != 3) {
+				unsigned long long start = this->txReady() ? this->hostByteEnd : this->txIdleAt;
+				if (start < next) next = start;
+			}
+			if (this->rxOutputEnd > nativeHostNow() && this->rxOutputEnd < next) next = this->rxOutputEnd;
+			if (this->storeEnd > nativeHostNow() && this->storeEnd < next) next = this->storeEnd;
+			return next;
+		}
+
+		void update(unsigned long long now) {
+			if (this->switching && now >= this->switchEnd) this->switching = false;
+
+			if (this->airEnd != E220_SIMULATOR_NEVER && now >= this->airEnd) {
+				this->airEnd = E220_SIMULATOR_NEVER;
+				for (uint8_t i = 0; i < this->peerCount; i++) {
+					this->peers[i]->receiveFromAir(this->airPacket, this->airLength, this->airAddress, this->airChannel,
+							this->getAirDataRate(), this->airWoken);
+				}
+			}
+
+			if (this->airEnd == E220_SIMULATOR_NEVER && this->txLength > 0 && !this->switching && this->mode != 3
+					&& (now >= this->txIdleAt || (this->txReady() && now >= this->hostByteEnd))) {
+				this->startSubPacket(now);
+			}
+			this->updateAux();
+		}
+
+	private:
+		NativeSerialPort *port;
+		int8_t auxPin;
+		int8_t m0Pin;
+		int8_t m1Pin;
+
+		E220Simulator *peers[E220_SIMULATOR_MAX_PEERS];
+		uint8_t peerCount = 0;
+
+		uint8_t mode = 0;
+		bool switching = false;
+		unsigned long long switchEnd = 0;
+
+		uint8_t commandBuffer[3 + E220_SIMULATOR_REGISTERS];
+		uint8_t commandLength = 0;
+
+		uint8_t txBuffer[E220_SIMULATOR_BUFFER];
+		uint16_t txLength = 0;
+		bool needHeader = false;
+		uint16_t txAddress = 0;
+		uint8_t txChannel = 0;
+		unsigned long long hostByteEnd = 0;
+		unsigned long long txIdleAt = 0;
+
+		uint8_t airPacket[200];
+		uint8_t airLength = 0;
+		uint16_t airAddress = 0;
+		uint8_t airChannel = 0;
+		bool airWoken = false;
+		unsigned long long airEnd = E220_SIMULATOR_NEVER;
+
+		unsigned long long rxOutputEnd = 0;
+		unsigned long long storeEnd = 0;
+
+		static unsigned long uartBaud(uint8_t code) {
+			static const unsigned long rates[8] = { 1200, 2400, 4800, 9600, 19200, 38400, 57600, 115200 };
+			return rates[code & 0x07];
+		}
+
+		void addPeer(E220Simulator *peer) {
+			if (this->peerCount < E220_SIMULATOR_MAX_PEERS) this->peers[this->peerCount++] = peer;
+		}
+
+		void removePeer(E220Simulator *peer) {
+			for (uint8_t i = 0; i < this->peerCount; i++) {
+				if (this->peers[i] != peer) continue;
+				this->peers[i] = this->peers[--this->peerCount];
+				return;
+			}
+		}
+
+		uint8_t modeFromPins() const {
+			uint8_t m0 = this->m0Pin >= 0 ? nativeHost().pinLevel[this->m0Pin] : LOW;
+			uint8_t m1 = this->m1Pin >= 0 ? nativeHost().pinLevel[this->m1Pin] : LOW;
+			return (m1 ? 2 : 0) | (m0 ? 1 : 0);
+		}
+
+		void updateAux() {
+			if (this->auxPin < 0) return;
+			bool busy = this->switching || this->txLength > 0 || this->airEnd != E220_SIMULATOR_NEVER
+					|| this->rxOutputEnd > nativeHostNow() || this->storeEnd > nativeHostNow();
+			nativeSetPinLevel(this->auxPin, busy ? LOW : HIGH);
+		}
+
+		/** A full sub packet is buffered: no need to wait for the idle line */
+		bool txReady() const {
+			uint16_t needed = getSubPacketSizeBytes(this->getSubPacketSetting()) + (this->needHeader ? 3 : 0);
+			return this->txLength >= needed;
+		}
+
+		void startSubPacket(unsigned long long now) {
+			uint16_t offset = 0;
+			if (this->needHeader) {
+				if (this->txLength < 3) { this->txLength = 0; return; }
+				this->txAddress = ((uint16_t)this->txBuffer[0] << 8) | this->txBuffer[1];
+				this->txChannel = this->txBuffer[2];
+				this->needHeader = false;
+				offset = 3;
+			} else if (!this->isFixedTransmission()) {
+				this->txAddress = this->getAddress();
+				this->txChannel = this->getChannel();
+			}
+
+			uint8_t size = getSubPacketSizeBytes(this->getSubPacketSetting());
+			if (this->txLength - offset < size) size = this->txLength - offset;
+			memcpy(this->airPacket, this->txBuffer + offset, size);
+			this->airLength = size;
+			this->airAddress = this->txAddress;
+			this->airChannel = this->txChannel;
+			this->airWoken = (this->mode == 1);
+
+			this->txLength -= offset + size;
+			memmove(this->txBuffer, this->txBuffer + offset + size, this->txLength);
+
+			unsigned long long airtime = getPacketAirtimeMicros(this->getAirDataRate(), size);
+			if (this->airWoken) airtime += 500000ULL * ((this->registers[5] & 0x07) + 1);
+			this->airEnd = now + airtime;
+			this->packetsSent++;
+			if (size == 0) this->airEnd = now;
+		}
+
+		void onCommandByte(uint8_t c) {
+			if (this->commandLength < sizeof(this->commandBuffer)) this->commandBuffer[this->commandLength++] = c;
+			if (this->commandLength < 3) return;
+
+			uint8_t command = this->commandBuffer[0];
+			uint8_t length = this->commandBuffer[2];
+			bool write = (command == 0xC0 || command == 0xC2);
+			if (write && this->commandLength < 3 + length && 3 + length <= (int)sizeof(this->commandBuffer)) return;
+
+			uint8_t answer[3 + E220_SIMULATOR_REGISTERS + 3];
+			uint8_t answerLength = this->runCommand(this->commandBuffer, this->commandLength, answer);
+			this->commandLength = 0;
+
+			unsigned long long answerStart = this->hostByteEnd + this->commandMicros;
+			this->port->deliver(answer, answerLength, answerStart, 10000000UL / 9600);
+			if (write && answer[0] == 0xC1) {
+				this->storeEnd = answerStart + (unsigned long long)answerLength * (10000000UL / 9600) + this->registerWriteMicros;
+				this->updateAux();
+			}
+		}
+
+		void onRSSICommand(uint8_t address, uint8_t length, unsigned long baud) {
+			uint8_t ambient = this->channelNoise ? this->channelNoise[this->getChannel()] : this->ambientRSSI;
+			uint8_t values[2] = { ambient, this->lastPacketRSSI };
+			uint8_t answer[3 + 2] = { 0xC1, address, length };
+			if (address + length > 2) {
+				answer[0] = answer[1] = answer[2] = 0xFF;
+				length = 0;
+			}
+			for (uint8_t i = 0; i < length; i++) answer[3 + i] = values[address + i];
+			this->port->deliver(answer, 3 + length, this->hostByteEnd + this->commandMicros, 10000000UL / baud);
+		}
+
+		/** Answer to the command after CF CF, sent back on air (dropped if the radio is busy) */
+		void onWirelessCommand(const uint8_t *command, uint8_t length) {
+			this->wirelessCommands++;
+			uint8_t answer[2 + 3 + E220_SIMULATOR_REGISTERS + 3];
+			answer[0] = answer[1] = 0xCF;
+			uint8_t answerLength = 2 + this->runCommand(command, length, answer + 2);
+			if (this->isTransmitting()) return;
+
+			memcpy(this->airPacket, answer, answerLength);
+			this->airLength = answerLength;
+			this->airAddress = 0xFFFF;
+			this->airChannel = this->getChannel();
+			this->airWoken = false;
+			this->airEnd = nativeHostNow() + this->commandMicros + getPacketAirtimeMicros(this->getAirDataRate(), answerLength);
+			this->packetsSent++;
+			this->updateAux();
+		}
+
+		/** Run a complete C0/C1/C2 command, return the answer length */
+		uint8_t runCommand(const uint8_t *commandBuffer, uint8_t commandLength, uint8_t *answer) {
+			uint8_t command = commandBuffer[0];
+			uint8_t address = commandBuffer[1];
+			uint8_t length = commandBuffer[2];
+			bool write = (command == 0xC0 || command == 0xC2);
+
+			uint8_t answerLength = 3;
+			bool readable = (command == 0xC1 && address + length <= E220_SIMULATOR_REGISTERS + 3);
+			bool writable = (write && address + length <= E220_SIMULATOR_REGISTERS && commandLength >= 3 + length);
+
+			if (readable || writable) {
+				answer[0] = 0xC1;
+				answer[1] = address;
+				answer[2] = length;
+				for (uint8_t i = 0; i < length; i++) {
+					uint8_t reg = address + i;
+					if (write) {
+						this->registers[reg] = commandBuffer[3 + i];
+						if (command == 0xC0) this->saved[reg] = commandBuffer[3 + i];
+					}
+					// CRYPT is write only
+					answer[answerLength++] = reg >= E220_SIMULATOR_REGISTERS ? this->productInformation[reg - E220_SIMULATOR_REGISTERS]
+							: (reg >= 6 ? 0 : this->registers[reg]);
+				}
+			} else {
+				answer[0] = answer[1] = answer[2] = 0xFF;
+			}
+			return answerLength;
+		}
+};
+
+#endif
@@ -0,0 +1,69 @@
+/**
+ * @file NativeHeapCounter.h
+ * @brief Counts heap allocations of the native test environment
+ *
+ * Replaces malloc/calloc/realloc and operator new so a test can assert that
+ * a library call does not allocate. Include it from exactly one file of a
+ * test program.
+ *
+ * @note Relies on glibc (__libc_malloc), as on the CI runners
+ */
+#ifndef NATIVE_HEAP_COUNTER_H
+#define NATIVE_HEAP_COUNTER_H
+
+#include <stddef.h>
+#include <new>
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+extern "C" void __libc_free(void *ptr);
+
+/** Allocations are counted only while this is true */
+static volatile bool nativeHeapTracking = false;
+/** Number of allocations counted since the last reset */
+static volatile unsigned long nativeHeapAllocations = 0;
+
+/** Start counting allocations from zero */
+inline void nativeHeapTrack() { nativeHeapAllocations = 0; nativeHeapTracking = true; }
+/** Stop counting and return the allocations counted */
+inline unsigned long nativeHeapUntrack() { nativeHeapTracking = false; return nativeHeapAllocations; }
+
+/**
+ * @brief Suspends counting in its scope, for the test harness own allocations
+ * (e.g. a simulated peripheral queueing bytes)
+ */
+struct NativeHeapUntracked {
+	bool saved;
+	NativeHeapUntracked() : saved(nativeHeapTracking) { nativeHeapTracking = false; }
+	~NativeHeapUntracked() { nativeHeapTracking = saved; }
+};
+
+extern "C" void *malloc(size_t size) {
+	if (nativeHeapTracking) nativeHeapAllocations++;
+	return __libc_malloc(size);
+}
+extern "C" void *calloc(size_t count, size_t size) {
+	if (nativeHeapTracking) nativeHeapAllocations++;
+	return __libc_calloc(count, size);
+}
+extern "C" void *realloc(void *ptr, size_t size) {
+	if (nativeHeapTracking) nativeHeapAllocations++;
+	return __libc_realloc(ptr, size);
+}
+extern "C" void free(void *ptr) {
+	__libc_free(ptr);
+}
+void *operator new(size_t size) {
+	if (nativeHeapTracking) nativeHeapAllocations++;
+	void *p = __libc_malloc(size);
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *ptr) noexcept { __libc_free(ptr); }
+void operator delete[](void *ptr) noexcept { __libc_free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { __libc_free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { __libc_free(ptr); }
+
+#endif
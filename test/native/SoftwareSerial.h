@@ -0,0 +1,21 @@
+/**
+ * @file SoftwareSerial.h
+ * @brief Host stand-in for SoftwareSerial in the PlatformIO native test environment
+ */
+#ifndef NATIVE_SOFTWARE_SERIAL_H
+#define NATIVE_SOFTWARE_SERIAL_H
+
+#include "Arduino.h"
+
+class SoftwareSerial : public NativeSerialPort {
+	public:
+		SoftwareSerial(uint8_t receivePin, uint8_t transmitPin) : receivePin(receivePin), transmitPin(transmitPin) {}
+		bool listen() { return true; }
+		bool isListening() { return true; }
+
+	private:
+		uint8_t receivePin;
+		uint8_t transmitPin;
+};
+
+#endif
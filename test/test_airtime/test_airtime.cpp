@@ -0,0 +1,177 @@
+/**
+ * Airtime model: the constant expressions checked at compile time and at run
+ * time against the Semtech LoRa formula worked out by hand for each air data
+ * rate and sub packet size, then LoRa_E220_Pacer spacing its sends on the
+ * virtual clock by UART transfer, airtime and margin.
+ */
+#include <unity.h>
+#include <stdio.h>
+
+#include "LoRa_E220.h"
+#include "LoRa_E220_Airtime.h"
+#include "E220Simulator.h"
+
+#define SENDER_AUX 4
+#define SENDER_M0 5
+#define SENDER_M1 6
+#define RECEIVER_AUX 7
+#define RECEIVER_M0 8
+#define RECEIVER_M1 9
+
+#define MARGIN 1000
+
+/*
+ * Tsym * (8 + 4.25) + Tsym * (8 + ceil((8 PL - 4 SF + 44) / (4 SF)) * 5), in us,
+ * for a full sub packet of 200, 128, 64 and 32 bytes
+ */
+static const AIR_DATA_RATE rates[] = {
+	AIR_DATA_RATE_000_24, AIR_DATA_RATE_011_48, AIR_DATA_RATE_100_96,
+	AIR_DATA_RATE_101_192, AIR_DATA_RATE_110_384, AIR_DATA_RATE_111_625
+};
+static const SUB_PACKET_SETTING subPackets[] = { SPS_200_00, SPS_128_01, SPS_064_10, SPS_032_11 };
+static const uint32_t fullPacketMicros[6][4] = {
+	{ 1004544, 676864, 390144, 246784 },  // SF9 BW125
+	{ 317696, 215296, 118016, 71936 },    // SF7 BW125
+	{ 184448, 123008, 69248, 41088 },     // SF6 BW125
+	{ 92224, 61504, 34624, 20544 },       // SF6 BW250
+	{ 46112, 30752, 17312, 10272 },       // SF6 BW500
+	{ 27536, 18256, 9936, 5776 }          // SF5 BW500
+};
+
+static_assert(getAirtimeMicros(AIR_DATA_RATE_000_24, SPS_200_00, 200) == 1004544, "2.4 kbps, 200 bytes");
+static_assert(getAirtimeMicros(AIR_DATA_RATE_011_48, SPS_128_01, 128) == 215296, "4.8 kbps, 128 bytes");
+static_assert(getAirtimeMicros(AIR_DATA_RATE_100_96, SPS_064_10, 64) == 69248, "9.6 kbps, 64 bytes");
+static_assert(getAirtimeMicros(AIR_DATA_RATE_101_192, SPS_032_11, 32) == 20544, "19.2 kbps, 32 bytes");
+static_assert(getAirtimeMicros(AIR_DATA_RATE_110_384, SPS_200_00, 200) == 46112, "38.4 kbps, 200 bytes");
+static_assert(getAirtimeMicros(AIR_DATA_RATE_111_625, SPS_064_10, 64) == 9936, "62.5 kbps, 64 bytes");
+static_assert(getAirtimeMicros(AIR_DATA_RATE_111_625, SPS_128_01, 300) == 2 * 18256 + 7376, "300 bytes in 3 sub packets");
+static_assert(getUARTTransferMicros(UART_BPS_RATE_9600, 23) == 23958, "23 bytes at 9600 bps");
+
+static HardwareSerial senderPort;
+static HardwareSerial receiverPort;
+static E220Simulator *senderModule;
+static E220Simulator *receiverModule;
+static LoRa_E220 *sender;
+
+void setUp(void) {
+	nativeHostReset();
+	senderPort = HardwareSerial();
+	receiverPort = HardwareSerial();
+	senderModule = new E220Simulator(senderPort, SENDER_AUX, SENDER_M0, SENDER_M1);
+	receiverModule = new E220Simulator(receiverPort, RECEIVER_AUX, RECEIVER_M0, RECEIVER_M1);
+	E220Simulator::link(*senderModule, *receiverModule);
+
+	sender = new LoRa_E220(&senderPort, SENDER_AUX, SENDER_M0, SENDER_M1, UART_BPS_RATE_9600);
+	TEST_ASSERT_TRUE(sender->begin());
+
+	Configuration configuration;
+	TEST_ASSERT_EQUAL(E220_SUCCESS, sender->getConfiguration(configuration).code);
+	configuration.SPED.airDataRate = AIR_DATA_RATE_111_625;
+	configuration.OPTION.subPacketSetting = SPS_064_10;
+	configuration.TRANSMISSION_MODE.fixedTransmission = FT_FIXED_TRANSMISSION;
+	TEST_ASSERT_EQUAL(E220_SUCCESS, sender->setConfiguration(configuration, WRITE_CFG_PWR_DWN_LOSE).code);
+}
+
+void tearDown(void) {
+	delete sender;
+	delete senderModule;
+	delete receiverModule;
+}
+
+void test_airtime_table(void) {
+	for (uint8_t r = 0; r < 6; r++) {
+		for (uint8_t s = 0; s < 4; s++) {
+			uint8_t size = getSubPacketSizeBytes(subPackets[s]);
+			char message[48];
+			snprintf(message, sizeof(message), "rate %u, %u bytes", rates[r], size);
+			TEST_ASSERT_EQUAL_UINT32_MESSAGE(fullPacketMicros[r][s], getAirtimeMicros(rates[r], subPackets[s], size), message);
+
+			// one byte more starts a second sub packet
+			TEST_ASSERT_EQUAL_UINT32_MESSAGE(fullPacketMicros[r][s] + getPacketAirtimeMicros(rates[r], 1),
+					getAirtimeMicros(rates[r], subPackets[s], size + 1), message);
+		}
+	}
+
+	// the 2.4 kbps codes share one table entry
+	TEST_ASSERT_EQUAL_UINT32(getPacketAirtimeMicros(AIR_DATA_RATE_000_24, 10), getPacketAirtimeMicros(AIR_DATA_RATE_001_24, 10));
+	TEST_ASSERT_EQUAL_UINT32(getPacketAirtimeMicros(AIR_DATA_RATE_000_24, 10), getPacketAirtimeMicros(AIR_DATA_RATE_010_24, 10));
+
+	// smallest packets: the preamble and header dominate
+	TEST_ASSERT_EQUAL_UINT32(1936, getPacketAirtimeMicros(AIR_DATA_RATE_111_625, 1));
+	TEST_ASSERT_EQUAL_UINT32(103424, getPacketAirtimeMicros(AIR_DATA_RATE_000_24, 1));
+}
+
+void test_pacer_duty_cycle(void) {
+	LoRa_E220_Pacer pacer(*sender, AIR_DATA_RATE_111_625, SPS_064_10, UART_BPS_RATE_9600, MARGIN);
+	// 3 address bytes and 20 payload bytes on the UART, the 20 bytes on air
+	const unsigned long airtime = getAirtimeMicros(AIR_DATA_RATE_111_625, SPS_064_10, 20);
+	const unsigned long interval = getUARTTransferMicros(UART_BPS_RATE_9600, 23) + airtime + MARGIN;
+	uint8_t reading[20];
+	memset(reading, 0x5A, sizeof(reading));
+
+	TEST_ASSERT_EQUAL(0, pacer.getFreeInMicros());
+	size_t writes = senderPort.getWriteCalls();
+
+	// the first frame is written at once
+	TEST_ASSERT_EQUAL(E220_SUCCESS, pacer.sendFixedMessage(0x00, 0x02, 23, reading, sizeof(reading)).code);
+	TEST_ASSERT_FALSE(pacer.isPending());
+	TEST_ASSERT_EQUAL(E220_SUCCESS, pacer.getLastStatus().code);
+	TEST_ASSERT_EQUAL(writes + 1, senderPort.getWriteCalls());
+	TEST_ASSERT_UINT32_WITHIN(100, interval, pacer.getFreeInMicros());
+
+	// the next one waits for the predicted end, a third is refused meanwhile
+	TEST_ASSERT_EQUAL(E220_SUCCESS, pacer.sendFixedMessage(0x00, 0x02, 23, reading, sizeof(reading)).code);
+	TEST_ASSERT_TRUE(pacer.isPending());
+	TEST_ASSERT_EQUAL(ERR_E220_BUSY, pacer.sendFixedMessage(0x00, 0x02, 23, reading, sizeof(reading)).code);
+	TEST_ASSERT_FALSE(pacer.poll());
+	TEST_ASSERT_EQUAL(writes + 1, senderPort.getWriteCalls());
+
+	// a stream of frames, each written as soon as poll() finds the radio free
+	unsigned long first = 0;
+	unsigned long last = 0;
+	uint8_t sent = 0;
+	while (sent < 10) {
+		if (!pacer.isPending()) {
+			TEST_ASSERT_EQUAL(E220_SUCCESS, pacer.sendFixedMessage(0x00, 0x02, 23, reading, sizeof(reading)).code);
+		}
+		if (pacer.poll()) {
+			unsigned long now = micros();
+			if (sent > 0) TEST_ASSERT_UINT32_WITHIN(200, interval, now - last);
+			if (sent == 0) first = now;
+			last = now;
+			sent++;
+		}
+		delayMicroseconds(50);
+	}
+	TEST_ASSERT_EQUAL(writes + 11, senderPort.getWriteCalls());
+
+	// the air is busy for airtime out of every interval
+	unsigned long elapsed = last - first;
+	TEST_ASSERT_UINT32_WITHIN(9 * 200, 9 * interval, elapsed);
+	TEST_ASSERT_UINT32_WITHIN(5, airtime * 1000UL / interval, 9 * airtime * 1000UL / elapsed);
+
+	delay(100);
+	TEST_ASSERT_EQUAL(11, senderModule->packetsSent);
+	TEST_ASSERT_EQUAL(0, senderModule->bytesDropped);
+}
+
+void test_pacer_rejects_bad_sizes(void) {
+	LoRa_E220_Pacer pacer(*sender, AIR_DATA_RATE_111_625, SPS_064_10);
+	uint8_t data[MAX_SIZE_TX_PACKET + 1];
+	memset(data, 0, sizeof(data));
+
+	TEST_ASSERT_EQUAL(ERR_E220_PACKET_TOO_BIG, pacer.sendMessage(data, 0).code);
+	TEST_ASSERT_EQUAL(ERR_E220_PACKET_TOO_BIG, pacer.sendFixedMessage(0x00, 0x02, 23, data, MAX_SIZE_TX_PACKET).code);
+	TEST_ASSERT_FALSE(pacer.isPending());
+	TEST_ASSERT_EQUAL(0, pacer.getFreeInMicros());
+}
+
+int main(int argc, char **argv) {
+	UNITY_BEGIN();
+
+	RUN_TEST(test_airtime_table);
+	RUN_TEST(test_pacer_duty_cycle);
+	RUN_TEST(test_pacer_rejects_bad_sizes);
+
+	return UNITY_END();
+}
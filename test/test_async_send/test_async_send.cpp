@@ -0,0 +1,205 @@
+/**
+ * Non-blocking send: state machine behaviour and loop time benchmark.
+ *
+ * A minimal radio stand-in holds AUX LOW while it "transmits" (UART transfer
+ * plus a fixed airtime) so the real LoRa_E220 class can be exercised on the
+ * host with the virtual clock of test/native/Arduino.h.
+ */
+#include <unity.h>
+#include <stdio.h>
+
+#include "LoRa_E220.h"
+
+#define AUX_PIN 4
+#define M0_PIN 5
+#define M1_PIN 6
+
+#define AIRTIME_US 60000UL
+#define MESSAGES 20
+
+class BusyRadio : public NativePeripheral, public NativeSerialDevice {
+	public:
+		unsigned long long uartEnd = 0;
+		unsigned long long busyUntil = 0;
+		size_t received = 0;
+
+		void onHostByte(uint8_t c, unsigned long baud) {
+			(void)c;
+			received++;
+			unsigned long long now = nativeHostNow();
+			uartEnd = (uartEnd > now ? uartEnd : now) + 10000000ULL / baud;
+			busyUntil = uartEnd + AIRTIME_US;
+			nativeSetPinLevel(AUX_PIN, LOW);
+		}
+		void update(unsigned long long now) {
+			if (busyUntil && now >= busyUntil) {
+				busyUntil = 0;
+				nativeSetPinLevel(AUX_PIN, HIGH);
+			}
+		}
+		unsigned long long nextEventMicros() { return busyUntil ? busyUntil : ~0ULL; }
+};
+
+static HardwareSerial port;
+static BusyRadio radio;
+static uint8_t payload[24];
+
+static void attachRadio() {
+	nativeHostReset();
+	radio = BusyRadio();
+	port = HardwareSerial();
+	port.attachDevice(&radio);
+	nativeHostAttach(&radio);
+	nativeSetPinLevel(AUX_PIN, HIGH);
+}
+
+void setUp(void) {
+	attachRadio();
+	for (uint8_t i = 0; i < sizeof(payload); i++) payload[i] = i;
+}
+
+void tearDown(void) {
+}
+
+void test_begin_send_returns_before_transmission_ends() {
+	LoRa_E220 e220(&port, AUX_PIN, M0_PIN, M1_PIN, UART_BPS_RATE_9600);
+	TEST_ASSERT_TRUE(e220.begin());
+
+	unsigned long long start = nativeHostNow();
+	ResponseStatus rs = e220.beginSend(payload, sizeof(payload));
+	TEST_ASSERT_EQUAL(E220_SUCCESS, rs.code);
+	TEST_ASSERT_LESS_THAN(1000ULL, nativeHostNow() - start);
+	TEST_ASSERT_TRUE(e220.isSendPending());
+	TEST_ASSERT_EQUAL(SEND_WAIT_AUX, e220.poll());
+	TEST_ASSERT_EQUAL(ERR_E220_BUSY, e220.getSendStatus().code);
+
+	// A second send must not be accepted while the first one is on air
+	TEST_ASSERT_EQUAL(ERR_E220_BUSY, e220.beginSend(payload, sizeof(payload)).code);
+
+	SEND_STATE state;
+	while ((state = e220.poll()) != SEND_COMPLETE && state != SEND_FAILED) nativeHostAdvance(500);
+
+	TEST_ASSERT_EQUAL(SEND_COMPLETE, state);
+	TEST_ASSERT_EQUAL(E220_SUCCESS, e220.getSendStatus().code);
+	TEST_ASSERT_FALSE(e220.isSendPending());
+	TEST_ASSERT_EQUAL(sizeof(payload), radio.received);
+}
+
+void test_send_times_out_when_aux_stays_low() {
+	LoRa_E220 e220(&port, AUX_PIN, M0_PIN, M1_PIN, UART_BPS_RATE_9600);
+	TEST_ASSERT_TRUE(e220.begin());
+
+	e220.beginSend(payload, sizeof(payload));
+	radio.busyUntil = 0;
+	nativeSetPinLevel(AUX_PIN, LOW);
+
+	SEND_STATE state;
+	while ((state = e220.poll()) != SEND_COMPLETE && state != SEND_FAILED) nativeHostAdvance(10000);
+
+	TEST_ASSERT_EQUAL(SEND_FAILED, state);
+	TEST_ASSERT_EQUAL(ERR_E220_TIMEOUT, e220.getSendStatus().code);
+}
+
+void test_oversized_send_fails_immediately() {
+	LoRa_E220 e220(&port, AUX_PIN, M0_PIN, M1_PIN, UART_BPS_RATE_9600);
+	TEST_ASSERT_TRUE(e220.begin());
+
+	static uint8_t big[MAX_SIZE_TX_PACKET + 3];
+	TEST_ASSERT_EQUAL(ERR_E220_PACKET_TOO_BIG, e220.beginSend(big, sizeof(big)).code);
+	TEST_ASSERT_EQUAL(SEND_FAILED, e220.poll());
+}
+
+void test_aux_interrupt_records_transmission_edges() {
+	LoRa_E220 e220(&port, AUX_PIN, M0_PIN, M1_PIN, UART_BPS_RATE_9600);
+	TEST_ASSERT_TRUE(e220.begin(true));
+	TEST_ASSERT_TRUE(e220.isAuxInterruptEnabled());
+
+	AuxEdge edge;
+	while (e220.readAuxEdge(edge)) {}
+
+	unsigned long long sent = nativeHostNow();
+	TEST_ASSERT_EQUAL(E220_SUCCESS, e220.beginSend(payload, sizeof(payload)).code);
+	TEST_ASSERT_FALSE(e220.isAuxHigh());
+
+	SEND_STATE state;
+	while ((state = e220.poll()) != SEND_COMPLETE && state != SEND_FAILED) nativeHostAdvance(500);
+	TEST_ASSERT_EQUAL(SEND_COMPLETE, state);
+
+	TEST_ASSERT_TRUE(e220.readAuxEdge(edge));
+	TEST_ASSERT_EQUAL(LOW, edge.level);
+	unsigned long busy = edge.time;
+	TEST_ASSERT_TRUE(e220.readAuxEdge(edge));
+	TEST_ASSERT_EQUAL(HIGH, edge.level);
+	TEST_ASSERT_GREATER_OR_EQUAL(AIRTIME_US, edge.time - busy);
+	TEST_ASSERT_LESS_THAN(sent + AIRTIME_US + 30000, (unsigned long long)edge.time);
+	TEST_ASSERT_FALSE(e220.readAuxEdge(edge));
+
+	// Blocking path waits on the interrupt-tracked level too
+	TEST_ASSERT_EQUAL(E220_SUCCESS, e220.sendMessage(payload, sizeof(payload)).code);
+	TEST_ASSERT_TRUE(e220.isAuxHigh());
+}
+
+/*
+ * Benchmark: time the caller's loop spends inside the library per message.
+ * The blocking path spins for the whole transmission, the non-blocking path
+ * only costs the write plus cheap poll() calls; the rest is free for the
+ * application (modelled as 1 ms work slices).
+ */
+void test_benchmark_loop_time_freed_per_message() {
+	LoRa_E220 e220(&port, AUX_PIN, M0_PIN, M1_PIN, UART_BPS_RATE_9600);
+	TEST_ASSERT_TRUE(e220.begin());
+
+	unsigned long long blockingLibrary = 0;
+	for (int i = 0; i < MESSAGES; i++) {
+		unsigned long long t0 = nativeHostNow();
+		TEST_ASSERT_EQUAL(E220_SUCCESS, e220.sendMessage(payload, sizeof(payload)).code);
+		blockingLibrary += nativeHostNow() - t0;
+	}
+
+	unsigned long long asyncLibrary = 0;
+	unsigned long long asyncFree = 0;
+	unsigned long long asyncStart = nativeHostNow();
+	for (int i = 0; i < MESSAGES; i++) {
+		unsigned long long t0 = nativeHostNow();
+		TEST_ASSERT_EQUAL(E220_SUCCESS, e220.beginSend(payload, sizeof(payload)).code);
+		asyncLibrary += nativeHostNow() - t0;
+
+		for (;;) {
+			t0 = nativeHostNow();
+			SEND_STATE state = e220.poll();
+			asyncLibrary += nativeHostNow() - t0;
+			if (state == SEND_COMPLETE) break;
+			TEST_ASSERT_EQUAL(SEND_WAIT_AUX == state || SEND_GUARD_TIME == state, true);
+
+			// application work slice
+			nativeHostAdvance(1000);
+			asyncFree += 1000;
+		}
+	}
+	unsigned long long asyncTotal = nativeHostNow() - asyncStart;
+
+	double blockingPerMessage = blockingLibrary / 1000.0 / MESSAGES;
+	double asyncPerMessage = asyncLibrary / 1000.0 / MESSAGES;
+	double freedPerMessage = asyncFree / 1000.0 / MESSAGES;
+	printf("[bench] blocking send : %8.3f ms/msg in library, 0.000 ms/msg free\n", blockingPerMessage);
+	printf("[bench] beginSend+poll: %8.3f ms/msg in library, %.3f ms/msg free (%.1f%% of loop time)\n",
+			asyncPerMessage, freedPerMessage, 100.0 * asyncFree / asyncTotal);
+
+	// The blocking path spends at least the airtime plus the guard delay per message
+	TEST_ASSERT_GREATER_THAN(AIRTIME_US / 1000.0, blockingPerMessage);
+	// The non-blocking path gives the airtime back to the application
+	TEST_ASSERT_LESS_THAN(1.0, asyncPerMessage);
+	TEST_ASSERT_GREATER_THAN(AIRTIME_US / 1000.0, freedPerMessage);
+}
+
+int main(int argc, char **argv) {
+	UNITY_BEGIN();
+
+	RUN_TEST(test_begin_send_returns_before_transmission_ends);
+	RUN_TEST(test_send_times_out_when_aux_stays_low);
+	RUN_TEST(test_oversized_send_fails_immediately);
+	RUN_TEST(test_aux_interrupt_records_transmission_edges);
+	RUN_TEST(test_benchmark_loop_time_freed_per_message);
+
+	return UNITY_END();
+}
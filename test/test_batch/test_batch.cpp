@@ -0,0 +1,230 @@
+/**
+ * Batching transmit queue: messages packed per destination, frames sent on
+ * size, age, eviction and flush, received and split by LoRa_E220_BatchReader
+ * through two simulated modules; failed frames kept for a retry or dropped.
+ */
+#include <unity.h>
+#include <stdio.h>
+
+#include "LoRa_E220.h"
+#include "LoRa_E220_Batch.h"
+#include "E220Simulator.h"
+
+#define SENDER_AUX 4
+#define SENDER_M0 5
+#define SENDER_M1 6
+#define RECEIVER_AUX 7
+#define RECEIVER_M0 8
+#define RECEIVER_M1 9
+#define STUCK_AUX 10
+
+#define MAX_DELAY 100
+
+static HardwareSerial senderPort;
+static HardwareSerial receiverPort;
+static E220Simulator *senderModule;
+static E220Simulator *receiverModule;
+static LoRa_E220 *sender;
+static LoRa_E220 *receiver;
+
+static void configure(LoRa_E220 *e220, byte ADDL) {
+	Configuration configuration;
+	TEST_ASSERT_EQUAL(E220_SUCCESS, e220->getConfiguration(configuration).code);
+	configuration.ADDL = ADDL;
+	configuration.SPED.airDataRate = AIR_DATA_RATE_111_625;
+	configuration.OPTION.subPacketSetting = SPS_064_10;
+	configuration.TRANSMISSION_MODE.fixedTransmission = FT_FIXED_TRANSMISSION;
+	TEST_ASSERT_EQUAL(E220_SUCCESS, e220->setConfiguration(configuration, WRITE_CFG_PWR_DWN_LOSE).code);
+}
+
+void setUp(void) {
+	nativeHostReset();
+	senderPort = HardwareSerial();
+	receiverPort = HardwareSerial();
+	senderModule = new E220Simulator(senderPort, SENDER_AUX, SENDER_M0, SENDER_M1);
+	receiverModule = new E220Simulator(receiverPort, RECEIVER_AUX, RECEIVER_M0, RECEIVER_M1);
+	E220Simulator::link(*senderModule, *receiverModule);
+
+	sender = new LoRa_E220(&senderPort, SENDER_AUX, SENDER_M0, SENDER_M1, UART_BPS_RATE_9600);
+	receiver = new LoRa_E220(&receiverPort, RECEIVER_AUX, RECEIVER_M0, RECEIVER_M1, UART_BPS_RATE_9600);
+	TEST_ASSERT_TRUE(sender->begin());
+	TEST_ASSERT_TRUE(receiver->begin());
+	configure(sender, 0x01);
+	configure(receiver, 0x02);
+}
+
+void tearDown(void) {
+	delete sender;
+	delete receiver;
+	delete senderModule;
+	delete receiverModule;
+}
+
+/* the next frame received, split into messages of 4 bytes numbered by their first byte */
+static void receiveBatch(uint8_t expectedMessages, uint8_t firstNumber) {
+	uint8_t frame[MAX_SIZE_TX_PACKET];
+	uint16_t length = 0;
+	TEST_ASSERT_EQUAL(E220_SUCCESS, receiver->receiveFrame(frame, sizeof(frame), length, 1000).code);
+
+	LoRa_E220_BatchReader reader(frame, length);
+	TEST_ASSERT_TRUE(reader.isBatch());
+	const uint8_t *message;
+	uint8_t size;
+	uint8_t count = 0;
+	while (reader.next(message, size)) {
+		TEST_ASSERT_EQUAL(4, size);
+		TEST_ASSERT_EQUAL(firstNumber + count, message[0]);
+		TEST_ASSERT_EQUAL(0xA5, message[3]);
+		count++;
+	}
+	TEST_ASSERT_EQUAL(expectedMessages, count);
+}
+
+static void enqueueReading(LoRa_E220_BatchQueue &batch, byte ADDL, uint8_t number, Status expected = E220_SUCCESS) {
+	uint8_t reading[4] = { number, 0x00, 0x00, 0xA5 };
+	TEST_ASSERT_EQUAL(expected, batch.enqueue(0x00, ADDL, 23, reading, sizeof(reading)).code);
+}
+
+void test_packing_and_flush_on_size() {
+	LoRa_E220_BatchQueue batch(*sender, SPS_064_10, MAX_DELAY);
+	TEST_ASSERT_EQUAL(64, batch.getFrameCapacity());
+
+	// magic + 12 x (length + 4 bytes) = 61 bytes: the 13th does not fit
+	for (uint8_t i = 0; i < 12; i++) enqueueReading(batch, 0x02, i);
+	TEST_ASSERT_EQUAL(0, batch.getFramesSent());
+	TEST_ASSERT_EQUAL(12, batch.getPendingMessages());
+	TEST_ASSERT_EQUAL(0, senderModule->packetsSent);
+
+	enqueueReading(batch, 0x02, 12);
+	TEST_ASSERT_EQUAL(1, batch.getFramesSent());
+	TEST_ASSERT_EQUAL(12, batch.getMessagesSent());
+	TEST_ASSERT_EQUAL(1, batch.getPendingMessages());
+	TEST_ASSERT_EQUAL(1, senderModule->packetsSent);
+	receiveBatch(12, 0);
+
+	TEST_ASSERT_EQUAL(E220_SUCCESS, batch.flush().code);
+	TEST_ASSERT_EQUAL(2, batch.getFramesSent());
+	TEST_ASSERT_EQUAL(0, batch.getPendingMessages());
+	receiveBatch(1, 12);
+
+	// a message filling the frame leaves no room for another: sent at once
+	uint8_t large[62];
+	memset(large, 0x5A, sizeof(large));
+	TEST_ASSERT_EQUAL(E220_SUCCESS, batch.enqueue(0x00, 0x02, 23, large, sizeof(large)).code);
+	TEST_ASSERT_EQUAL(3, batch.getFramesSent());
+	TEST_ASSERT_EQUAL(ERR_E220_PACKET_TOO_BIG, batch.enqueue(0x00, 0x02, 23, large, sizeof(large) + 1).code);
+	TEST_ASSERT_EQUAL(0, batch.getPendingMessages());
+}
+
+void test_flush_on_age() {
+	LoRa_E220_BatchQueue batch(*sender, SPS_064_10, MAX_DELAY);
+	enqueueReading(batch, 0x02, 0);
+	nativeHostAdvance(MAX_DELAY * 1000UL / 2);
+	enqueueReading(batch, 0x02, 1);
+
+	TEST_ASSERT_EQUAL(E220_SUCCESS, batch.poll().code);
+	TEST_ASSERT_EQUAL(0, batch.getFramesSent());
+
+	// the age counts from the first message of the frame
+	nativeHostAdvance(MAX_DELAY * 1000UL / 2);
+	TEST_ASSERT_EQUAL(E220_SUCCESS, batch.poll().code);
+	TEST_ASSERT_EQUAL(1, batch.getFramesSent());
+	TEST_ASSERT_EQUAL(2, batch.getMessagesSent());
+	receiveBatch(2, 0);
+}
+
+void test_destinations_and_eviction() {
+	LoRa_E220_BatchQueue batch(*sender, SPS_064_10, MAX_DELAY);
+	enqueueReading(batch, 0x02, 0);
+	nativeHostAdvance(1000);
+	enqueueReading(batch, 0x03, 5);
+	enqueueReading(batch, 0x02, 1);
+	TEST_ASSERT_EQUAL(3, batch.getPendingMessages());
+
+	// a third destination takes the slot of the oldest frame, sent to 0x02
+	enqueueReading(batch, 0x04, 3);
+	TEST_ASSERT_EQUAL(1, batch.getFramesSent());
+	TEST_ASSERT_EQUAL(2, batch.getMessagesSent());
+	receiveBatch(2, 0);
+
+	TEST_ASSERT_EQUAL(E220_SUCCESS, batch.flush(0x00, 0x03, 23).code);
+	TEST_ASSERT_EQUAL(2, batch.getFramesSent());
+	TEST_ASSERT_EQUAL(1, batch.getPendingMessages());
+	// nothing pending for this destination
+	TEST_ASSERT_EQUAL(E220_SUCCESS, batch.flush(0x00, 0x03, 23).code);
+	TEST_ASSERT_EQUAL(2, batch.getFramesSent());
+}
+
+void test_reader_malformed_frames() {
+	const uint8_t *message;
+	uint8_t size;
+
+	// the second message claims 5 bytes, 1 is left
+	const uint8_t truncated[] = { E220_BATCH_MAGIC, 3, 'a', 'b', 'c', 5, 'x' };
+	LoRa_E220_BatchReader reader(truncated, sizeof(truncated));
+	TEST_ASSERT_TRUE(reader.next(message, size));
+	TEST_ASSERT_EQUAL(3, size);
+	TEST_ASSERT_EQUAL_MEMORY("abc", message, 3);
+	TEST_ASSERT_FALSE(reader.next(message, size));
+	TEST_ASSERT_FALSE(reader.next(message, size));
+
+	const uint8_t other[] = { 0x01, 3, 'a', 'b', 'c' };
+	LoRa_E220_BatchReader notBatch(other, sizeof(other));
+	TEST_ASSERT_FALSE(notBatch.isBatch());
+	TEST_ASSERT_FALSE(notBatch.next(message, size));
+
+	LoRa_E220_BatchReader empty(truncated, 0);
+	TEST_ASSERT_FALSE(empty.isBatch());
+	TEST_ASSERT_FALSE(empty.next(message, size));
+
+	// an empty message is valid
+	const uint8_t zero[] = { E220_BATCH_MAGIC, 0 };
+	LoRa_E220_BatchReader zeroReader(zero, sizeof(zero));
+	TEST_ASSERT_TRUE(zeroReader.next(message, size));
+	TEST_ASSERT_EQUAL(0, size);
+	TEST_ASSERT_FALSE(zeroReader.next(message, size));
+}
+
+void test_failed_frames_retried_or_dropped() {
+	// no module: AUX stuck LOW makes every send time out
+	HardwareSerial port;
+	LoRa_E220 stuck(&port, STUCK_AUX, UART_BPS_RATE_9600);
+	nativeSetPinLevel(STUCK_AUX, HIGH);
+	TEST_ASSERT_TRUE(stuck.begin());
+	nativeSetPinLevel(STUCK_AUX, LOW);
+
+	LoRa_E220_BatchQueue batch(stuck, SPS_064_10, MAX_DELAY);
+	enqueueReading(batch, 0x02, 0);
+	TEST_ASSERT_EQUAL(ERR_E220_TIMEOUT, batch.flush().code);
+	TEST_ASSERT_EQUAL(0, batch.getFramesSent());
+	TEST_ASSERT_EQUAL(0, batch.getMessagesSent());
+	TEST_ASSERT_EQUAL(1, batch.getPendingMessages());
+
+	// kept: retried once the radio is back
+	nativeSetPinLevel(STUCK_AUX, HIGH);
+	TEST_ASSERT_EQUAL(E220_SUCCESS, batch.poll().code);
+	TEST_ASSERT_EQUAL(1, batch.getFramesSent());
+	TEST_ASSERT_EQUAL(1, batch.getMessagesSent());
+	TEST_ASSERT_EQUAL(0, batch.getFramesDropped());
+
+	// a full frame that failed is given up when the next message needs its slot
+	nativeSetPinLevel(STUCK_AUX, LOW);
+	for (uint8_t i = 0; i < 12; i++) enqueueReading(batch, 0x02, i);
+	enqueueReading(batch, 0x02, 12, ERR_E220_TIMEOUT);
+	TEST_ASSERT_EQUAL(1, batch.getFramesDropped());
+	TEST_ASSERT_EQUAL(12, batch.getMessagesDropped());
+	TEST_ASSERT_EQUAL(1, batch.getPendingMessages());
+	TEST_ASSERT_EQUAL(1, batch.getFramesSent());
+}
+
+int main(int argc, char **argv) {
+	UNITY_BEGIN();
+
+	RUN_TEST(test_packing_and_flush_on_size);
+	RUN_TEST(test_flush_on_age);
+	RUN_TEST(test_destinations_and_eviction);
+	RUN_TEST(test_reader_malformed_frames);
+	RUN_TEST(test_failed_frames_retried_or_dropped);
+
+	return UNITY_END();
+}
@@ -0,0 +1,232 @@
+/**
+ * Fragmentation and reassembly: a payload split by LoRa_E220_Fragmenter and
+ * rebuilt through two simulated modules, then LoRa_E220_Reassembler fed by
+ * hand with out of order, duplicate, missing, stale and excess fragments.
+ */
+#include <unity.h>
+#include <stdio.h>
+
+#include "LoRa_E220.h"
+#include "LoRa_E220_Fragment.h"
+#include "E220Simulator.h"
+
+#define SENDER_AUX 4
+#define SENDER_M0 5
+#define SENDER_M1 6
+#define RECEIVER_AUX 7
+#define RECEIVER_M0 8
+#define RECEIVER_M1 9
+
+#define FRAGMENT_SIZE 10
+#define TIMEOUT 2000
+
+static uint8_t storage[512];
+
+void setUp(void) {
+	nativeHostReset();
+}
+
+void tearDown(void) {
+}
+
+/* fragment index of a payload of count fragments, data byte i = (index * FRAGMENT_SIZE + i) ^ id */
+static uint16_t buildFragment(uint8_t *frame, uint8_t ADDL, uint8_t id, uint8_t index, uint8_t count, uint8_t lastSize = FRAGMENT_SIZE) {
+	uint8_t length = (index + 1 == count) ? lastSize : FRAGMENT_SIZE;
+	frame[0] = E220_FRAGMENT_MAGIC;
+	frame[1] = 0x00;
+	frame[2] = ADDL;
+	frame[3] = id;
+	frame[4] = index;
+	frame[5] = count;
+	frame[6] = FRAGMENT_SIZE;
+	for (uint8_t i = 0; i < length; i++) {
+		frame[E220_FRAGMENT_HEADER_SIZE + i] = (uint8_t)((index * FRAGMENT_SIZE + i) ^ id);
+	}
+	return E220_FRAGMENT_HEADER_SIZE + length;
+}
+
+static Status pushFragment(LoRa_E220_Reassembler &reassembler, uint8_t ADDL, uint8_t id, uint8_t index, uint8_t count, uint8_t lastSize = FRAGMENT_SIZE) {
+	uint8_t frame[E220_FRAGMENT_HEADER_SIZE + FRAGMENT_SIZE];
+	uint16_t length = buildFragment(frame, ADDL, id, index, count, lastSize);
+	return reassembler.push(frame, length);
+}
+
+static void checkMessage(LoRa_E220_Reassembler &reassembler, uint8_t ADDL, uint8_t id, uint16_t expectedSize) {
+	const uint8_t *message;
+	uint16_t size, origin;
+	TEST_ASSERT_TRUE(reassembler.getMessage(message, size, origin));
+	TEST_ASSERT_EQUAL(expectedSize, size);
+	TEST_ASSERT_EQUAL_HEX16(ADDL, origin);
+	for (uint16_t i = 0; i < size; i++) {
+		TEST_ASSERT_EQUAL_HEX8((uint8_t)(i ^ id), message[i]);
+	}
+}
+
+void test_fragmenter_round_trip(void) {
+	HardwareSerial senderPort;
+	HardwareSerial receiverPort;
+	E220Simulator senderModule(senderPort, SENDER_AUX, SENDER_M0, SENDER_M1);
+	E220Simulator receiverModule(receiverPort, RECEIVER_AUX, RECEIVER_M0, RECEIVER_M1);
+	E220Simulator::link(senderModule, receiverModule);
+
+	LoRa_E220 sender(&senderPort, SENDER_AUX, SENDER_M0, SENDER_M1, UART_BPS_RATE_9600);
+	LoRa_E220 receiver(&receiverPort, RECEIVER_AUX, RECEIVER_M0, RECEIVER_M1, UART_BPS_RATE_9600);
+	TEST_ASSERT_TRUE(sender.begin());
+	TEST_ASSERT_TRUE(receiver.begin());
+
+	LoRa_E220 *devices[] = { &sender, &receiver };
+	for (uint8_t i = 0; i < 2; i++) {
+		Configuration configuration;
+		TEST_ASSERT_EQUAL(E220_SUCCESS, devices[i]->getConfiguration(configuration).code);
+		configuration.ADDL = i + 1;
+		configuration.SPED.airDataRate = AIR_DATA_RATE_111_625;
+		configuration.OPTION.subPacketSetting = SPS_064_10;
+		configuration.TRANSMISSION_MODE.fixedTransmission = FT_FIXED_TRANSMISSION;
+		TEST_ASSERT_EQUAL(E220_SUCCESS, devices[i]->setConfiguration(configuration, WRITE_CFG_PWR_DWN_LOSE).code);
+	}
+
+	LoRa_E220_Fragmenter fragmenter(sender, 0x00, 0x01, SPS_064_10);
+	TEST_ASSERT_EQUAL(64 - E220_FRAGMENT_HEADER_SIZE, fragmenter.getFragmentSize());
+
+	uint8_t blob[300];
+	for (uint16_t i = 0; i < sizeof(blob); i++) blob[i] = (uint8_t)(i * 7);
+	TEST_ASSERT_EQUAL(E220_SUCCESS, fragmenter.send(0x00, 0x02, 23, blob, sizeof(blob)).code);
+
+	/* the fragments were all received meanwhile, back to back: split them by their header */
+	delay(1000);
+	static uint8_t received[sizeof(blob) + 8 * E220_FRAGMENT_HEADER_SIZE];
+	uint16_t receivedLength = 0;
+	while (receiverPort.available() && receivedLength < sizeof(received)) {
+		received[receivedLength++] = receiverPort.read();
+	}
+
+	LoRa_E220_Reassembler reassembler(storage, sizeof(storage), 1, TIMEOUT);
+	uint8_t expectedFragments = (sizeof(blob) + fragmenter.getFragmentSize() - 1) / fragmenter.getFragmentSize();
+	uint16_t position = 0;
+	for (uint8_t i = 0; i < expectedFragments; i++) {
+		uint16_t length = E220_FRAGMENT_HEADER_SIZE + (i + 1 < expectedFragments ? fragmenter.getFragmentSize() : sizeof(blob) - i * fragmenter.getFragmentSize());
+		TEST_ASSERT_TRUE(position + length <= receivedLength);
+		TEST_ASSERT_EQUAL(i + 1 < expectedFragments ? ERR_E220_BUSY : E220_SUCCESS, reassembler.push(received + position, length));
+		position += length;
+	}
+	TEST_ASSERT_EQUAL(receivedLength, position);
+
+	const uint8_t *message;
+	uint16_t size, origin;
+	TEST_ASSERT_TRUE(reassembler.getMessage(message, size, origin));
+	TEST_ASSERT_EQUAL(sizeof(blob), size);
+	TEST_ASSERT_EQUAL_HEX16(0x0001, origin);
+	TEST_ASSERT_EQUAL_HEX8_ARRAY(blob, message, sizeof(blob));
+
+	// too many fragments for the header
+	static uint8_t huge[256 * 57];
+	TEST_ASSERT_EQUAL(ERR_E220_PACKET_TOO_BIG, fragmenter.send(0x00, 0x02, 23, huge, sizeof(huge)).code);
+}
+
+void test_out_of_order_and_duplicates(void) {
+	LoRa_E220_Reassembler reassembler(storage, sizeof(storage), 1, TIMEOUT);
+
+	TEST_ASSERT_EQUAL(ERR_E220_BUSY, pushFragment(reassembler, 0x01, 7, 3, 4, 4));
+	TEST_ASSERT_EQUAL(ERR_E220_BUSY, pushFragment(reassembler, 0x01, 7, 1, 4));
+	// a repeated fragment does not count twice
+	TEST_ASSERT_EQUAL(ERR_E220_BUSY, pushFragment(reassembler, 0x01, 7, 1, 4));
+	TEST_ASSERT_EQUAL(ERR_E220_BUSY, pushFragment(reassembler, 0x01, 7, 3, 4, 4));
+	TEST_ASSERT_EQUAL(ERR_E220_BUSY, pushFragment(reassembler, 0x01, 7, 0, 4));
+
+	const uint8_t *message;
+	uint16_t size, origin;
+	TEST_ASSERT_FALSE(reassembler.getMessage(message, size, origin));
+
+	TEST_ASSERT_EQUAL(E220_SUCCESS, pushFragment(reassembler, 0x01, 7, 2, 4));
+	checkMessage(reassembler, 0x01, 7, 3 * FRAGMENT_SIZE + 4);
+
+	// the completed payload is released by the next push, a late duplicate starts a new one
+	TEST_ASSERT_EQUAL(ERR_E220_BUSY, pushFragment(reassembler, 0x01, 7, 2, 4));
+	TEST_ASSERT_FALSE(reassembler.getMessage(message, size, origin));
+	TEST_ASSERT_EQUAL(0, reassembler.getDropped());
+}
+
+void test_missing_fragment_and_expiry(void) {
+	LoRa_E220_Reassembler reassembler(storage, sizeof(storage), 1, TIMEOUT);
+
+	// fragment 1 never arrives
+	TEST_ASSERT_EQUAL(ERR_E220_BUSY, pushFragment(reassembler, 0x01, 1, 0, 3));
+	TEST_ASSERT_EQUAL(ERR_E220_BUSY, pushFragment(reassembler, 0x01, 1, 2, 3));
+
+	// each fragment restarts the timeout
+	delay(TIMEOUT - 100);
+	reassembler.poll();
+	TEST_ASSERT_EQUAL(0, reassembler.getDropped());
+
+	delay(200);
+	reassembler.poll();
+	TEST_ASSERT_EQUAL(1, reassembler.getDropped());
+
+	// the late fragment alone cannot complete the payload
+	TEST_ASSERT_EQUAL(ERR_E220_BUSY, pushFragment(reassembler, 0x01, 1, 1, 3));
+
+	// the sender moving on to another payload drops the partial one
+	TEST_ASSERT_EQUAL(ERR_E220_BUSY, pushFragment(reassembler, 0x01, 2, 0, 2));
+	TEST_ASSERT_EQUAL(2, reassembler.getDropped());
+	TEST_ASSERT_EQUAL(E220_SUCCESS, pushFragment(reassembler, 0x01, 2, 1, 2, 1));
+	checkMessage(reassembler, 0x01, 2, FRAGMENT_SIZE + 1);
+}
+
+void test_slot_exhaustion(void) {
+	LoRa_E220_Reassembler reassembler(storage, sizeof(storage), 2, TIMEOUT);
+
+	TEST_ASSERT_EQUAL(ERR_E220_BUSY, pushFragment(reassembler, 0x01, 1, 0, 2));
+	TEST_ASSERT_EQUAL(ERR_E220_BUSY, pushFragment(reassembler, 0x02, 1, 0, 2));
+
+	// a third sender finds no free slot: its fragment is dropped
+	TEST_ASSERT_EQUAL(ERR_E220_BUF_TOO_SMALL, pushFragment(reassembler, 0x03, 1, 0, 2));
+	TEST_ASSERT_EQUAL(ERR_E220_BUF_TOO_SMALL, pushFragment(reassembler, 0x03, 1, 1, 2));
+
+	// the senders being reassembled are not disturbed
+	TEST_ASSERT_EQUAL(E220_SUCCESS, pushFragment(reassembler, 0x02, 1, 1, 2));
+	checkMessage(reassembler, 0x02, 1, 2 * FRAGMENT_SIZE);
+	TEST_ASSERT_EQUAL(E220_SUCCESS, pushFragment(reassembler, 0x01, 1, 1, 2));
+	checkMessage(reassembler, 0x01, 1, 2 * FRAGMENT_SIZE);
+
+	// a slot freed by the timeout is reused
+	TEST_ASSERT_EQUAL(ERR_E220_BUSY, pushFragment(reassembler, 0x01, 2, 0, 2));
+	TEST_ASSERT_EQUAL(ERR_E220_BUSY, pushFragment(reassembler, 0x02, 2, 0, 2));
+	delay(TIMEOUT + 1);
+	TEST_ASSERT_EQUAL(ERR_E220_BUSY, pushFragment(reassembler, 0x03, 2, 0, 2));
+	TEST_ASSERT_EQUAL(2, reassembler.getDropped());
+	TEST_ASSERT_EQUAL(E220_SUCCESS, pushFragment(reassembler, 0x03, 2, 1, 2, 3));
+	checkMessage(reassembler, 0x03, 2, FRAGMENT_SIZE + 3);
+}
+
+void test_malformed_and_oversized(void) {
+	// two slots of 30 bytes: 3 fragments each
+	LoRa_E220_Reassembler reassembler(storage, 60, 2, TIMEOUT);
+	uint8_t frame[E220_FRAGMENT_HEADER_SIZE + FRAGMENT_SIZE];
+
+	uint16_t length = buildFragment(frame, 0x01, 1, 0, 2);
+	TEST_ASSERT_EQUAL(ERR_E220_WRONG_FORMAT, reassembler.push(frame, E220_FRAGMENT_HEADER_SIZE - 1));
+	frame[0] = 0x00;
+	TEST_ASSERT_EQUAL(ERR_E220_WRONG_FORMAT, reassembler.push(frame, length));
+
+	// index beyond count, and a short fragment that is not the last one
+	length = buildFragment(frame, 0x01, 1, 2, 2);
+	TEST_ASSERT_EQUAL(ERR_E220_WRONG_FORMAT, reassembler.push(frame, length));
+	length = buildFragment(frame, 0x01, 1, 0, 2);
+	TEST_ASSERT_EQUAL(ERR_E220_WRONG_FORMAT, reassembler.push(frame, length - 1));
+
+	TEST_ASSERT_EQUAL(ERR_E220_PACKET_TOO_BIG, pushFragment(reassembler, 0x01, 1, 3, 4));
+	TEST_ASSERT_EQUAL(E220_SUCCESS, pushFragment(reassembler, 0x01, 1, 0, 1));
+	checkMessage(reassembler, 0x01, 1, FRAGMENT_SIZE);
+}
+
+int main(int argc, char **argv) {
+	UNITY_BEGIN();
+
+	RUN_TEST(test_fragmenter_round_trip);
+	RUN_TEST(test_out_of_order_and_duplicates);
+	RUN_TEST(test_missing_fragment_and_expiry);
+	RUN_TEST(test_slot_exhaustion);
+	RUN_TEST(test_malformed_and_oversized);
+
+	return UNITY_END();
+}
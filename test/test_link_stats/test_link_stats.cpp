@@ -0,0 +1,107 @@
+/**
+ * Per-source RSSI statistics: running mean and variance, sequence gaps,
+ * replacement when the table is full, ranking, and no heap use per packet.
+ */
+#include <unity.h>
+#include <stdio.h>
+
+#include "LoRa_E220_LinkStats.h"
+#include "NativeHeapCounter.h"
+
+#define NODES 500
+#define TABLE_SIZE 512
+
+static LinkStatsEntry table[TABLE_SIZE];
+
+void setUp(void) {
+	nativeHostReset();
+}
+
+void tearDown(void) {
+}
+
+void test_running_statistics() {
+	LoRa_E220_LinkStats linkStats(table, TABLE_SIZE);
+
+	// -90 dBm then a steady -60 dBm: the mean converges, the extremes stay
+	linkStats.update(0x00, 0x10, 166, 0);
+	const LinkStatsEntry *entry = NULL;
+	for (uint8_t i = 1; i <= 60; i++) entry = linkStats.update(0x00, 0x10, 196, i);
+	TEST_ASSERT_EQUAL(-60, entry->getMeanDbm());
+	TEST_ASSERT_EQUAL(166, entry->minRSSI);
+	TEST_ASSERT_EQUAL(196, entry->maxRSSI);
+	TEST_ASSERT_LESS_THAN(2, entry->getVariance());
+	TEST_ASSERT_EQUAL(1, entry->histogram[(166 - E220_LINK_STATS_HISTOGRAM_MIN) / E220_LINK_STATS_BIN_WIDTH]);
+	TEST_ASSERT_EQUAL(60, entry->histogram[(196 - E220_LINK_STATS_HISTOGRAM_MIN) / E220_LINK_STATS_BIN_WIDTH]);
+
+	// alternating 10 dB apart: variance near 25
+	for (uint8_t i = 61; i <= 160; i++) linkStats.update(0x00, 0x10, (i & 1) ? 190 : 200, i);
+	TEST_ASSERT_UINT32_WITHIN(6, 25, entry->getVariance());
+	TEST_ASSERT_UINT32_WITHIN(2, 195, (entry->mean + 128) >> 8);
+	TEST_ASSERT_EQUAL(0, entry->lost);
+}
+
+void test_sequence_gaps() {
+	LoRa_E220_LinkStats linkStats(table, TABLE_SIZE);
+
+	linkStats.update(0x00, 0x20, 200, 250);
+	linkStats.update(0x00, 0x20, 200, 251);
+	linkStats.update(0x00, 0x20, 200, 254);   // 252, 253 lost
+	linkStats.update(0x00, 0x20, 200, 254);   // repeated
+	const LinkStatsEntry *entry = linkStats.update(0x00, 0x20, 200, 1); // wraps, 255 and 0 lost
+	TEST_ASSERT_EQUAL(4, entry->received);
+	TEST_ASSERT_EQUAL(4, entry->lost);
+	TEST_ASSERT_EQUAL(50, entry->getLossPercent());
+
+	// a jump back is a restart, not 200 lost packets
+	entry = linkStats.update(0x00, 0x20, 200, 0);
+	TEST_ASSERT_EQUAL(4, entry->lost);
+	TEST_ASSERT_EQUAL(entry, linkStats.find(0x00, 0x20));
+	TEST_ASSERT_NULL(linkStats.find(0x00, 0x21));
+}
+
+void test_gateway_table() {
+	LoRa_E220_LinkStats linkStats(table, TABLE_SIZE);
+
+	// 500 nodes, node n at -(30 + n % 90) dBm; 50 packets each
+	nativeHeapTrack();
+	for (uint8_t round = 0; round < 50; round++) {
+		for (uint16_t node = 0; node < NODES; node++) {
+			linkStats.update(node >> 8, node & 0xFF, 256 - 30 - node % 90, round);
+		}
+	}
+	unsigned long allocations = nativeHeapUntrack();
+	TEST_ASSERT_EQUAL(0, allocations);
+	TEST_ASSERT_EQUAL(NODES, linkStats.getSources());
+	TEST_ASSERT_EQUAL(0, linkStats.getEvictions());
+
+	const LinkStatsEntry *weakest[5];
+	TEST_ASSERT_EQUAL(5, linkStats.getWeakest(weakest, 5));
+	for (uint8_t i = 0; i < 5; i++) {
+		TEST_ASSERT_EQUAL(-119, weakest[i]->getMeanDbm());
+		TEST_ASSERT_EQUAL(89, weakest[i]->address % 90);
+	}
+
+	// a table too small keeps the most recent sources
+	LinkStatsEntry small[16];
+	LoRa_E220_LinkStats recent(small, 16);
+	for (uint16_t node = 0; node < 40; node++) {
+		recent.update(0x00, node, 200);
+		nativeHostAdvance(1000);
+	}
+	TEST_ASSERT_EQUAL(16, recent.getSources());
+	TEST_ASSERT_EQUAL(24, recent.getEvictions());
+	TEST_ASSERT_NOT_NULL(recent.find(0x00, 39));
+	printf("[stats] %u bytes per entry, %u sources in a %u entry table\n",
+			(unsigned)sizeof(LinkStatsEntry), (unsigned)linkStats.getSources(), (unsigned)TABLE_SIZE);
+}
+
+int main(int argc, char **argv) {
+	UNITY_BEGIN();
+
+	RUN_TEST(test_running_statistics);
+	RUN_TEST(test_sequence_gaps);
+	RUN_TEST(test_gateway_table);
+
+	return UNITY_END();
+}
@@ -0,0 +1,101 @@
+/**
+ * Latency instrumentation: the phase statistics and, in the native_profile
+ * environment (LoRa_E220_PROFILE defined), the phases recorded by a real
+ * LoRa_E220 against the simulated module.
+ */
+#include <unity.h>
+#include <stdio.h>
+
+#include "LoRa_E220.h"
+#include "E220Simulator.h"
+
+#define MODULE_AUX 4
+#define MODULE_M0 5
+#define MODULE_M1 6
+
+void setUp(void) {
+	nativeHostReset();
+}
+
+void tearDown(void) {
+}
+
+void test_phase_statistics() {
+	ProfileStats stats;
+	stats.clear();
+	PhaseStats &phase = stats.phases[PROFILE_UART_WRITE];
+
+	phase.record(1);
+	phase.record(3);
+	phase.record(1000);
+	phase.record(0xFFFFFFFFUL);
+	TEST_ASSERT_EQUAL(4, phase.count);
+	TEST_ASSERT_EQUAL(1, phase.min);
+	TEST_ASSERT_EQUAL_UINT32(0xFFFFFFFFUL, phase.max);
+	TEST_ASSERT_TRUE(phase.sum > 0xFFFFFFFFULL);
+	TEST_ASSERT_EQUAL_UINT32((1 + 3 + 1000 + 0xFFFFFFFFULL) / 4, phase.getMean());
+
+	// log2 buckets: 1 in 0, 3 in 1, 1000 in 9, the longest in the last one
+	TEST_ASSERT_EQUAL(1, phase.histogram[0]);
+	TEST_ASSERT_EQUAL(1, phase.histogram[1]);
+	TEST_ASSERT_EQUAL(1, phase.histogram[9]);
+	TEST_ASSERT_EQUAL(1, phase.histogram[E220_PROFILE_BUCKETS - 1]);
+
+	stats.clear();
+	TEST_ASSERT_EQUAL(0, phase.count);
+	TEST_ASSERT_EQUAL(0, phase.getMean());
+}
+
+#ifdef LoRa_E220_PROFILE
+void test_operation_phases() {
+	HardwareSerial port;
+	E220Simulator module(port, MODULE_AUX, MODULE_M0, MODULE_M1);
+	LoRa_E220 e220(&port, MODULE_AUX, MODULE_M0, MODULE_M1, UART_BPS_RATE_9600);
+	TEST_ASSERT_TRUE(e220.begin());
+
+	e220.resetProfile();
+	Configuration configuration;
+	TEST_ASSERT_EQUAL(E220_SUCCESS, e220.getConfiguration(configuration).code);
+
+	const ProfileStats &profile = e220.getProfile();
+	// to program mode and back
+	TEST_ASSERT_EQUAL(2, profile.phases[PROFILE_MODE_SWITCH].count);
+	TEST_ASSERT_EQUAL(1, profile.phases[PROFILE_PROGRAM_COMMAND].count);
+	TEST_ASSERT_EQUAL(1, profile.phases[PROFILE_RECEIVE].count);
+	TEST_ASSERT_EQUAL(1, profile.phases[PROFILE_UART_READ].count);
+	// the guards of the two switches (2 ms) and of the answer (20 ms), on millis()
+	TEST_ASSERT_EQUAL(3, profile.phases[PROFILE_GUARD_DELAY].count);
+	TEST_ASSERT_TRUE(profile.phases[PROFILE_GUARD_DELAY].min >= 1000);
+	TEST_ASSERT_TRUE(profile.phases[PROFILE_MODE_SWITCH].min > profile.phases[PROFILE_GUARD_DELAY].min);
+	TEST_ASSERT_EQUAL(0, profile.phases[PROFILE_SEND].count);
+
+	e220.resetProfile();
+	uint8_t payload[20] = { 0 };
+	TEST_ASSERT_EQUAL(E220_SUCCESS, e220.sendMessage(payload, sizeof(payload)).code);
+	const PhaseStats &send = profile.phases[PROFILE_SEND];
+	TEST_ASSERT_EQUAL(1, send.count);
+	TEST_ASSERT_EQUAL(1, profile.phases[PROFILE_UART_WRITE].count);
+	TEST_ASSERT_EQUAL(1, profile.phases[PROFILE_AUX_BUSY].count);
+	// the send contains the wait on AUX, which contains the time on air
+	TEST_ASSERT_TRUE(send.max >= profile.phases[PROFILE_AUX_BUSY].max + profile.phases[PROFILE_GUARD_DELAY].max);
+
+	const char *names[PROFILE_PHASES] = { "UART write", "UART read", "AUX busy", "guard delay",
+			"mode switch", "program command", "send", "receive" };
+	TEST_ASSERT_EQUAL(E220_SUCCESS, e220.getConfiguration(configuration).code);
+	for (uint8_t i = 0; i < PROFILE_PHASES; i++) {
+		printf("[bench] %-16s count %lu  min %lu  mean %lu  max %lu us\n", names[i],
+				profile.phases[i].count, profile.phases[i].min, profile.phases[i].getMean(), profile.phases[i].max);
+	}
+}
+#endif
+
+int main(int argc, char **argv) {
+	UNITY_BEGIN();
+
+	RUN_TEST(test_phase_statistics);
+#ifdef LoRa_E220_PROFILE
+	RUN_TEST(test_operation_phases);
+#endif
+
+	return UNITY_END();
+}
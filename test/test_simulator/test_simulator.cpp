@@ -0,0 +1,772 @@
+/**
+ * The real LoRa_E220 class against two simulated modules in radio range:
+ * register protocol, addressing, RSSI, sub packet timing and end-to-end
+ * latency on the virtual clock.
+ */
+#include <unity.h>
+#include <stdio.h>
+
+#include "LoRa_E220.h"
+#include "LoRa_E220_Config.h"
+#include "LoRa_E220_RemoteConfig.h"
+#include "LoRa_E220_Noise.h"
+#include "LoRa_E220_Scan.h"
+#include "E220Simulator.h"
+
+#define SENDER_AUX 4
+#define SENDER_M0 5
+#define SENDER_M1 6
+#define RECEIVER_AUX 7
+#define RECEIVER_M0 8
+#define RECEIVER_M1 9
+
+static HardwareSerial senderPort;
+static HardwareSerial receiverPort;
+static E220Simulator *senderModule;
+static E220Simulator *receiverModule;
+static LoRa_E220 *sender;
+static LoRa_E220 *receiver;
+
+void setUp(void) {
+	nativeHostReset();
+	senderPort = HardwareSerial();
+	receiverPort = HardwareSerial();
+	senderModule = new E220Simulator(senderPort, SENDER_AUX, SENDER_M0, SENDER_M1);
+	receiverModule = new E220Simulator(receiverPort, RECEIVER_AUX, RECEIVER_M0, RECEIVER_M1);
+	E220Simulator::link(*senderModule, *receiverModule);
+
+	sender = new LoRa_E220(&senderPort, SENDER_AUX, SENDER_M0, SENDER_M1, UART_BPS_RATE_9600);
+	receiver = new LoRa_E220(&receiverPort, RECEIVER_AUX, RECEIVER_M0, RECEIVER_M1, UART_BPS_RATE_9600);
+	TEST_ASSERT_TRUE(sender->begin());
+	TEST_ASSERT_TRUE(receiver->begin());
+}
+
+void tearDown(void) {
+	delete sender;
+	delete receiver;
+	delete senderModule;
+	delete receiverModule;
+}
+
+static void configure(LoRa_E220 *e220, byte ADDL, AIR_DATA_RATE airDataRate, SUB_PACKET_SETTING subPacketSetting, bool rssi) {
+	Configuration configuration;
+	TEST_ASSERT_EQUAL(E220_SUCCESS, e220->getConfiguration(configuration).code);
+	configuration.ADDL = ADDL;
+	configuration.CHAN = 23;
+	configuration.SPED.airDataRate = airDataRate;
+	configuration.OPTION.subPacketSetting = subPacketSetting;
+	configuration.TRANSMISSION_MODE.fixedTransmission = FT_FIXED_TRANSMISSION;
+	configuration.TRANSMISSION_MODE.enableRSSI = rssi ? RSSI_ENABLED : RSSI_DISABLED;
+	TEST_ASSERT_EQUAL(E220_SUCCESS, e220->setConfiguration(configuration, WRITE_CFG_PWR_DWN_LOSE).code);
+}
+
+void test_register_protocol() {
+	Configuration configuration;
+	TEST_ASSERT_EQUAL(E220_SUCCESS, sender->getConfiguration(configuration).code);
+	TEST_ASSERT_EQUAL(0x17, configuration.CHAN);
+	TEST_ASSERT_EQUAL(UART_BPS_9600, configuration.SPED.uartBaudRate);
+
+	configuration.ADDL = 0x42;
+	configuration.CRYPT.CRYPT_H = 0x12;
+	TEST_ASSERT_EQUAL(E220_SUCCESS, sender->setConfiguration(configuration, WRITE_CFG_PWR_DWN_LOSE).code);
+	TEST_ASSERT_EQUAL(0x42, senderModule->registers[1]);
+	TEST_ASSERT_EQUAL(0x00, senderModule->saved[1]);
+	TEST_ASSERT_EQUAL(0x12, senderModule->registers[6]);
+
+	// CRYPT is write only
+	TEST_ASSERT_EQUAL(E220_SUCCESS, sender->getConfiguration(configuration).code);
+	TEST_ASSERT_EQUAL(0x42, configuration.ADDL);
+	TEST_ASSERT_EQUAL(0x00, configuration.CRYPT.CRYPT_H);
+
+	// temporary settings are lost on power cycle, saved ones are not
+	senderModule->powerCycle();
+	TEST_ASSERT_EQUAL(E220_SUCCESS, sender->getConfiguration(configuration).code);
+	TEST_ASSERT_EQUAL(0x00, configuration.ADDL);
+	configuration.ADDL = 0x43;
+	TEST_ASSERT_EQUAL(E220_SUCCESS, sender->setConfiguration(configuration, WRITE_CFG_PWR_DWN_SAVE).code);
+	senderModule->powerCycle();
+	TEST_ASSERT_EQUAL(E220_SUCCESS, sender->getConfiguration(configuration).code);
+	TEST_ASSERT_EQUAL(0x43, configuration.ADDL);
+
+	ModuleInformation information;
+	TEST_ASSERT_EQUAL(E220_SUCCESS, sender->getModuleInformation(information).code);
+	TEST_ASSERT_EQUAL(0x20, information.model);
+	TEST_ASSERT_EQUAL(MODE_0_NORMAL, senderModule->getMode());
+}
+
+void test_mode_switch_on_aux() {
+	// AUX rising edge plus the 2 ms guard, not fixed delays
+	unsigned long long start = nativeHostNow();
+	TEST_ASSERT_EQUAL(E220_SUCCESS, sender->setMode(MODE_2_WOR_RECEIVER));
+	TEST_ASSERT_EQUAL(MODE_2_WOR_RECEIVER, senderModule->getMode());
+	TEST_ASSERT_LESS_THAN(senderModule->modeSwitchMicros + 3000, nativeHostNow() - start);
+
+	senderModule->modeSwitchMicros = 7000;
+	unsigned long measured = sender->calibrateModeSwitch();
+	TEST_ASSERT_UINT32_WITHIN(100, 7000, measured);
+	TEST_ASSERT_EQUAL(measured, sender->getModeSwitchMicros());
+	TEST_ASSERT_EQUAL(MODE_2_WOR_RECEIVER, sender->getMode());
+	TEST_ASSERT_EQUAL(MODE_2_WOR_RECEIVER, senderModule->getMode());
+
+	// without AUX the measured time replaces the fixed delay
+	LoRa_E220 noAux(&senderPort, -1, SENDER_M0, SENDER_M1, UART_BPS_RATE_9600);
+	start = nativeHostNow();
+	TEST_ASSERT_EQUAL(E220_SUCCESS, noAux.setMode(MODE_0_NORMAL));
+	TEST_ASSERT_GREATER_OR_EQUAL(200000, nativeHostNow() - start);
+	noAux.setModeSwitchMicros(measured);
+	start = nativeHostNow();
+	TEST_ASSERT_EQUAL(E220_SUCCESS, noAux.setMode(MODE_2_WOR_RECEIVER));
+	TEST_ASSERT_LESS_THAN(60000, nativeHostNow() - start);
+}
+
+void test_config_session() {
+	ModuleInformation information;
+	Configuration configuration;
+
+	unsigned long entries = senderModule->programModeEntries;
+	TEST_ASSERT_EQUAL(E220_SUCCESS, sender->getModuleInformation(information).code);
+	TEST_ASSERT_EQUAL(E220_SUCCESS, sender->getConfiguration(configuration).code);
+	TEST_ASSERT_EQUAL(E220_SUCCESS, sender->setConfiguration(configuration).code);
+	TEST_ASSERT_EQUAL(entries + 3, senderModule->programModeEntries);
+
+	entries = senderModule->programModeEntries;
+	{
+		LoRa_E220_ConfigSession session(*sender);
+		TEST_ASSERT_EQUAL(E220_SUCCESS, session.getStatus());
+		TEST_ASSERT_TRUE(sender->isProgramMode());
+
+		TEST_ASSERT_EQUAL(E220_SUCCESS, sender->getModuleInformation(information).code);
+		TEST_ASSERT_EQUAL(E220_SUCCESS, sender->getConfiguration(configuration).code);
+		configuration.ADDL = 0x21;
+		TEST_ASSERT_EQUAL(E220_SUCCESS, sender->setConfiguration(configuration).code);
+		TEST_ASSERT_EQUAL(E220_SUCCESS, sender->setChannel(30).code);
+		TEST_ASSERT_EQUAL(MODE_3_PROGRAM, senderModule->getMode());
+	}
+	TEST_ASSERT_FALSE(sender->isProgramMode());
+	TEST_ASSERT_EQUAL(MODE_0_NORMAL, senderModule->getMode());
+	TEST_ASSERT_EQUAL(MODE_0_NORMAL, sender->getMode());
+	TEST_ASSERT_EQUAL(entries + 1, senderModule->programModeEntries);
+	TEST_ASSERT_EQUAL(0x21, senderModule->registers[1]);
+	TEST_ASSERT_EQUAL(30, senderModule->getChannel());
+
+	TEST_ASSERT_EQUAL(ERR_E220_INVALID_PARAM, sender->exitProgramMode());
+}
+
+void test_uart_baud_switch() {
+	// module UART at 115200 (SPED 111 00 010)
+	senderModule->registers[2] = senderModule->saved[2] = 0xE2;
+	LoRa_E220 fast(&senderPort, SENDER_AUX, SENDER_M0, SENDER_M1, UART_BPS_RATE_115200);
+	TEST_ASSERT_TRUE(fast.begin());
+	TEST_ASSERT_EQUAL(115200, senderPort.getBaud());
+
+	Configuration configuration;
+	TEST_ASSERT_EQUAL(E220_SUCCESS, fast.getConfiguration(configuration).code);
+	TEST_ASSERT_EQUAL(UART_BPS_115200, configuration.SPED.uartBaudRate);
+	TEST_ASSERT_EQUAL(115200, senderPort.getBaud());
+	TEST_ASSERT_EQUAL(0, senderModule->bytesDropped);
+
+	// data path at full speed
+	configure(receiver, 0x02, AIR_DATA_RATE_010_24, SPS_200_00, false);
+	configuration.ADDL = 0x01;
+	configuration.TRANSMISSION_MODE.fixedTransmission = FT_FIXED_TRANSMISSION;
+	TEST_ASSERT_EQUAL(E220_SUCCESS, fast.setConfiguration(configuration).code);
+	const char text[] = "fast";
+	TEST_ASSERT_EQUAL(E220_SUCCESS, fast.sendFixedMessage(0x00, 0x02, 23, text, sizeof(text)).code);
+	nativeHostAdvance(200000);
+	TEST_ASSERT_EQUAL(sizeof(text), receiver->available());
+
+	// a new UART speed written in program mode is the rate restored on exit
+	configuration.SPED.uartBaudRate = UART_BPS_19200;
+	TEST_ASSERT_EQUAL(E220_SUCCESS, fast.updateConfiguration(configuration).code);
+	TEST_ASSERT_EQUAL(19200, senderPort.getBaud());
+	TEST_ASSERT_EQUAL(19200, senderModule->getUARTBaud());
+	TEST_ASSERT_EQUAL(0, senderModule->bytesDropped);
+}
+
+void test_baud_negotiation() {
+	configure(receiver, 0x02, AIR_DATA_RATE_111_625, SPS_200_00, false);
+
+	LoRa_E220 fast(&senderPort, SENDER_AUX, SENDER_M0, SENDER_M1);
+	TEST_ASSERT_TRUE(fast.begin(UART_BPS_RATE_115200));
+	TEST_ASSERT_EQUAL(UART_BPS_RATE_115200, fast.getBpsRate());
+	TEST_ASSERT_EQUAL(115200, senderPort.getBaud());
+	TEST_ASSERT_EQUAL(115200, senderModule->getUARTBaud());
+	TEST_ASSERT_EQUAL(0x62, senderModule->saved[2]);
+
+	// 62.5 kbps on air: the 200 bytes leave the host in 17 ms instead of 208 ms
+	Configuration configuration;
+	TEST_ASSERT_EQUAL(E220_SUCCESS, fast.getCachedConfiguration(configuration).code);
+	configuration.SPED.airDataRate = AIR_DATA_RATE_111_625;
+	configuration.TRANSMISSION_MODE.fixedTransmission = FT_FIXED_TRANSMISSION;
+	TEST_ASSERT_EQUAL(E220_SUCCESS, fast.updateConfiguration(configuration).code);
+
+	uint8_t payload[197] = { 0 };
+	TEST_ASSERT_EQUAL(E220_SUCCESS, fast.beginSendFixedMessage(0x00, 0x02, 23, payload, sizeof(payload)).code);
+	nativeHostAdvance(400000);
+	TEST_ASSERT_EQUAL(sizeof(payload), receiver->available());
+
+	// already there: nothing written
+	size_t written = senderPort.getWrittenBytes();
+	TEST_ASSERT_EQUAL(E220_SUCCESS, fast.negotiateBaudRate(UART_BPS_RATE_115200).code);
+	TEST_ASSERT_EQUAL(written + 3, senderPort.getWrittenBytes());
+}
+
+void test_baud_negotiation_keeps_crypt() {
+	// a key written earlier, which the module reads back as 0
+	senderModule->registers[6] = senderModule->saved[6] = 0x12;
+	senderModule->registers[7] = senderModule->saved[7] = 0x34;
+	senderModule->registers[3] |= 0x20;
+
+	LoRa_E220 fast(&senderPort, SENDER_AUX, SENDER_M0, SENDER_M1);
+	TEST_ASSERT_TRUE(fast.begin(UART_BPS_RATE_115200));
+	TEST_ASSERT_EQUAL(0x62 | 0xE0, senderModule->registers[2]);
+
+	// the fallback to 9600 does not touch the key either
+	senderModule->maxDataBaud = 57600;
+	TEST_ASSERT_EQUAL(E220_SUCCESS, fast.negotiateBaudRate(UART_BPS_RATE_9600, WRITE_CFG_PWR_DWN_SAVE).code);
+	TEST_ASSERT_EQUAL(ERR_E220_WRONG_UART_CONFIG, fast.negotiateBaudRate(UART_BPS_RATE_115200, WRITE_CFG_PWR_DWN_SAVE).code);
+	TEST_ASSERT_EQUAL(9600, senderModule->getUARTBaud());
+
+	TEST_ASSERT_EQUAL_HEX8(0x12, senderModule->registers[6]);
+	TEST_ASSERT_EQUAL_HEX8(0x34, senderModule->registers[7]);
+	TEST_ASSERT_EQUAL_HEX8(0x12, senderModule->saved[6]);
+	TEST_ASSERT_EQUAL_HEX8(0x34, senderModule->saved[7]);
+}
+
+void test_baud_negotiation_checks_data_link() {
+	// ambient RSSI enabled: the new rate is checked with a register read in normal mode
+	senderModule->registers[3] |= 0x20;
+	LoRa_E220 fast(&senderPort, SENDER_AUX, SENDER_M0, SENDER_M1);
+	TEST_ASSERT_TRUE(fast.begin(UART_BPS_RATE_57600));
+	TEST_ASSERT_EQUAL(57600, senderModule->getUARTBaud());
+	TEST_ASSERT_EQUAL(0, senderModule->bytesDropped);
+
+	// the module takes the rate in program mode but the wiring loses the data at it
+	senderModule->maxDataBaud = 57600;
+	TEST_ASSERT_EQUAL(ERR_E220_WRONG_UART_CONFIG, fast.negotiateBaudRate(UART_BPS_RATE_115200).code);
+	TEST_ASSERT_TRUE(senderModule->bytesDropped > 0);
+	TEST_ASSERT_EQUAL(UART_BPS_RATE_9600, fast.getBpsRate());
+	TEST_ASSERT_EQUAL(9600, senderPort.getBaud());
+	TEST_ASSERT_EQUAL(9600, senderModule->getUARTBaud());
+	TEST_ASSERT_EQUAL(0, senderModule->packetsSent);
+
+	byte ambient, lastPacket;
+	TEST_ASSERT_EQUAL(E220_SUCCESS, fast.readRSSI(ambient, lastPacket).code);
+}
+
+void test_configuration_cache() {
+	TEST_ASSERT_FALSE(sender->isConfigurationCached());
+	Configuration configuration;
+	TEST_ASSERT_EQUAL(E220_SUCCESS, sender->getCachedConfiguration(configuration).code);
+	TEST_ASSERT_TRUE(sender->isConfigurationCached());
+
+	// served from the cache: no UART traffic, no time spent in program mode
+	size_t written = senderPort.getWrittenBytes();
+	unsigned long long start = nativeHostNow();
+	TEST_ASSERT_EQUAL(E220_SUCCESS, sender->getCachedConfiguration(configuration).code);
+	TEST_ASSERT_EQUAL(written, senderPort.getWrittenBytes());
+	TEST_ASSERT_EQUAL(start, nativeHostNow());
+	TEST_ASSERT_EQUAL(0x17, configuration.CHAN);
+
+	configuration.CHAN = 40;
+	TEST_ASSERT_EQUAL(E220_SUCCESS, sender->setConfiguration(configuration).code);
+	Configuration cached;
+	TEST_ASSERT_EQUAL(E220_SUCCESS, sender->getCachedConfiguration(cached).code);
+	TEST_ASSERT_EQUAL(40, cached.CHAN);
+	TEST_ASSERT_EQUAL(written + 11, senderPort.getWrittenBytes());
+
+	// a power cycle is not seen until the cache is refreshed
+	senderModule->powerCycle();
+	TEST_ASSERT_EQUAL(E220_SUCCESS, sender->getCachedConfiguration(cached).code);
+	TEST_ASSERT_EQUAL(40, cached.CHAN);
+	sender->invalidateConfiguration();
+	TEST_ASSERT_EQUAL(E220_SUCCESS, sender->getCachedConfiguration(cached).code);
+	TEST_ASSERT_EQUAL(0x17, cached.CHAN);
+}
+
+void test_partial_configuration_write() {
+	Configuration configuration;
+	TEST_ASSERT_EQUAL(E220_SUCCESS, sender->getCachedConfiguration(configuration).code);
+	configuration.CRYPT.CRYPT_H = 0x12;
+	configuration.CRYPT.CRYPT_L = 0x34;
+	TEST_ASSERT_EQUAL(E220_SUCCESS, sender->updateConfiguration(configuration, WRITE_CFG_PWR_DWN_SAVE).code);
+	TEST_ASSERT_EQUAL(0x34, senderModule->saved[7]);
+
+	// one register: command, address, length and the value
+	size_t written = senderPort.getWrittenBytes();
+	configuration.CHAN = 40;
+	TEST_ASSERT_EQUAL(E220_SUCCESS, sender->updateConfiguration(configuration, WRITE_CFG_PWR_DWN_SAVE).code);
+	TEST_ASSERT_EQUAL(written + 4, senderPort.getWrittenBytes());
+	TEST_ASSERT_EQUAL(40, senderModule->saved[4]);
+	TEST_ASSERT_EQUAL(0x34, senderModule->registers[7]);
+
+	// two runs: ADDH-ADDL and OPTION
+	written = senderPort.getWrittenBytes();
+	size_t calls = senderPort.getWriteCalls();
+	configuration.ADDH = 0x01;
+	configuration.ADDL = 0x02;
+	configuration.OPTION.transmissionPower = POWER_13;
+	TEST_ASSERT_EQUAL(E220_SUCCESS, sender->updateConfiguration(configuration).code);
+	TEST_ASSERT_EQUAL(written + 5 + 4, senderPort.getWrittenBytes());
+	TEST_ASSERT_EQUAL(calls + 4, senderPort.getWriteCalls());
+	TEST_ASSERT_EQUAL(0x02, senderModule->registers[1]);
+	TEST_ASSERT_EQUAL(0x00, senderModule->saved[1]);
+
+	// nothing changed: program mode is not even entered
+	unsigned long long start = nativeHostNow();
+	TEST_ASSERT_EQUAL(E220_SUCCESS, sender->updateConfiguration(configuration).code);
+	TEST_ASSERT_EQUAL(start, nativeHostNow());
+
+	Configuration read;
+	TEST_ASSERT_EQUAL(E220_SUCCESS, sender->getConfiguration(read).code);
+	TEST_ASSERT_EQUAL_UINT8_ARRAY(&configuration.ADDH, &read.ADDH, 6);
+}
+
+void test_register_writes_wait_for_store() {
+	Configuration configuration;
+	TEST_ASSERT_EQUAL(E220_SUCCESS, sender->getCachedConfiguration(configuration).code);
+	unsigned long dropped = senderModule->bytesDropped;
+
+	// runs back to back and chained calls in one session: each command waits
+	// until the module has stored the previous registers
+	{
+		LoRa_E220_ConfigSession session(*sender);
+		configuration.ADDL = 0x07;
+		configuration.CHAN = 30;
+		configuration.TRANSMISSION_MODE.fixedTransmission = FT_FIXED_TRANSMISSION;
+		TEST_ASSERT_EQUAL(E220_SUCCESS, sender->updateConfiguration(configuration, WRITE_CFG_PWR_DWN_SAVE).code);
+		TEST_ASSERT_EQUAL(HIGH, digitalRead(SENDER_AUX));
+		TEST_ASSERT_EQUAL(E220_SUCCESS, sender->setChannel(31, true).code);
+		TEST_ASSERT_EQUAL(E220_SUCCESS, sender->setChannel(32, false).code);
+	}
+	TEST_ASSERT_EQUAL(dropped, senderModule->bytesDropped);
+	TEST_ASSERT_EQUAL(0x07, senderModule->saved[1]);
+	TEST_ASSERT_EQUAL(32, senderModule->saved[4]);
+	TEST_ASSERT_EQUAL(0x40, senderModule->saved[5] & 0x40);
+
+	Configuration read;
+	TEST_ASSERT_EQUAL(E220_SUCCESS, sender->getConfiguration(read).code);
+	TEST_ASSERT_EQUAL(32, read.CHAN);
+	TEST_ASSERT_EQUAL(dropped, senderModule->bytesDropped);
+}
+
+void test_ensure_configuration() {
+	Configuration configuration;
+	TEST_ASSERT_EQUAL(E220_SUCCESS, sender->getCachedConfiguration(configuration).code);
+	configuration.ADDL = 0x05;
+	configuration.CHAN = 40;
+
+	bool written = false;
+	TEST_ASSERT_EQUAL(E220_SUCCESS, sender->ensureConfiguration(configuration, WRITE_CFG_PWR_DWN_SAVE, &written).code);
+	TEST_ASSERT_TRUE(written);
+	TEST_ASSERT_EQUAL(0x05, senderModule->saved[1]);
+	TEST_ASSERT_EQUAL(40, senderModule->saved[4]);
+
+	// next boot: one read (3 command bytes) and no write
+	senderModule->powerCycle();
+	sender->invalidateConfiguration();
+	size_t bytes = senderPort.getWrittenBytes();
+	TEST_ASSERT_EQUAL(E220_SUCCESS, sender->ensureConfiguration(configuration, WRITE_CFG_PWR_DWN_SAVE, &written).code);
+	TEST_ASSERT_FALSE(written);
+	TEST_ASSERT_EQUAL(bytes + 3, senderPort.getWrittenBytes());
+
+	// the cache is ignored: a module changed behind it is corrected
+	senderModule->registers[4] = 41;
+	TEST_ASSERT_EQUAL(E220_SUCCESS, sender->ensureConfiguration(configuration, WRITE_CFG_PWR_DWN_SAVE, &written).code);
+	TEST_ASSERT_TRUE(written);
+	TEST_ASSERT_EQUAL(40, senderModule->registers[4]);
+
+	// the key reads back as 0: unknown after a reset, written only on request
+	configuration.CRYPT.CRYPT_H = 0x12;
+	configuration.CRYPT.CRYPT_L = 0x34;
+	sender->invalidateConfiguration();
+	TEST_ASSERT_EQUAL(E220_SUCCESS, sender->ensureConfiguration(configuration, WRITE_CFG_PWR_DWN_SAVE, &written).code);
+	TEST_ASSERT_FALSE(written);
+	TEST_ASSERT_EQUAL(0x00, senderModule->saved[6]);
+
+	TEST_ASSERT_EQUAL(E220_SUCCESS, sender->ensureConfiguration(configuration, WRITE_CFG_PWR_DWN_SAVE, &written, true).code);
+	TEST_ASSERT_TRUE(written);
+	TEST_ASSERT_EQUAL(0x12, senderModule->saved[6]);
+	TEST_ASSERT_EQUAL(0x34, senderModule->saved[7]);
+
+	// known now: not written again
+	TEST_ASSERT_EQUAL(E220_SUCCESS, sender->ensureConfiguration(configuration, WRITE_CFG_PWR_DWN_SAVE, &written, true).code);
+	TEST_ASSERT_FALSE(written);
+}
+
+static constexpr ConfigurationRegisters NODE_CONFIG PROGMEM = LoRa_E220_ConfigBuilder()
+	.address(0x01, 0x02)
+	.channel(40)
+	.airDataRate(AIR_DATA_RATE_111_625)
+	.subPacketSetting(SPS_064_10)
+	.transmissionPower(POWER_13)
+	.fixedTransmission(FT_FIXED_TRANSMISSION)
+	.rssi(RSSI_ENABLED)
+	.worPeriod(WOR_500_000)
+	.crypt(0x1234)
+	.build();
+
+static_assert(LoRa_E220_ConfigBuilder().getRegister(REG_ADDRESS_SPED) == 0x62, "factory SPED");
+static_assert(LoRa_E220_ConfigBuilder().getRegister(REG_ADDRESS_TRANS_MODE) == 0x03, "factory WOR 2000 ms");
+static_assert(NODE_CONFIG.registers[2] == 0x67 && NODE_CONFIG.registers[3] == 0x82
+		&& NODE_CONFIG.registers[5] == 0xC0 && NODE_CONFIG.registers[7] == 0x34, "packed at compile time");
+
+void test_configuration_builder() {
+	Configuration configuration;
+	loadConfiguration_P(&NODE_CONFIG, configuration);
+	Configuration copy;
+	loadConfiguration(NODE_CONFIG, copy);
+	TEST_ASSERT_EQUAL_UINT8_ARRAY(&copy.ADDH, &configuration.ADDH, PL_CONFIGURATION);
+	TEST_ASSERT_EQUAL(AIR_DATA_RATE_111_625, configuration.SPED.airDataRate);
+	TEST_ASSERT_EQUAL(UART_BPS_9600, configuration.SPED.uartBaudRate);
+	TEST_ASSERT_EQUAL(SPS_064_10, configuration.OPTION.subPacketSetting);
+	TEST_ASSERT_EQUAL(POWER_13, configuration.OPTION.transmissionPower);
+	TEST_ASSERT_EQUAL(FT_FIXED_TRANSMISSION, configuration.TRANSMISSION_MODE.fixedTransmission);
+	TEST_ASSERT_EQUAL(RSSI_ENABLED, configuration.TRANSMISSION_MODE.enableRSSI);
+
+	TEST_ASSERT_EQUAL(E220_SUCCESS, sender->updateConfiguration(configuration, WRITE_CFG_PWR_DWN_SAVE).code);
+	TEST_ASSERT_EQUAL_UINT8_ARRAY(NODE_CONFIG.registers, senderModule->saved, PL_CONFIGURATION);
+}
+
+/*
+ * Remote configuration of three nodes in range and one missing node, with
+ * one command at a time and with four in flight.
+ */
+static void rollout(uint8_t window, uint8_t power, unsigned long long &elapsed) {
+	HardwareSerial nodePorts[3];
+	E220Simulator *nodes[3];
+	for (uint8_t i = 0; i < 3; i++) {
+		nodes[i] = new E220Simulator(nodePorts[i], -1);
+		nodes[i]->registers[1] = 0x10 + i;
+		E220Simulator::link(*senderModule, *nodes[i]);
+	}
+
+	RemoteConfigTarget targets[] = { { 0x00, 0x10, 23 }, { 0x00, 0x20, 23 }, { 0x00, 0x11, 23 }, { 0x00, 0x12, 23 } };
+	LoRa_E220_RemoteConfig manager(*sender, targets, 4, window, 1000, 2);
+
+	Configuration configuration;
+	TEST_ASSERT_EQUAL(E220_SUCCESS, sender->getCachedConfiguration(configuration).code);
+	configuration.OPTION.transmissionPower = power;
+	configuration.TRANSMISSION_MODE.fixedTransmission = FT_TRANSPARENT_TRANSMISSION;
+	// the nodes keep their own channel, like their address
+	configuration.CHAN = 5;
+
+	unsigned long long start = nativeHostNow();
+	manager.begin(configuration, WRITE_CFG_PWR_DWN_SAVE);
+	while (manager.poll()) {
+		nativeHostAdvance(100);
+		TEST_ASSERT_LESS_THAN(20000000ULL, nativeHostNow() - start);
+	}
+	elapsed = nativeHostNow() - start;
+
+	TEST_ASSERT_EQUAL(3, manager.getSucceeded());
+	TEST_ASSERT_EQUAL(1, manager.getFailed());
+	TEST_ASSERT_EQUAL(E220_SUCCESS, targets[0].status);
+	TEST_ASSERT_EQUAL(ERR_E220_NO_RESPONSE_FROM_DEVICE, targets[1].status);
+	TEST_ASSERT_EQUAL(2, targets[1].attempts);
+	for (uint8_t i = 0; i < 3; i++) {
+		TEST_ASSERT_EQUAL(0x10 + i, nodes[i]->saved[1]);
+		TEST_ASSERT_EQUAL(23, nodes[i]->saved[REG_ADDRESS_CHANNEL]);
+		TEST_ASSERT_EQUAL(power, nodes[i]->saved[3] & 0x03);
+		TEST_ASSERT_EQUAL(1, nodes[i]->wirelessCommands);
+		delete nodes[i];
+	}
+}
+
+void test_remote_configuration() {
+	configure(sender, 0x01, AIR_DATA_RATE_010_24, SPS_200_00, false);
+
+	unsigned long long sequential, pipelined;
+	rollout(1, POWER_13, sequential);
+	rollout(4, POWER_17, pipelined);
+	printf("[bench] remote configuration of 4 nodes (1 missing): %.0f ms one at a time, %.0f ms pipelined\n",
+			sequential / 1000.0, pipelined / 1000.0);
+	TEST_ASSERT_LESS_THAN(sequential, pipelined);
+}
+
+void test_remote_configuration_channels() {
+	configure(sender, 0x01, AIR_DATA_RATE_010_24, SPS_200_00, false);
+
+	// one node on the local channel, one elsewhere: its echo is never heard here
+	HardwareSerial nodePorts[2];
+	E220Simulator near(nodePorts[0], -1);
+	E220Simulator far(nodePorts[1], -1);
+	near.registers[1] = 0x10;
+	far.registers[1] = 0x11;
+	far.registers[4] = 30;
+	E220Simulator::link(*senderModule, near);
+	E220Simulator::link(*senderModule, far);
+
+	// both commands in flight: the echo of the first is checked after the second is sent
+	RemoteConfigTarget targets[] = { { 0x00, 0x10, 23 }, { 0x00, 0x11, 30 } };
+	LoRa_E220_RemoteConfig manager(*sender, targets, 2, 2, 1000, 1);
+
+	Configuration configuration;
+	TEST_ASSERT_EQUAL(E220_SUCCESS, sender->getCachedConfiguration(configuration).code);
+	configuration.OPTION.transmissionPower = POWER_13;
+
+	unsigned long long start = nativeHostNow();
+	manager.begin(configuration, WRITE_CFG_PWR_DWN_LOSE);
+	while (manager.poll()) {
+		nativeHostAdvance(100);
+		TEST_ASSERT_LESS_THAN(10000000ULL, nativeHostNow() - start);
+	}
+
+	TEST_ASSERT_EQUAL(E220_SUCCESS, targets[0].status);
+	TEST_ASSERT_EQUAL(ERR_E220_NO_RESPONSE_FROM_DEVICE, targets[1].status);
+	TEST_ASSERT_EQUAL(23, near.registers[REG_ADDRESS_CHANNEL]);
+	TEST_ASSERT_EQUAL(30, far.registers[REG_ADDRESS_CHANNEL]);
+	TEST_ASSERT_EQUAL(POWER_13, far.registers[REG_ADDRESS_OPTION] & 0x03);
+}
+
+void test_rssi_registers() {
+	configure(sender, 0x01, AIR_DATA_RATE_111_625, SPS_200_00, false);
+	configure(receiver, 0x02, AIR_DATA_RATE_111_625, SPS_200_00, false);
+	Configuration configuration;
+	TEST_ASSERT_EQUAL(E220_SUCCESS, receiver->getCachedConfiguration(configuration).code);
+
+	// disabled: the command would go on air, nothing is written
+	byte ambient = 0, lastPacket = 0;
+	size_t written = receiverPort.getWrittenBytes();
+	TEST_ASSERT_EQUAL(ERR_E220_NOT_SUPPORT, receiver->readRSSI(ambient, lastPacket).code);
+	LoRa_E220_NoiseSampler disabled(*receiver, 20);
+	TEST_ASSERT_FALSE(disabled.poll());
+	TEST_ASSERT_EQUAL(1, disabled.getFailures());
+	TEST_ASSERT_EQUAL(written, receiverPort.getWrittenBytes());
+
+	configuration.OPTION.RSSIAmbientNoise = RSSI_AMBIENT_NOISE_ENABLED;
+	TEST_ASSERT_EQUAL(E220_SUCCESS, receiver->updateConfiguration(configuration).code);
+
+	uint8_t payload[8] = { 0 };
+	uint8_t frame[16];
+	uint16_t length;
+	receiverModule->rssi = 190;
+	TEST_ASSERT_EQUAL(E220_SUCCESS, sender->sendFixedMessage(0x00, 0x02, 23, payload, sizeof(payload)).code);
+	TEST_ASSERT_EQUAL(E220_SUCCESS, receiver->receiveFrame(frame, sizeof(frame), length).code);
+
+	// normal mode, no switch: 11 bytes at 9600 bps, against 128 ms for a program mode read
+	unsigned long entries = receiverModule->programModeEntries;
+	unsigned long long start = nativeHostNow();
+	TEST_ASSERT_EQUAL(E220_SUCCESS, receiver->readRSSI(ambient, lastPacket).code);
+	TEST_ASSERT_EQUAL(160, ambient);
+	TEST_ASSERT_EQUAL(190, lastPacket);
+	TEST_ASSERT_EQUAL(-96, getRSSIdBm(ambient));
+	TEST_ASSERT_EQUAL(entries, receiverModule->programModeEntries);
+	TEST_ASSERT_EQUAL(0, receiverModule->packetsSent);
+	TEST_ASSERT_LESS_THAN(15000ULL, nativeHostNow() - start);
+
+	// sampler: one read in flight at a time, the loop never waits
+	LoRa_E220_NoiseSampler sampler(*receiver, 20);
+	TEST_ASSERT_FALSE(sampler.isChannelClear(-90));
+	unsigned long polls = 0;
+	start = nativeHostNow();
+	while (nativeHostNow() - start < 1000000ULL) {
+		unsigned long long before = nativeHostNow();
+		sampler.poll();
+		TEST_ASSERT_LESS_THAN(2000ULL, nativeHostNow() - before);
+		if (nativeHostNow() - start > 500000ULL) receiverModule->ambientRSSI = 200;
+		nativeHostAdvance(500);
+		polls++;
+	}
+	printf("[bench] noise sampler: %lu samples in 1 s over %lu loop iterations\n", sampler.getSamples(), polls);
+	TEST_ASSERT_UINT32_WITHIN(3, 50, sampler.getSamples());
+	TEST_ASSERT_EQUAL(0, sampler.getFailures());
+	TEST_ASSERT_EQUAL(200, sampler.getAmbientRSSI());
+	TEST_ASSERT_FALSE(sampler.isChannelClear(-90));
+	TEST_ASSERT_TRUE(sampler.isChannelClear(-50));
+	TEST_ASSERT_EQUAL(-56, sampler.getNoiseFloorDbm());
+}
+
+void test_fixed_message_with_rssi() {
+	configure(sender, 0x01, AIR_DATA_RATE_010_24, SPS_200_00, false);
+	configure(receiver, 0x02, AIR_DATA_RATE_010_24, SPS_200_00, true);
+	receiverModule->rssi = 180;
+
+	const char text[] = "Hello simulator";
+	TEST_ASSERT_EQUAL(E220_SUCCESS, sender->sendFixedMessage(0x00, 0x02, 23, text, sizeof(text)).code);
+
+	char received[sizeof(text)];
+	byte rssi = 0;
+	nativeHostAdvance(200000);
+	TEST_ASSERT_EQUAL(E220_SUCCESS, receiver->receiveMessageRSSI(received, sizeof(received), rssi).code);
+	TEST_ASSERT_EQUAL_STRING(text, received);
+	TEST_ASSERT_EQUAL(180, rssi);
+
+	// other address, other channel and broadcast
+	sender->sendFixedMessage(0x00, 0x03, 23, text, sizeof(text));
+	sender->sendFixedMessage(0x00, 0x02, 24, text, sizeof(text));
+	nativeHostAdvance(500000);
+	TEST_ASSERT_EQUAL(0, receiver->available());
+	TEST_ASSERT_EQUAL(E220_SUCCESS, sender->sendBroadcastFixedMessage(23, text, sizeof(text)).code);
+	nativeHostAdvance(200000);
+	TEST_ASSERT_EQUAL(sizeof(text) + 1, receiver->available());
+}
+
+void test_sub_packets_are_separate_frames() {
+	// the air must be slower than the UART, or the receiver outputs the sub packets back to back
+	configure(sender, 0x01, AIR_DATA_RATE_010_24, SPS_032_11, false);
+	configure(receiver, 0x02, AIR_DATA_RATE_010_24, SPS_032_11, false);
+
+	uint8_t payload[100];
+	for (uint8_t i = 0; i < sizeof(payload); i++) payload[i] = i;
+	unsigned long long start = nativeHostNow();
+	TEST_ASSERT_EQUAL(E220_SUCCESS, sender->beginSendFixedMessage(0x00, 0x02, 23, payload, sizeof(payload)).code);
+	TEST_ASSERT_EQUAL(LOW, digitalRead(SENDER_AUX));
+
+	uint8_t frame[64];
+	uint16_t length;
+	uint16_t total = 0;
+	int frames = 0;
+	while (nativeHostNow() - start < 3000000ULL && total < sizeof(payload)) {
+		sender->poll();
+		if (receiver->pollFrame(frame, sizeof(frame), length) == E220_SUCCESS) {
+			TEST_ASSERT_EQUAL_UINT8_ARRAY(payload + total, frame, length);
+			total += length;
+			frames++;
+		}
+		nativeHostAdvance(100);
+	}
+	TEST_ASSERT_EQUAL(sizeof(payload), total);
+	TEST_ASSERT_EQUAL(4, frames);
+	TEST_ASSERT_EQUAL(4, senderModule->packetsSent);
+}
+
+/*
+ * Benchmark: time from the first byte written by the sender to the frame
+ * returned on the receiver, at the default and the fastest air data rate.
+ */
+void test_benchmark_end_to_end_latency() {
+	const AIR_DATA_RATE rates[] = { AIR_DATA_RATE_010_24, AIR_DATA_RATE_111_625 };
+	uint8_t payload[24] = { 0 };
+
+	for (uint8_t r = 0; r < 2; r++) {
+		configure(sender, 0x01, rates[r], SPS_200_00, false);
+		configure(receiver, 0x02, rates[r], SPS_200_00, false);
+
+		unsigned long long start = nativeHostNow();
+		TEST_ASSERT_EQUAL(E220_SUCCESS, sender->beginSendFixedMessage(0x00, 0x02, 23, payload, sizeof(payload)).code);
+
+		uint8_t frame[64];
+		uint16_t length = 0;
+		while (receiver->pollFrame(frame, sizeof(frame), length) != E220_SUCCESS) {
+			sender->poll();
+			nativeHostAdvance(50);
+			TEST_ASSERT_LESS_THAN(2000000ULL, nativeHostNow() - start);
+		}
+		while (sender->isSendPending()) sender->poll();
+
+		unsigned long long latency = nativeHostNow() - start;
+		unsigned long airtime = getPacketAirtimeMicros(rates[r], sizeof(payload));
+		printf("[bench] %s, %u bytes: %.2f ms end to end (%.2f ms on air)\n",
+				getAirDataRateDescriptionByParams(rates[r]).c_str(), (unsigned)sizeof(payload), latency / 1000.0, airtime / 1000.0);
+
+		TEST_ASSERT_EQUAL(sizeof(payload), length);
+		TEST_ASSERT_GREATER_THAN(airtime, latency);
+	}
+}
+
+/*
+ * Benchmark: channel hops per second, setChannel() against the
+ * getConfiguration()/setConfiguration() pair it replaces.
+ */
+void test_benchmark_channel_hops() {
+	const byte channels[] = { 10, 23, 40, 61 };
+	const int hops = 20;
+	Configuration configuration;
+
+	unsigned long long start = nativeHostNow();
+	for (int i = 0; i < hops; i++) {
+		TEST_ASSERT_EQUAL(E220_SUCCESS, sender->getConfiguration(configuration).code);
+		configuration.CHAN = channels[i % 4];
+		TEST_ASSERT_EQUAL(E220_SUCCESS, sender->setConfiguration(configuration).code);
+	}
+	unsigned long long fullMicros = (nativeHostNow() - start) / hops;
+
+	start = nativeHostNow();
+	for (int i = 0; i < hops; i++) {
+		TEST_ASSERT_EQUAL(E220_SUCCESS, sender->setChannel(channels[i % 4]).code);
+		TEST_ASSERT_EQUAL(channels[i % 4], senderModule->getChannel());
+	}
+	unsigned long long hopMicros = (nativeHostNow() - start) / hops;
+
+	printf("[bench] get/setConfiguration: %.1f ms per hop, %.1f hops/s\n", fullMicros / 1000.0, 1000000.0 / fullMicros);
+	printf("[bench] setChannel: %.1f ms per hop, %.1f hops/s\n", hopMicros / 1000.0, 1000000.0 / hopMicros);
+
+	TEST_ASSERT_LESS_THAN(fullMicros / 2, hopMicros);
+	TEST_ASSERT_EQUAL(0x17, senderModule->saved[4]);
+}
+
+/*
+ * Benchmark: ambient noise scan of the full band (channels 0-83), 4 samples
+ * per channel, then the switch to the quietest channel.
+ */
+void test_benchmark_channel_scan() {
+	static uint8_t noise[256];
+	for (uint16_t i = 0; i < 256; i++) noise[i] = 180 + (i % 7);
+	noise[57] = 140;
+	noise[12] = 145;
+	receiverModule->channelNoise = noise;
+
+	LoRa_E220_ChannelScanner scanner(*receiver);
+	ChannelScanResult results[84];
+	TEST_ASSERT_EQUAL(E220_SUCCESS, scanner.scan(0, 83, results, 4).code);
+	TEST_ASSERT_EQUAL(57, results[0].CHAN);
+	TEST_ASSERT_EQUAL(140, results[0].meanRSSI);
+	TEST_ASSERT_EQUAL(4, results[0].samples);
+	TEST_ASSERT_EQUAL(12, results[1].CHAN);
+	TEST_ASSERT_EQUAL(186, results[83].meanRSSI);
+	// back to the channel and the options of before
+	TEST_ASSERT_EQUAL(23, receiverModule->getChannel());
+	TEST_ASSERT_EQUAL(0, receiverModule->registers[3] & 0x20);
+	TEST_ASSERT_EQUAL(23, receiverModule->saved[4]);
+
+	unsigned long scanMicros = scanner.getScanMicros();
+	printf("[bench] full band scan, 84 channels x 4 samples: %.0f ms (%.1f ms per channel)\n",
+			scanMicros / 1000.0, scanMicros / 84000.0);
+	TEST_ASSERT_LESS_THAN(84UL * 100000UL, scanMicros);
+
+	TEST_ASSERT_EQUAL(E220_SUCCESS, scanner.scanAndSelect(0, 83, results, 2, WRITE_CFG_PWR_DWN_SAVE).code);
+	TEST_ASSERT_EQUAL(57, receiverModule->getChannel());
+	TEST_ASSERT_EQUAL(57, receiverModule->saved[4]);
+}
+
+void test_channel_scan_keeps_crypt() {
+	receiverModule->registers[6] = 0x12;
+	receiverModule->registers[7] = 0x34;
+
+	// RSSI ambient noise is switched on and off around the scan, the key stays
+	LoRa_E220_ChannelScanner scanner(*receiver);
+	ChannelScanResult results[4];
+	TEST_ASSERT_EQUAL(E220_SUCCESS, scanner.scan(20, 23, results, 1).code);
+	TEST_ASSERT_EQUAL(0, receiverModule->registers[3] & 0x20);
+	TEST_ASSERT_EQUAL_HEX8(0x12, receiverModule->registers[6]);
+	TEST_ASSERT_EQUAL_HEX8(0x34, receiverModule->registers[7]);
+}
+
+int main(int argc, char **argv) {
+	UNITY_BEGIN();
+
+	RUN_TEST(test_register_protocol);
+	RUN_TEST(test_mode_switch_on_aux);
+	RUN_TEST(test_config_session);
+	RUN_TEST(test_uart_baud_switch);
+	RUN_TEST(test_baud_negotiation);
+	RUN_TEST(test_baud_negotiation_keeps_crypt);
+	RUN_TEST(test_baud_negotiation_checks_data_link);
+	RUN_TEST(test_configuration_cache);
+	RUN_TEST(test_partial_configuration_write);
+	RUN_TEST(test_register_writes_wait_for_store);
+	RUN_TEST(test_ensure_configuration);
+	RUN_TEST(test_configuration_builder);
+	RUN_TEST(test_remote_configuration);
+	RUN_TEST(test_remote_configuration_channels);
+	RUN_TEST(test_rssi_registers);
+	RUN_TEST(test_fixed_message_with_rssi);
+	RUN_TEST(test_sub_packets_are_separate_frames);
+	RUN_TEST(test_benchmark_end_to_end_latency);
+	RUN_TEST(test_benchmark_channel_hops);
+	RUN_TEST(test_benchmark_channel_scan);
+	RUN_TEST(test_channel_scan_keeps_crypt);
+
+	return UNITY_END();
+}
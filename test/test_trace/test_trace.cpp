@@ -0,0 +1,160 @@
+/**
+ * Binary event trace: the event layout and, in the native_trace environment
+ * (LoRa_E220_TRACE defined), the events recorded by a real LoRa_E220
+ * against the simulated module, the ring and the dump format.
+ */
+#include <unity.h>
+#include <stdio.h>
+#include <vector>
+
+#include "LoRa_E220.h"
+#include "E220Simulator.h"
+
+#define MODULE_AUX 4
+#define MODULE_M0 5
+#define MODULE_M1 6
+
+void setUp(void) {
+	nativeHostReset();
+#ifdef LoRa_E220_TRACE
+	LoRa_E220_Trace::clear();
+#endif
+}
+
+void tearDown(void) {
+}
+
+void test_event_layout() {
+	// the dump writes 8 bytes per event, the ring keeps them in place
+	TEST_ASSERT_EQUAL(8, sizeof(TraceEvent));
+	TEST_ASSERT_TRUE(TRACE_RSSI < TRACE_USER);
+}
+
+#ifdef LoRa_E220_TRACE
+class CapturePrint : public Print {
+	public:
+		std::vector<uint8_t> bytes;
+		size_t write(uint8_t c) { bytes.push_back(c); return 1; }
+};
+
+static uint32_t littleEndian(const std::vector<uint8_t> &bytes, size_t offset, uint8_t size) {
+	uint32_t value = 0;
+	for (uint8_t i = 0; i < size; i++) value |= (uint32_t)bytes[offset + i] << (8 * i);
+	return value;
+}
+
+void test_configuration_read_events() {
+	HardwareSerial port;
+	E220Simulator module(port, MODULE_AUX, MODULE_M0, MODULE_M1);
+	LoRa_E220 e220(&port, MODULE_AUX, MODULE_M0, MODULE_M1, UART_BPS_RATE_9600);
+	TEST_ASSERT_TRUE(e220.begin(true));
+
+	LoRa_E220_Trace::clear();
+	Configuration configuration;
+	TEST_ASSERT_EQUAL(E220_SUCCESS, e220.getConfiguration(configuration).code);
+
+	TraceEvent events[E220_TRACE_SIZE];
+	uint16_t count = LoRa_E220_Trace::read(events, E220_TRACE_SIZE);
+
+	// the library events in order, the AUX edges in between
+	const uint8_t expected[] = { TRACE_MODE_SWITCH, TRACE_PROGRAM_COMMAND, TRACE_UART_READ, TRACE_AUX_WAIT,
+			TRACE_CONFIGURATION, TRACE_MODE_SWITCH };
+	uint8_t found = 0;
+	uint8_t edges = 0;
+	for (uint16_t i = 0; i < count; i++) {
+		if (i > 0) TEST_ASSERT_TRUE(events[i].time >= events[i - 1].time);
+		if (events[i].event == TRACE_AUX_EDGE) {
+			edges++;
+			continue;
+		}
+		TEST_ASSERT_TRUE(found < sizeof(expected));
+		TEST_ASSERT_EQUAL(expected[found], events[i].event);
+		const TraceEvent &event = events[i];
+		switch (found) {
+		case 0:
+			TEST_ASSERT_EQUAL(MODE_3_PROGRAM, event.arg1);
+			TEST_ASSERT_UINT32_WITHIN(100, module.modeSwitchMicros, event.arg2);
+			break;
+		case 1:
+			TEST_ASSERT_EQUAL(READ_CONFIGURATION, event.arg1);
+			TEST_ASSERT_EQUAL(REG_ADDRESS_CFG << 8 | PL_CONFIGURATION, event.arg2);
+			break;
+		case 2:
+			TEST_ASSERT_EQUAL(E220_SUCCESS, event.arg1);
+			TEST_ASSERT_EQUAL(sizeof(Configuration), event.arg2);
+			break;
+		case 4:
+			TEST_ASSERT_EQUAL(E220_SUCCESS, event.arg1);
+			TEST_ASSERT_EQUAL(23 << 8 | 0x62, event.arg2);
+			break;
+		case 5:
+			TEST_ASSERT_EQUAL(MODE_0_NORMAL, event.arg1);
+			break;
+		}
+		found++;
+	}
+	TEST_ASSERT_EQUAL(sizeof(expected), found);
+	// AUX LOW and HIGH around each mode switch
+	TEST_ASSERT_EQUAL(4, edges);
+	printf("[bench] configuration read: %u events, %lu us from first to last\n",
+			count, (unsigned long)(events[count - 1].time - events[0].time));
+
+	// E220_TRACE_DUMP=file saves the dump, for scripts/decode_trace.py
+	const char *path = getenv("E220_TRACE_DUMP");
+	if (path) {
+		CapturePrint capture;
+		LoRa_E220_Trace::dump(capture);
+		FILE *file = fopen(path, "wb");
+		TEST_ASSERT_NOT_NULL(file);
+		fwrite(&capture.bytes[0], 1, capture.bytes.size(), file);
+		fclose(file);
+	}
+}
+
+void test_ring_and_dump() {
+	for (uint16_t i = 0; i < E220_TRACE_SIZE + 10; i++) {
+		E220_TRACE(TRACE_USER, i & 0xFF, i)
+	}
+	TEST_ASSERT_EQUAL(E220_TRACE_SIZE + 10, LoRa_E220_Trace::getRecorded());
+	TEST_ASSERT_EQUAL(10, LoRa_E220_Trace::getOverwritten());
+
+	// the most recent events, oldest first
+	TraceEvent events[4];
+	TEST_ASSERT_EQUAL(4, LoRa_E220_Trace::read(events, 4));
+	TEST_ASSERT_EQUAL(E220_TRACE_SIZE + 6, events[0].arg2);
+	TEST_ASSERT_EQUAL(E220_TRACE_SIZE + 9, events[3].arg2);
+
+	LoRa_E220_Trace::setEnabled(false);
+	E220_TRACE(TRACE_USER, 0, 0)
+	TEST_ASSERT_EQUAL(E220_TRACE_SIZE + 10, LoRa_E220_Trace::getRecorded());
+	LoRa_E220_Trace::setEnabled(true);
+
+	CapturePrint capture;
+	size_t written = LoRa_E220_Trace::dump(capture);
+	TEST_ASSERT_EQUAL(12 + 8 * E220_TRACE_SIZE, written);
+	TEST_ASSERT_EQUAL(written, capture.bytes.size());
+	TEST_ASSERT_EQUAL_MEMORY("E2TR", &capture.bytes[0], 4);
+	TEST_ASSERT_EQUAL(E220_TRACE_FORMAT_VERSION, capture.bytes[4]);
+	TEST_ASSERT_EQUAL(8, capture.bytes[5]);
+	TEST_ASSERT_EQUAL(E220_TRACE_SIZE, littleEndian(capture.bytes, 6, 2));
+	TEST_ASSERT_EQUAL(E220_TRACE_SIZE + 10, littleEndian(capture.bytes, 8, 4));
+
+	// first event kept: the 11th recorded
+	TEST_ASSERT_EQUAL(TRACE_USER, capture.bytes[12 + 4]);
+	TEST_ASSERT_EQUAL(10, capture.bytes[12 + 5]);
+	TEST_ASSERT_EQUAL(10, littleEndian(capture.bytes, 12 + 6, 2));
+	TEST_ASSERT_TRUE(LoRa_E220_Trace::isEnabled());
+}
+#endif
+
+int main(int argc, char **argv) {
+	UNITY_BEGIN();
+
+	RUN_TEST(test_event_layout);
+#ifdef LoRa_E220_TRACE
+	RUN_TEST(test_configuration_read_events);
+	RUN_TEST(test_ring_and_dump);
+#endif
+
+	return UNITY_END();
+}
@@ -0,0 +1,155 @@
+/**
+ * Caller-owned receive buffers: configuration reads and binary receives
+ * must not touch the heap, and the container versions must stay usable.
+ *
+ * A stand-in of the module answers the program-mode read commands
+ * (C1 00 08 and C1 08 03) and transmits fixed-size messages followed by an
+ * RSSI byte. Its own queueing is excluded from the allocation count.
+ */
+#include <unity.h>
+
+#include "LoRa_E220.h"
+#include "NativeHeapCounter.h"
+
+#define AUX_PIN 4
+#define M0_PIN 5
+#define M1_PIN 6
+#define RECEIVES 200
+
+#define BYTE_MICROS 1042UL  // one 8N1 character at 9600 bps
+
+static HardwareSerial port;
+
+class RegisterModule : public NativeSerialDevice {
+	public:
+		uint8_t registers[11] = { 0x12, 0x34, 0x62, 0x00, 23, 0x40, 0x00, 0x00, 0x20, 0x0B, 0x14 };
+		uint8_t command[3];
+		uint8_t count = 0;
+
+		void onHostByte(uint8_t c, unsigned long baud) {
+			(void)baud;
+			if (!(nativeHost().pinLevel[M0_PIN] && nativeHost().pinLevel[M1_PIN])) return;
+			command[count++] = c;
+			if (count < 3) return;
+			count = 0;
+			if (command[0] != READ_CONFIGURATION || command[1] + command[2] > (int)sizeof(registers)) return;
+
+			uint8_t answer[3 + sizeof(registers)] = { RETURNED_COMMAND, command[1], command[2] };
+			memcpy(answer + 3, registers + command[1], command[2]);
+
+			NativeHeapUntracked untracked;
+			port.deliver(answer, 3 + command[2], nativeHostNow() + BYTE_MICROS, BYTE_MICROS);
+		}
+
+		void transmit(const void *message, uint8_t size, byte rssi) {
+			NativeHeapUntracked untracked;
+			port.deliver((const uint8_t *)message, size, nativeHostNow() + BYTE_MICROS, BYTE_MICROS);
+			port.deliver(&rssi, 1, port.lastDeliveryMicros() + BYTE_MICROS, BYTE_MICROS);
+		}
+};
+
+struct Reading {
+	uint16_t id;
+	int16_t temperature;
+	uint8_t humidity;
+};
+
+static RegisterModule module;
+
+void setUp(void) {
+	nativeHostReset();
+	module = RegisterModule();
+	port = HardwareSerial();
+	port.attachDevice(&module);
+	nativeSetPinLevel(AUX_PIN, HIGH);
+}
+
+void tearDown(void) {
+	nativeHeapUntrack();
+}
+
+void test_configuration_into_reference() {
+	LoRa_E220 e220(&port, AUX_PIN, M0_PIN, M1_PIN, UART_BPS_RATE_9600);
+	TEST_ASSERT_TRUE(e220.begin());
+
+	Configuration configuration;
+	TEST_ASSERT_EQUAL(E220_SUCCESS, e220.getConfiguration(configuration).code);
+	TEST_ASSERT_EQUAL(0x12, configuration.ADDH);
+	TEST_ASSERT_EQUAL(0x34, configuration.ADDL);
+	TEST_ASSERT_EQUAL(23, configuration.CHAN);
+
+	ModuleInformation information;
+	TEST_ASSERT_EQUAL(E220_SUCCESS, e220.getModuleInformation(information).code);
+	TEST_ASSERT_EQUAL(0x20, information.model);
+	TEST_ASSERT_EQUAL(0x0B, information.version);
+	TEST_ASSERT_EQUAL(0x14, information.features);
+}
+
+void test_container_still_owns_its_buffer() {
+	LoRa_E220 e220(&port, AUX_PIN, M0_PIN, M1_PIN, UART_BPS_RATE_9600);
+	TEST_ASSERT_TRUE(e220.begin());
+
+	ResponseStructContainer c = e220.getConfiguration();
+	TEST_ASSERT_EQUAL(E220_SUCCESS, c.status.code);
+	TEST_ASSERT_EQUAL(23, ((Configuration *)c.data)->CHAN);
+	c.close();
+	TEST_ASSERT_NULL(c.data);
+
+	// A failed read still hands back a buffer, freed by the usual close()
+	port.attachDevice(NULL);
+	c = e220.getConfiguration();
+	TEST_ASSERT_NOT_EQUAL(E220_SUCCESS, c.status.code);
+	TEST_ASSERT_NOT_NULL(c.data);
+	c.close();
+}
+
+void test_receive_does_not_allocate() {
+	LoRa_E220 e220(&port, AUX_PIN, M0_PIN, M1_PIN, UART_BPS_RATE_9600);
+	TEST_ASSERT_TRUE(e220.begin());
+
+	Configuration configuration;
+	ModuleInformation information;
+	Reading sent = { 7, -125, 55 };
+	Reading reading;
+	byte rssi = 0;
+
+	nativeHeapTrack();
+	for (int i = 0; i < RECEIVES; i++) {
+		TEST_ASSERT_EQUAL(E220_SUCCESS, e220.getConfiguration(configuration).code);
+		TEST_ASSERT_EQUAL(E220_SUCCESS, e220.getModuleInformation(information).code);
+
+		sent.id = i;
+		module.transmit(&sent, sizeof(sent), 200);
+		memset(&reading, 0, sizeof(reading));
+		TEST_ASSERT_EQUAL(E220_SUCCESS, e220.receiveMessageRSSI(&reading, sizeof(reading), rssi).code);
+		TEST_ASSERT_EQUAL(i, reading.id);
+		TEST_ASSERT_EQUAL(-125, reading.temperature);
+		TEST_ASSERT_EQUAL(200, rssi);
+
+		module.transmit(&sent, sizeof(sent), 200);
+		TEST_ASSERT_EQUAL(E220_SUCCESS, e220.receive(reading, rssi).code);
+	}
+	unsigned long allocations = nativeHeapUntrack();
+
+	printf("[heap] %d iterations of 4 reads: %lu allocations\n", RECEIVES, allocations);
+	TEST_ASSERT_EQUAL(0, allocations);
+
+	// Baseline: the container API allocates once per call
+	nativeHeapTrack();
+	module.transmit(&sent, sizeof(sent), 200);
+	ResponseStructContainer rsc = e220.receiveMessageRSSI(sizeof(Reading));
+	allocations = nativeHeapUntrack();
+	TEST_ASSERT_EQUAL(E220_SUCCESS, rsc.status.code);
+	TEST_ASSERT_EQUAL(1, allocations);
+	rsc.close();
+}
+
+int main(int argc, char **argv) {
+	UNITY_BEGIN();
+
+	RUN_TEST(test_configuration_into_reference);
+	RUN_TEST(test_container_still_owns_its_buffer);
+	RUN_TEST(test_receive_does_not_allocate);
+
+	return UNITY_END();
+}
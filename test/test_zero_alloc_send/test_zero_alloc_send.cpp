@@ -0,0 +1,104 @@
+/**
+ * Fixed-mode send must not touch the heap.
+ *
+ * malloc/free and operator new/delete are interposed to count allocations
+ * while the real LoRa_E220 class sends messages to a capturing stand-in of
+ * the module. The wire bytes are checked too: 3-byte address header
+ * followed by the untouched payload.
+ */
+#include <unity.h>
+
+#include "LoRa_E220.h"
+#include "NativeHeapCounter.h"
+
+#define AUX_PIN 4
+#define M0_PIN 5
+#define M1_PIN 6
+#define MESSAGES 1000
+
+class CaptureModule : public NativeSerialDevice {
+	public:
+		uint8_t bytes[256];
+		size_t count = 0;
+
+		void onHostByte(uint8_t c, unsigned long baud) {
+			(void)baud;
+			if (count < sizeof(bytes)) bytes[count] = c;
+			count++;
+		}
+};
+
+static HardwareSerial port;
+static CaptureModule module;
+
+void setUp(void) {
+	nativeHostReset();
+	module = CaptureModule();
+	port = HardwareSerial();
+	port.attachDevice(&module);
+	nativeSetPinLevel(AUX_PIN, HIGH);
+}
+
+void tearDown(void) {
+	nativeHeapUntrack();
+}
+
+void test_fixed_message_wire_format() {
+	LoRa_E220 e220(&port, AUX_PIN, M0_PIN, M1_PIN, UART_BPS_RATE_9600);
+	TEST_ASSERT_TRUE(e220.begin());
+
+	const uint8_t payload[] = { 0xDE, 0xAD, 0xBE, 0xEF, 0x01 };
+	module.count = 0;
+	TEST_ASSERT_EQUAL(E220_SUCCESS, e220.sendFixedMessage(0x12, 0x34, 23, payload, sizeof(payload)).code);
+
+	const uint8_t expected[] = { 0x12, 0x34, 23, 0xDE, 0xAD, 0xBE, 0xEF, 0x01 };
+	TEST_ASSERT_EQUAL(sizeof(expected), module.count);
+	TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, module.bytes, sizeof(expected));
+}
+
+void test_fixed_message_too_big_is_rejected() {
+	LoRa_E220 e220(&port, AUX_PIN, M0_PIN, M1_PIN, UART_BPS_RATE_9600);
+	TEST_ASSERT_TRUE(e220.begin());
+
+	static uint8_t payload[MAX_SIZE_TX_PACKET];
+	module.count = 0;
+	TEST_ASSERT_EQUAL(ERR_E220_PACKET_TOO_BIG, e220.sendFixedMessage(0, 1, 23, payload, sizeof(payload)).code);
+	TEST_ASSERT_EQUAL(0, module.count);
+}
+
+void test_fixed_send_does_not_allocate() {
+	LoRa_E220 e220(&port, AUX_PIN, M0_PIN, M1_PIN, UART_BPS_RATE_9600);
+	TEST_ASSERT_TRUE(e220.begin());
+
+	uint8_t payload[32];
+	for (uint8_t i = 0; i < sizeof(payload); i++) payload[i] = i;
+	String text("Hello, world?");
+	Configuration configuration;
+
+	nativeHeapTrack();
+	for (int i = 0; i < MESSAGES; i++) {
+		module.count = 0;
+		e220.sendFixedMessage(0, 2, 23, payload, sizeof(payload));
+		e220.sendBroadcastFixedMessage(23, payload, sizeof(payload));
+		e220.sendFixedMessage(0, 2, 23, text);
+		e220.sendMessage(text);
+		e220.sendConfigurationMessage(0, 2, 23, &configuration);
+
+		e220.beginSendFixedMessage(0, 2, 23, payload, sizeof(payload));
+		while (e220.isSendPending()) e220.poll();
+	}
+	unsigned long allocations = nativeHeapUntrack();
+
+	printf("[heap] %d iterations of 6 sends: %lu allocations\n", MESSAGES, allocations);
+	TEST_ASSERT_EQUAL(0, allocations);
+}
+
+int main(int argc, char **argv) {
+	UNITY_BEGIN();
+
+	RUN_TEST(test_fixed_message_wire_format);
+	RUN_TEST(test_fixed_message_too_big_is_rejected);
+	RUN_TEST(test_fixed_send_does_not_allocate);
+
+	return UNITY_END();
+}